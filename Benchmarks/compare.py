@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Compare two result files of dpsim-bench and report regressions.
+
+Usage: compare.py BASELINE CURRENT [--threshold PERCENT]
+
+Exits with status 1 if the throughput or the 99th percentile step latency
+of any case is worse than the baseline by more than the threshold, or if a
+case of the baseline is missing in the current results, e.g. because it
+crashed or ran out of memory.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(filename):
+    with open(filename) as f:
+        results = json.load(f)
+
+    return {(c['name'], c['domain']): c for c in results['cases']}
+
+
+def compare(baseline, current, threshold):
+    regressions = 0
+
+    print('%-28s %14s %14s %8s %12s %12s %8s' % ('case', 'steps/s (old)', 'steps/s (new)', 'change',
+                                                  'p99 (old)', 'p99 (new)', 'change'))
+
+    for key in sorted(baseline.keys() & current.keys()):
+        old, new = baseline[key], current[key]
+
+        throughput = new['steps_per_second'] / old['steps_per_second'] - 1
+        latency = new['latency']['p99'] / old['latency']['p99'] - 1 if old['latency']['p99'] > 0 else 0
+
+        regressed = throughput < -threshold or latency > threshold
+        if regressed:
+            regressions += 1
+
+        print('%-28s %14.0f %14.0f %+7.1f%% %10.2fus %10.2fus %+7.1f%%%s' % (
+            key[0], old['steps_per_second'], new['steps_per_second'], 100 * throughput,
+            1e6 * old['latency']['p99'], 1e6 * new['latency']['p99'], 100 * latency,
+            '  REGRESSION' if regressed else ''))
+
+    for key in sorted(baseline.keys() - current.keys()):
+        regressions += 1
+        print('%-28s missing in current results  REGRESSION' % key[0])
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare two dpsim-bench result files')
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=10,
+                        help='allowed degradation in percent (default: 10)')
+    args = parser.parse_args()
+
+    regressions = compare(load(args.baseline), load(args.current), args.threshold / 100)
+    if regressions > 0:
+        print('%d regression(s) with a threshold of %.1f%%' % (regressions, args.threshold))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,524 @@
+/** Benchmark suite for the DPsim solvers
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <DPsim.h>
+#include <dpsim/Histogram.h>
+
+using namespace DPsim;
+using namespace CPS;
+
+/// Components of one simulation domain, so that the grids can be built for DP and EMT
+struct DPComponents {
+	using Node = CPS::DP::Node;
+	using VoltageSource = CPS::DP::Ph1::VoltageSource;
+	using Resistor = CPS::DP::Ph1::Resistor;
+	using Inductor = CPS::DP::Ph1::Inductor;
+	using Capacitor = CPS::DP::Ph1::Capacitor;
+
+	static constexpr Domain domain = Domain::DP;
+
+	static void setVoltage(VoltageSource::Ptr vs, Complex voltage, Real frequency) {
+		vs->setParameters(voltage);
+	}
+};
+
+struct EMTComponents {
+	using Node = CPS::EMT::Node;
+	using VoltageSource = CPS::EMT::Ph1::VoltageSource;
+	using Resistor = CPS::EMT::Ph1::Resistor;
+	using Inductor = CPS::EMT::Ph1::Inductor;
+	using Capacitor = CPS::EMT::Ph1::Capacitor;
+
+	static constexpr Domain domain = Domain::EMT;
+
+	static void setVoltage(VoltageSource::Ptr vs, Complex voltage, Real frequency) {
+		vs->setParameters(voltage, frequency);
+	}
+};
+
+/// Helper to build a system topology with unique component names
+template <typename C>
+class GridBuilder {
+protected:
+	SystemNodeList mNodes;
+	SystemComponentList mComponents;
+	UInt mCount = 0;
+
+	String name(const String &prefix) {
+		return prefix + std::to_string(mCount++);
+	}
+
+public:
+	static constexpr Real frequency = 50;
+
+	typename C::Node::Ptr node() {
+		auto n = C::Node::make(name("n"));
+		mNodes.push_back(n);
+		return n;
+	}
+
+	void source(typename C::Node::Ptr n, Real voltage) {
+		auto vs = C::VoltageSource::make(name("vs"));
+		C::setVoltage(vs, Complex(voltage, 0), frequency);
+		vs->connect({ C::Node::GND, n });
+		mComponents.push_back(vs);
+	}
+
+	void resistor(typename C::Node::Ptr n1, typename C::Node::Ptr n2, Real r) {
+		auto c = C::Resistor::make(name("r"));
+		c->setParameters(r);
+		c->connect({ n1, n2 });
+		mComponents.push_back(c);
+	}
+
+	void inductor(typename C::Node::Ptr n1, typename C::Node::Ptr n2, Real l) {
+		auto c = C::Inductor::make(name("l"));
+		c->setParameters(l);
+		c->connect({ n1, n2 });
+		mComponents.push_back(c);
+	}
+
+	void capacitor(typename C::Node::Ptr n1, typename C::Node::Ptr n2, Real cap) {
+		auto c = C::Capacitor::make(name("c"));
+		c->setParameters(cap);
+		c->connect({ n1, n2 });
+		mComponents.push_back(c);
+	}
+
+	/// Series RL branch with shunt capacitances at both ends
+	void line(typename C::Node::Ptr n1, typename C::Node::Ptr n2, Real r, Real l, Real cap) {
+		auto mid = node();
+		resistor(n1, mid, r);
+		inductor(mid, n2, l);
+		capacitor(n1, C::Node::GND, cap / 2);
+		capacitor(n2, C::Node::GND, cap / 2);
+	}
+
+	/// Voltage source behind an RL impedance
+	typename C::Node::Ptr generator(typename C::Node::Ptr bus, Real voltage) {
+		auto internal = node();
+		auto mid = node();
+		source(internal, voltage);
+		resistor(internal, mid, 0.5);
+		inductor(mid, bus, 0.02);
+		return internal;
+	}
+
+	/// Parallel RL load
+	void load(typename C::Node::Ptr n, Real r, Real l) {
+		resistor(n, C::Node::GND, r);
+		inductor(n, C::Node::GND, l);
+	}
+
+	SystemTopology topology() {
+		return SystemTopology(frequency, mNodes, mComponents);
+	}
+
+	UInt nodes() { return (UInt) mNodes.size(); }
+};
+
+// #### Circuits of Examples/Cxx/Circuits ####
+
+template <typename C>
+SystemTopology circuitVS_RL1() {
+	GridBuilder<C> b;
+	auto n1 = b.node(), n2 = b.node();
+	b.source(n1, 10);
+	b.resistor(n1, n2, 5);
+	b.inductor(n2, C::Node::GND, 0.02);
+	return b.topology();
+}
+
+template <typename C>
+SystemTopology circuitVS_RC1() {
+	GridBuilder<C> b;
+	auto n1 = b.node(), n2 = b.node();
+	b.source(n1, 10);
+	b.resistor(n1, n2, 1);
+	b.capacitor(n2, C::Node::GND, 0.001);
+	return b.topology();
+}
+
+template <typename C>
+SystemTopology circuitVS_R2L3() {
+	GridBuilder<C> b;
+	auto n1 = b.node(), n2 = b.node(), n3 = b.node(), n4 = b.node();
+	b.source(n1, 10);
+	b.resistor(n1, n2, 1);
+	b.inductor(n2, n3, 0.02);
+	b.inductor(n3, C::Node::GND, 0.1);
+	b.inductor(n3, n4, 0.05);
+	b.resistor(n4, C::Node::GND, 2);
+	return b.topology();
+}
+
+// #### Synthetic grids ####
+
+/// Ladder network of RL line segments with loads, two nodes per segment
+template <typename C>
+SystemTopology ladder(UInt nodes) {
+	GridBuilder<C> b;
+	auto prev = b.node();
+	b.source(prev, 10e3);
+
+	while (b.nodes() + 2 <= nodes) {
+		auto mid = b.node(), next = b.node();
+		b.resistor(prev, mid, 0.1);
+		b.inductor(mid, next, 1e-3);
+		b.resistor(next, C::Node::GND, 1e3);
+		prev = next;
+	}
+
+	return b.topology();
+}
+
+/// Number of nodes of one tile of the WSCC-9 like grid, including its tie line
+static const UInt wsccTileNodes = 22;
+
+/// Tiles of a 9-bus grid with the topology of WSCC-9, connected by tie lines.
+/// Generators are modelled as voltage sources behind an impedance, transformers
+/// as series inductances and lines as RL branches with shunt capacitances.
+template <typename C>
+SystemTopology tiledWSCC9(UInt tiles) {
+	GridBuilder<C> b;
+	typename C::Node::Ptr prevBus5;
+
+	for (UInt t = 0; t < tiles; t++) {
+		std::vector<typename C::Node::Ptr> bus(10);
+		for (UInt i = 1; i <= 9; i++)
+			bus[i] = b.node();
+
+		b.generator(bus[1], 16.5e3);
+		b.generator(bus[2], 18e3);
+		b.generator(bus[3], 13.8e3);
+
+		b.inductor(bus[1], bus[4], 0.05);
+		b.inductor(bus[2], bus[7], 0.05);
+		b.inductor(bus[3], bus[9], 0.05);
+
+		b.line(bus[4], bus[5], 5.3, 0.24, 1.4e-6);
+		b.line(bus[4], bus[6], 9.0, 0.26, 1.3e-6);
+		b.line(bus[5], bus[7], 16.9, 0.45, 2.6e-6);
+		b.line(bus[6], bus[9], 20.6, 0.48, 3.0e-6);
+		b.line(bus[7], bus[8], 4.5, 0.19, 1.3e-6);
+		b.line(bus[8], bus[9], 6.3, 0.27, 1.8e-6);
+
+		b.load(bus[5], 420, 1.4);
+		b.load(bus[6], 590, 1.9);
+		b.load(bus[8], 530, 1.7);
+
+		if (prevBus5)
+			b.line(prevBus5, bus[8], 10, 0.3, 2e-6);
+		prevBus5 = bus[5];
+	}
+
+	return b.topology();
+}
+
+// #### Benchmark driver ####
+
+struct Case {
+	String name;
+	Domain domain;
+	UInt nodes;
+	std::function<SystemTopology()> build;
+};
+
+struct Options {
+	UInt steps = 1000;
+	UInt maxNodes = 10000;
+	Real timeStep = 1e-4;
+	String filter;
+	String output;
+	Bool sparse = false;
+	Bool isolate = true;
+	String cimPath = "Examples/CIM/WSCC-09_RX/";
+};
+
+template <typename C>
+static void addCases(std::vector<Case> &cases, const Options &opts) {
+	String prefix = C::domain == Domain::DP ? "DP_" : "EMT_";
+
+	cases.push_back({prefix + "VS_RL1", C::domain, 2, circuitVS_RL1<C>});
+	cases.push_back({prefix + "VS_RC1", C::domain, 2, circuitVS_RC1<C>});
+	cases.push_back({prefix + "VS_R2L3", C::domain, 4, circuitVS_R2L3<C>});
+
+	for (UInt nodes = 10; nodes <= opts.maxNodes; nodes *= 10)
+		cases.push_back({prefix + "Ladder_" + std::to_string(nodes), C::domain, nodes,
+			[nodes](){ return ladder<C>(nodes); }});
+
+	for (UInt tiles : { 1, 5, 45, 450 }) {
+		if (tiles * wsccTileNodes > opts.maxNodes)
+			break;
+
+		cases.push_back({prefix + "WSCC9_Tiled_" + std::to_string(tiles), C::domain, tiles * wsccTileNodes,
+			[tiles](){ return tiledWSCC9<C>(tiles); }});
+	}
+}
+
+static SystemTopology synGenTrStab() {
+	Real initTerminalVolt = 24000;
+	auto n1 = DP::Node::make("n1", PhaseType::Single, std::vector<Complex>{ Complex(initTerminalVolt, 0) });
+
+	auto gen = DP::Ph1::SynchronGeneratorTrStab::make("SynGen", Logger::Level::NONE);
+	gen->setFundamentalParametersPU(555e6, 24e3, 60, 0.15, 1.6599, 0.1648, 3.7);
+	gen->connect({n1});
+	gen->setInitialValues(Complex(300e6, 0), 300e6);
+
+	auto res = DP::Ph1::Resistor::make("Rl", Logger::Level::NONE);
+	res->setParameters(1.92);
+	res->connect({DP::Node::GND, n1});
+
+	return SystemTopology(60, SystemNodeList{n1}, SystemComponentList{gen, res});
+}
+
+static std::vector<Case> allCases(const Options &opts) {
+	std::vector<Case> cases;
+
+	addCases<DPComponents>(cases, opts);
+	addCases<EMTComponents>(cases, opts);
+
+	cases.push_back({"DP_SynGen_TrStab", Domain::DP, 1, synGenTrStab});
+
+#ifdef WITH_CIM
+	String path = opts.cimPath;
+	cases.push_back({"DP_WSCC9_CIM", Domain::DP, 9, [path]() {
+		CIMReader reader("WSCC-9bus", Logger::Level::NONE, Logger::Level::NONE);
+		return reader.loadCIM(60, std::list<String>{
+			path + "WSCC-09_RX_DI.xml",
+			path + "WSCC-09_RX_EQ.xml",
+			path + "WSCC-09_RX_SV.xml",
+			path + "WSCC-09_RX_TP.xml"
+		});
+	}});
+#endif
+
+	return cases;
+}
+
+static String runCase(const Case &c, const Options &opts) {
+	using Clock = std::chrono::steady_clock;
+	auto seconds = [](Clock::duration d) {
+		return std::chrono::duration<Real>(d).count();
+	};
+
+	auto sys = c.build();
+
+	auto start = Clock::now();
+
+	Simulation sim(c.name, sys, opts.timeStep, opts.timeStep * opts.steps,
+		c.domain, Solver::Type::MNA, Logger::Level::NONE);
+
+	// Dense matrices of large grids do not fit into memory
+	if (opts.sparse || c.nodes > 500)
+		sim.setSystemMatrixType(Solver::MatrixType::Sparse);
+
+	sim.initialize();
+
+	auto initialized = Clock::now();
+
+	Histogram latency;
+	for (UInt i = 0; i < opts.steps; i++) {
+		auto before = Clock::now();
+		sim.step();
+		latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+	}
+
+	auto finished = Clock::now();
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	Real runTime = seconds(finished - initialized);
+
+	std::stringstream json;
+	json << std::setprecision(9)
+		<< "{\"name\": \"" << c.name << "\", "
+		<< "\"domain\": \"" << (c.domain == Domain::DP ? "DP" : "EMT") << "\", "
+		<< "\"nodes\": " << c.nodes << ", "
+		<< "\"steps\": " << opts.steps << ", "
+		<< "\"init_time\": " << seconds(initialized - start) << ", "
+		<< "\"run_time\": " << runTime << ", "
+		<< "\"steps_per_second\": " << opts.steps / runTime << ", "
+		<< "\"latency\": {"
+		<< "\"min\": " << latency.min() * 1e-9 << ", "
+		<< "\"mean\": " << latency.mean() * 1e-9 << ", "
+		<< "\"p50\": " << latency.percentile(0.5) * 1e-9 << ", "
+		<< "\"p90\": " << latency.percentile(0.9) * 1e-9 << ", "
+		<< "\"p99\": " << latency.percentile(0.99) * 1e-9 << ", "
+		<< "\"p999\": " << latency.percentile(0.999) * 1e-9 << ", "
+		<< "\"max\": " << latency.max() * 1e-9 << "}, "
+		<< "\"peak_rss_kb\": " << usage.ru_maxrss << "}";
+
+	return json.str();
+}
+
+/// Run the case in a child process, so that its peak memory is not
+/// influenced by the other cases and a crash does not end the suite
+static String runIsolated(const Case &c, const Options &opts) {
+	int fds[2];
+	if (pipe(fds) != 0)
+		throw SystemError("Failed to create pipe");
+
+	pid_t pid = fork();
+	if (pid < 0)
+		throw SystemError("Failed to fork");
+
+	if (pid == 0) {
+		close(fds[0]);
+
+		String result;
+		try {
+			result = runCase(c, opts);
+		}
+		catch (...) {
+			_exit(1);
+		}
+
+		if (write(fds[1], result.data(), result.size()) != (ssize_t) result.size())
+			_exit(1);
+		_exit(0);
+	}
+
+	close(fds[1]);
+
+	String result;
+	char buffer[4096];
+	ssize_t bytes;
+	while ((bytes = read(fds[0], buffer, sizeof(buffer))) > 0)
+		result.append(buffer, bytes);
+	close(fds[0]);
+
+	int status;
+	waitpid(pid, &status, 0);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return "";
+
+	return result;
+}
+
+static void showUsage(const char *name) {
+	std::cout << "Usage: " << name << " [OPTIONS]" << std::endl
+		<< "Runs the benchmark cases and writes the results as JSON." << std::endl
+		<< std::endl
+		<< "  -s, --steps N       number of simulated steps per case (default 1000)" << std::endl
+		<< "  -n, --max-nodes N   skip synthetic grids with more nodes (default 10000)" << std::endl
+		<< "  -t, --timestep DT   simulation time step in seconds (default 1e-4)" << std::endl
+		<< "  -f, --filter STR    only run cases whose name contains STR" << std::endl
+		<< "  -o, --output FILE   write the results to FILE instead of stdout" << std::endl
+		<< "  -c, --cim-path DIR  directory of the WSCC-9 CIM files" << std::endl
+		<< "      --sparse        use sparse system matrices for all cases" << std::endl
+		<< "      --no-isolate    run all cases in this process" << std::endl
+		<< "  -l, --list          list the cases and exit" << std::endl
+		<< std::endl
+		<< "Exits with status 1 if a case failed, e.g. because it crashed." << std::endl
+		<< "Compare two result files with Benchmarks/compare.py." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	Options opts;
+	Bool list = false;
+
+	for (int i = 1; i < argc; i++) {
+		String arg = argv[i];
+		auto value = [&]() -> String {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for " << arg << std::endl;
+				std::exit(1);
+			}
+			return argv[++i];
+		};
+
+		if (arg == "-s" || arg == "--steps")
+			opts.steps = std::stoul(value());
+		else if (arg == "-n" || arg == "--max-nodes")
+			opts.maxNodes = std::stoul(value());
+		else if (arg == "-t" || arg == "--timestep")
+			opts.timeStep = std::stod(value());
+		else if (arg == "-f" || arg == "--filter")
+			opts.filter = value();
+		else if (arg == "-o" || arg == "--output")
+			opts.output = value();
+		else if (arg == "-c" || arg == "--cim-path")
+			opts.cimPath = value();
+		else if (arg == "--sparse")
+			opts.sparse = true;
+		else if (arg == "--no-isolate")
+			opts.isolate = false;
+		else if (arg == "-l" || arg == "--list")
+			list = true;
+		else {
+			showUsage(argv[0]);
+			return arg == "-h" || arg == "--help" ? 0 : 1;
+		}
+	}
+
+	std::vector<String> results;
+	UInt failed = 0;
+
+	for (auto &c : allCases(opts)) {
+		if (c.name.find(opts.filter) == String::npos)
+			continue;
+
+		if (list) {
+			std::cout << c.name << " (" << c.nodes << " nodes)" << std::endl;
+			continue;
+		}
+
+		std::cerr << "Running " << c.name << "..." << std::endl;
+
+		String result = opts.isolate ? runIsolated(c, opts) : runCase(c, opts);
+		if (result.empty()) {
+			std::cerr << "Case " << c.name << " failed" << std::endl;
+			failed++;
+			continue;
+		}
+
+		results.push_back(result);
+	}
+
+	if (list)
+		return 0;
+
+	std::ofstream file;
+	if (!opts.output.empty())
+		file.open(opts.output);
+	std::ostream &out = opts.output.empty() ? std::cout : file;
+
+	out << "{\"version\": 1, \"cases\": [" << std::endl;
+	for (UInt i = 0; i < results.size(); i++)
+		out << "  " << results[i] << (i + 1 < results.size() ? "," : "") << std::endl;
+	out << "]}" << std::endl;
+
+	// The results of the other cases are still written for comparisons
+	return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+/** Heap allocation counter
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <dpsim/Config.h>
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// Counts heap allocations of the calling thread.
+	///
+	/// If DPsim is built with the opt-in option WITH_ALLOCATION_COUNTER, the
+	/// global operators new and delete of the whole process are replaced to
+	/// count allocations. The MNA solver then warns about steps which allocate
+	/// memory after initialization. Otherwise, the count is always zero.
+	class AllocationCounter {
+	public:
+		/// Number of allocations made by the calling thread so far
+		static UInt count();
+		/// True if allocations are actually counted
+		static constexpr Bool enabled() {
+#ifdef WITH_ALLOCATION_COUNTER
+			return true;
+#else
+			return false;
+#endif
+		}
+	};
+}
@@ -0,0 +1,131 @@
+/** Binary checkpoint streams
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+#include <cps/Definitions.h>
+
+namespace DPsim {
+	/// \brief Helpers to write and read the values of a binary checkpoint.
+	///
+	/// Values are stored in the native byte order, so checkpoints can only be
+	/// restored on machines of the same architecture. Read errors throw
+	/// CPS::SystemError.
+	namespace Checkpoint {
+		/// Marks the beginning of a checkpoint file
+		static const char magic[8] = { 'D', 'P', 's', 'i', 'm', 'C', 'K', 'P' };
+		/// Incremented on incompatible changes of the format
+		static const UInt version = 1;
+
+		template <typename T>
+		void write(std::ostream& os, const T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+			os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template <typename T>
+		void read(std::istream& is, T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+			if (!is.read(reinterpret_cast<char*>(&value), sizeof(T)))
+				throw CPS::SystemError("Failed to read checkpoint");
+		}
+
+		template <typename T>
+		T read(std::istream& is) {
+			T value;
+			read(is, value);
+			return value;
+		}
+
+		inline void write(std::ostream& os, const String& str) {
+			write<UInt>(os, (UInt) str.size());
+			os.write(str.data(), str.size());
+		}
+
+		inline void read(std::istream& is, String& str) {
+			str.resize(read<UInt>(is));
+			if (!is.read(&str[0], str.size()))
+				throw CPS::SystemError("Failed to read checkpoint");
+		}
+
+		template <typename T>
+		void write(std::ostream& os, const std::vector<T>& vec) {
+			write<UInt>(os, (UInt) vec.size());
+			for (const T& value : vec)
+				write(os, value);
+		}
+
+		template <typename T>
+		void read(std::istream& is, std::vector<T>& vec) {
+			vec.resize(read<UInt>(is));
+			for (UInt i = 0; i < vec.size(); i++) {
+				T value;
+				read(is, value);
+				vec[i] = value;
+			}
+		}
+
+		template <typename T>
+		void write(std::ostream& os, const MatrixVar<T>& mat) {
+			write<Int>(os, (Int) mat.rows());
+			write<Int>(os, (Int) mat.cols());
+			os.write(reinterpret_cast<const char*>(mat.data()), mat.size() * sizeof(T));
+		}
+
+		template <typename T>
+		void read(std::istream& is, MatrixVar<T>& mat) {
+			Int rows = read<Int>(is);
+			Int cols = read<Int>(is);
+			mat.resize(rows, cols);
+			if (!is.read(reinterpret_cast<char*>(mat.data()), mat.size() * sizeof(T)))
+				throw CPS::SystemError("Failed to read checkpoint");
+		}
+
+		inline void write(std::ostream& os, const SparseMatrix& mat) {
+			SparseMatrix compressed = mat;
+			compressed.makeCompressed();
+
+			write<Int>(os, (Int) compressed.rows());
+			write<Int>(os, (Int) compressed.cols());
+			write<Int>(os, (Int) compressed.nonZeros());
+			os.write(reinterpret_cast<const char*>(compressed.outerIndexPtr()), (compressed.outerSize() + 1) * sizeof(int));
+			os.write(reinterpret_cast<const char*>(compressed.innerIndexPtr()), compressed.nonZeros() * sizeof(int));
+			os.write(reinterpret_cast<const char*>(compressed.valuePtr()), compressed.nonZeros() * sizeof(Real));
+		}
+
+		inline void read(std::istream& is, SparseMatrix& mat) {
+			Int rows = read<Int>(is);
+			Int cols = read<Int>(is);
+			Int nonZeros = read<Int>(is);
+
+			mat.resize(rows, cols);
+			mat.resizeNonZeros(nonZeros);
+			if (!is.read(reinterpret_cast<char*>(mat.outerIndexPtr()), (mat.outerSize() + 1) * sizeof(int)) ||
+				!is.read(reinterpret_cast<char*>(mat.innerIndexPtr()), nonZeros * sizeof(int)) ||
+				!is.read(reinterpret_cast<char*>(mat.valuePtr()), nonZeros * sizeof(Real)))
+				throw CPS::SystemError("Failed to read checkpoint");
+		}
+	}
+}
@@ -0,0 +1,123 @@
+/** Jacobian of the DAE residual
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+#include <cps/Solver/DAEInterface.h>
+
+namespace DPsim {
+	class DAEJacobian;
+
+	/// Interface of components which compute the derivatives of their
+	/// DAE residual themselves instead of using finite differences.
+	class DAEJacobianInterface {
+	public:
+		using Ptr = std::shared_ptr<DAEJacobianInterface>;
+
+		virtual ~DAEJacobianInterface() { }
+
+		/// Add dF/dy + cj * dF/dy' of the residual equations written by
+		/// daeResidual() with DAEJacobian::add(). The offsets are the ones
+		/// passed to daeResidual() and have to be advanced in the same way.
+		/// The pattern of the Jacobian is recorded once, entries which are
+		/// added later on extend it at the cost of a new symbolic factorization.
+		virtual void daeJacobian(Real time, const Real state[], const Real dstate_dt[],
+			Real cj, DAEJacobian& jacobian, std::vector<int>& off) = 0;
+	};
+
+	/// \brief Sparse Jacobian dF/dy + cj * dF/dy' of the residual of a DAE system.
+	///
+	/// The residual equations are written by the components at offsets which
+	/// only the components know. The rows and the state variables of each
+	/// component are therefore probed once by evaluating its residual on its
+	/// own. The Jacobian of components without DAEJacobianInterface is then
+	/// computed by finite differences of their residual in these columns only,
+	/// which costs a few evaluations of each component instead of one
+	/// evaluation of the whole system per state variable.
+	class DAEJacobian {
+	protected:
+		struct Component {
+			CPS::DAEInterface::ResFn residual;
+			/// Analytic Jacobian, null for finite differences
+			DAEJacobianInterface::Ptr jacobian;
+			/// Offsets passed to the residual and Jacobian of the component
+			std::vector<int> offsets;
+			/// Residual equations written by the component
+			std::vector<Int> rows;
+			/// State variables and derivatives the residual depends on
+			std::vector<Int> stateColumns;
+			std::vector<Int> derivativeColumns;
+		};
+
+		/// Number of equations and state variables
+		Int mSize;
+		/// Leading equations y_i - v_i = 0 of the node voltages
+		Int mUnitRows;
+		std::vector<Component> mComponents;
+		/// Jacobian with the pattern of all components
+		SparseMatrix mMatrix;
+		/// Record the entries passed to add() instead of adding them
+		Bool mRecording = false;
+		/// Recorded entries, or the entries missing in the pattern while computing
+		std::vector<Eigen::Triplet<Real>> mPattern;
+
+		// #### Buffers of the finite differences ####
+		std::vector<int> mOffsets;
+		std::vector<Real> mState;
+		std::vector<Real> mDerivative;
+		std::vector<Real> mResidual;
+		std::vector<Real> mBase;
+		std::vector<Real> mPerturbed;
+
+		/// Evaluate the residual of a component and store its rows in values
+		void evaluate(Component& comp, Real time, std::vector<Real>& values);
+		/// Find the variables whose perturbation changes the residual of a component
+		void probe(Component& comp, std::vector<Real>& variables, const std::vector<Real>& steps,
+			std::vector<Int>& columns);
+		/// Add the missing entries in mPattern to the pattern of the Jacobian
+		void extendPattern();
+
+	public:
+		/// The first unitRows equations only depend on their own state variable
+		DAEJacobian(Int size, Int unitRows);
+
+		/// Add the next component in the order in which its residual is called
+		void addComponent(CPS::DAEInterface::ResFn residual, DAEJacobianInterface::Ptr jacobian = nullptr);
+		/// Determine the rows, the offsets and the dependencies of the components.
+		/// The offsets are the ones passed to the residual of the first component.
+		void analyzePattern(const std::vector<int>& offsets);
+		/// Compute the Jacobian for the given state. Entries of analytic
+		/// Jacobians outside of the recorded pattern extend the pattern, so
+		/// the number of nonzeros may grow.
+		void compute(Real time, const Real state[], const Real dstate_dt[], Real cj);
+		/// Add to an entry of the Jacobian, used by DAEJacobianInterface.
+		/// Throws SolverException if the entry is outside of the matrix.
+		void add(Int row, Int col, Real value);
+
+		// #### Getter ####
+		const SparseMatrix& matrix() const { return mMatrix; }
+		Int nonZeros() const { return (Int) mMatrix.nonZeros(); }
+	};
+}
@@ -24,10 +24,12 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <list>
 
 #include <dpsim/Solver.h>
+#include <dpsim/DAEJacobian.h>
 
 #include <cps/SystemTopology.h>
 #include <cps/Solver/DAEInterface.h>
@@ -36,6 +38,10 @@
 #include <ida/ida.h>
 #include <ida/ida_direct.h>
 #include <sunlinsol/sunlinsol_dense.h>
+#ifdef WITH_KLU
+  #include <sunmatrix/sunmatrix_sparse.h>
+  #include <sunlinsol/sunlinsol_klu.h>
+#endif
 #include <sundials/sundials_types.h>
 #include <nvector/nvector_serial.h>
 
@@ -76,16 +82,28 @@ namespace DPsim {
 		SUNMatrix A = NULL;
 		/// Linear solver object
 		SUNLinearSolver LS = NULL;
+		/// Storage format of the Jacobian, sparse matrices are solved with KLU
+		Solver::MatrixType mMatrixType;
+		/// Jacobian assembled from the components
+		std::unique_ptr<DAEJacobian> mJacobian;
+		/// Nonzeros of the pattern the sparse linear solver was set up for
+		Int mJacobianNonZeros = 0;
 
 		std::vector<DAEInterface::ResFn> mResidualFunctions;
 
 		/// Residual Function of entire System
 		static int residualFunctionWrapper(realtype ttime, N_Vector state, N_Vector dstate_dt, N_Vector resid, void *user_data);
 		int residualFunction(realtype ttime, N_Vector state, N_Vector dstate_dt, N_Vector resid);
-	
+		/// Jacobian of the residual function, called by IDA
+		static int jacobianFunctionWrapper(realtype ttime, realtype cj, N_Vector state, N_Vector dstate_dt,
+			N_Vector resid, SUNMatrix jacobian, void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+		int jacobianFunction(realtype ttime, realtype cj, N_Vector state, N_Vector dstate_dt, SUNMatrix jacobian);
+
 	public:
-		/// Create solve object with given parameters
-		DAESolver(String name, SystemTopology system, Real dt, Real t0);
+		/// Create solve object with given parameters. Sparse Jacobians require
+		/// SUNDIALS with KLU and throw UnsupportedSolverException otherwise.
+		DAESolver(String name, SystemTopology system, Real dt, Real t0,
+			Solver::MatrixType matrixType = Solver::MatrixType::Dense);
 		/// Deallocate all memory
 		~DAESolver();
 		/// Initialize Components & Nodes with inital values
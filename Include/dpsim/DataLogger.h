@@ -22,8 +22,12 @@
 #pragma once
 
 #include <map>
+#include <vector>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <thread>
+#include <cstdint>
 
 #include <dpsim/Definitions.h>
 #include <cps/PtrFactory.h>
@@ -32,30 +36,142 @@
 
 namespace DPsim {
 
+	/// Writes the time series of attributes or node values to a file.
+	///
+	/// Besides CSV, the logger supports a binary format with the file extension
+	/// .dpsim which is read by dpsim.read_binary_log() in Python. All values are
+	/// stored in native byte order:
+	///
+	///  - Header: the magic "DPSIMLOG", the uint32 fields version, byte order
+	///    mark 0x01020304, bytes per value (4 or 8) and number of columns
+	///    including the time, followed by the name and unit of each column as
+	///    uint32 length and characters.
+	///  - Chunks: the uint32 number of rows, followed by the float64 time
+	///    column and each value column with the configured precision.
+	///
+	/// In asynchronous mode, see setAsync(), the logging thread only copies the
+	/// values into a preallocated ring buffer and a background thread writes the file.
 	class DataLogger : public SharedFactory<DataLogger> {
 
+	public:
+		enum class Format { CSV, Binary };
+		/// Behavior of asynchronous logging if all slots are in use
+		enum class OverflowPolicy {
+			/// Drop the sample
+			Drop,
+			/// Wait until the writer thread frees a slot
+			Block,
+			/// Drop the sample and only log every n-th sample until the
+			/// writer has caught up. n doubles with each overflow.
+			Decimate
+		};
+
 	protected:
 		std::ofstream mLogFile;
 		Bool mEnabled;
+		/// File format
+		Format mFormat;
+		/// Bytes per value in binary files, either 4 or 8
+		UInt mPrecision;
 
 		std::map<String, CPS::AttributeBase::Ptr> mAttributes;
+		/// Units of the columns in binary files
+		std::map<String, String> mUnits;
+
+		// #### Binary format ####
+		/// Number of value columns, excluding the time
+		UInt mColumns = 0;
+		/// Maximum number of rows buffered before they are written
+		UInt mChunkSize;
+		/// Number of rows in the current chunk
+		UInt mChunkRows = 0;
+		/// Time column of the current chunk
+		std::vector<Real> mChunkTimes;
+		/// Values of the current chunk stored column by column
+		std::vector<Real> mChunkValues;
+		/// Buffer to convert a column to single precision
+		std::vector<float> mChunkFloats;
+		/// Attribute values of one row
+		std::vector<Real> mRowValues;
+		/// Attributes in the order of the columns, resolved when the header is written
+		std::vector<CPS::Attribute<Real>::Ptr> mRealAttributes;
+		std::vector<CPS::Attribute<Int>::Ptr> mIntAttributes;
+		/// Set as soon as the column names have been written
+		Bool mHeaderWritten = false;
+
+		// #### Asynchronous logging ####
+		Bool mAsync = false;
+		OverflowPolicy mPolicy = OverflowPolicy::Drop;
+		/// Number of rows which can be buffered
+		UInt mCapacity = 0;
+		/// Number of values per row including the time
+		UInt mRowSize = 0;
+		/// Ring buffer of rows, allocated when the first row is logged
+		std::vector<Real> mSlots;
+		/// Number of rows added by the logging thread
+		std::atomic<uint64_t> mEnqueuedRows;
+		/// Number of rows written by the writer thread
+		std::atomic<uint64_t> mWrittenRows;
+		std::thread mWriter;
+		std::atomic<Bool> mStopWriter;
+		/// Only every mDecimation-th sample is logged
+		UInt mDecimation = 1;
+		UInt mDecimationCounter = 0;
+		std::atomic<UInt> mDroppedSamples;
+		std::atomic<UInt> mDecimatedSamples;
 
 		void logDataLine(Real time, Real data);
 		void logDataLine(Real time, const Matrix& data);
 		void logDataLine(Real time, const MatrixComp& data);
 
+		/// Write the header of a binary file
+		void writeBinaryHeader(const std::vector<String>& names);
+		/// Add a row to the current chunk of a binary file
+		void logBinaryRow(Real time, const Real* values, UInt count);
+		/// Write the rows of the current chunk
+		void writeChunk();
+		/// Resolve the attributes to their values for the binary format
+		void resolveAttributes();
+		/// Write a row of a CSV file
+		void writeCSVRow(Real time, const Real* values, UInt count);
+		/// Write a row in the configured format
+		void writeRow(Real time, const Real* values, UInt count);
+		/// Write a row or pass it to the writer thread
+		void logRow(Real time, const Real* values, UInt count);
+		/// Copy a row into the ring buffer for the writer thread
+		void enqueueRow(Real time, const Real* values, UInt count);
+		/// Allocate the ring buffer and start the writer thread
+		void startWriter(UInt count);
+		void stopWriter();
+		/// Main function of the writer thread
+		void write();
+
 	public:
 		using Ptr = std::shared_ptr<DataLogger>;
 
-		DataLogger(String name, Bool enabled = true);
+		DataLogger(String name, Bool enabled = true,
+			Format format = Format::CSV, UInt precision = 8, UInt chunkSize = 4096);
 		~DataLogger();
 
+		/// Write all buffered rows. In asynchronous mode, this waits for
+		/// the writer thread and must be called by the logging thread.
 		void flush();
 
+		/// Write the file on a background thread which is started with the
+		/// first sample. Up to capacity rows are buffered. Must be called
+		/// before logging.
+		void setAsync(UInt capacity = 4096, OverflowPolicy policy = OverflowPolicy::Drop);
+
+		/// Set up the buffers of attribute loggers and fault in all buffers,
+		/// so that logging the first samples does not allocate memory.
+		void prefault();
+
 		void logPhasorNodeValues(Real time, const Matrix& data);
 		void logEMTNodeValues(Real time, const Matrix& data);
 
 		void setColumnNames(std::vector<String> names);
+		/// Set the unit of a column which is stored in binary files
+		void setUnit(const String &name, const String &unit) { mUnits[name] = unit; }
 
 		void addAttribute(const String &name, CPS::AttributeBase::Ptr attr);
 		void addAttribute(const String &name, CPS::Attribute<Int>::Ptr attr);
@@ -70,6 +186,12 @@ namespace DPsim {
 		}
 
 		void log(Real time);
+
+		// #### Getter ####
+		/// Samples dropped in asynchronous mode because no slot was free
+		UInt droppedSamples() const { return mDroppedSamples; }
+		/// Samples skipped in asynchronous mode due to decimation
+		UInt decimatedSamples() const { return mDecimatedSamples; }
 	};
 }
 
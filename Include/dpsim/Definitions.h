@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <Eigen/Sparse>
+
 #include <cps/Definitions.h>
 
 namespace DPsim {
@@ -33,6 +35,8 @@ namespace DPsim {
 	using UInt = CPS::UInt;
 	using Matrix = CPS::Matrix;
 	using MatrixComp = CPS::MatrixComp;
+	using SparseMatrix = Eigen::SparseMatrix<Real, Eigen::ColMajor>;
+	using SparseMatrixComp = Eigen::SparseMatrix<Complex, Eigen::ColMajor>;
 
 	template<typename T>
 	using MatrixVar = CPS::MatrixVar<T>;
@@ -0,0 +1,117 @@
+/** Ensemble of simulations
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/Simulation.h>
+#include <cps/SystemTopology.h>
+
+namespace DPsim {
+	/// \brief Runs scenarios of one system concurrently, e.g. for parameter sweeps.
+	///
+	/// Each scenario simulates its own instance of the system, as components
+	/// keep the state of a simulation. The instances are created by a factory
+	/// and modified by the setup of the scenario, e.g. by setting attributes
+	/// or adding events. The scenarios are distributed dynamically over the
+	/// threads. Their MNA solvers share the factorizations of equal system
+	/// matrices, so scenarios which only differ in sources or events do not
+	/// factorize their matrices again.
+	class Ensemble {
+	public:
+		using Ptr = std::shared_ptr<Ensemble>;
+		/// Creates a new instance of the system
+		using TopologyFactory = std::function<CPS::SystemTopology()>;
+		/// Modifies the simulation and the system of a scenario before it is run.
+		/// The system has already been passed to the simulation, so only the
+		/// attributes of its components and nodes can be changed.
+		using Setup = std::function<void(Simulation&, CPS::SystemTopology&)>;
+
+	protected:
+		struct Scenario {
+			String name;
+			Setup setup;
+		};
+
+		/// Prefix of the names of the scenario simulations
+		String mName;
+		TopologyFactory mTopology;
+		Real mTimeStep;
+		Real mFinalTime;
+		CPS::Domain mDomain;
+		Solver::Type mSolverType;
+		CPS::Logger::Level mLogLevel;
+		/// Setup which is applied to all scenarios before their own one
+		Setup mSetup;
+		std::vector<Scenario> mScenarios;
+		/// Object and attribute names which are logged for each scenario
+		std::vector<std::pair<String, String>> mLoggedAttributes;
+		/// Number of scenarios which are stepped in lockstep by one thread
+		UInt mBatchSize = 1;
+		/// Factorizations of the last run
+		std::shared_ptr<SharedFactorizations> mFactorizations;
+
+		/// Create and set up the simulation of a scenario
+		std::unique_ptr<Simulation> createScenario(const Scenario& scenario);
+		/// Run the scenarios of a batch
+		void runBatch(UInt first, UInt count);
+
+	public:
+		Ensemble(String name, TopologyFactory topology,
+			Real timeStep, Real finalTime,
+			CPS::Domain domain = CPS::Domain::DP,
+			Solver::Type solverType = Solver::Type::MNA,
+			CPS::Logger::Level logLevel = CPS::Logger::Level::INFO);
+
+		/// Add a scenario which is simulated as "<ensemble name>_<scenario name>"
+		void addScenario(const String& name, Setup setup) {
+			mScenarios.push_back({ name, setup });
+		}
+		/// Log an attribute of a component or node in each scenario to the
+		/// logger "<ensemble name>_<scenario name>_results"
+		void logAttribute(const String& object, const String& attribute) {
+			mLoggedAttributes.emplace_back(object, attribute);
+		}
+		/// Run all scenarios on the given number of threads, zero uses one
+		/// thread per CPU. Scenarios whose setup or simulation throws do not
+		/// stop the other batches, the first exception is rethrown afterwards.
+		void run(UInt threads = 0);
+
+		// #### Setter ####
+		/// Apply a setup to all scenarios, e.g. solver settings
+		void setSetup(Setup setup) { mSetup = setup; }
+		/// Step batches of consecutive scenarios in lockstep on one thread,
+		/// see Simulation::runBatch(). Scenarios with equal system matrices
+		/// then solve their right sides as one block in each step.
+		void setBatchSize(UInt size) { mBatchSize = std::max(1u, size); }
+
+		// #### Getter ####
+		String name() const { return mName; }
+		UInt scenarios() const { return (UInt) mScenarios.size(); }
+		/// Factorizations shared by the scenarios of the last run
+		std::shared_ptr<SharedFactorizations> factorizations() const { return mFactorizations; }
+	};
+}
@@ -23,43 +23,58 @@
 #pragma once
 
 #include <deque>
-#include <queue>
+#include <fstream>
+#include <vector>
 
 #include <dpsim/Config.h>
-#include <cps/Definitions.h>
+#include <dpsim/Definitions.h>
 #include <cps/Attribute.h>
 #include <cps/Logger.h>
+#include <cps/SystemTopology.h>
 #include <cps/Base/Base_Ph1_Switch.h>
 #include <cps/PtrFactory.h>
 
 namespace DPsim {
 
-	class EventComparator;
 	class EventQueue;
 
 	class Event {
 
-		friend class EventComparator;
 		friend class EventQueue;
 
 	protected:
 		CPS::Real mTime;
+		/// Optional name which is used in the event log
+		CPS::String mName;
+
+		/// Write the value of complex attributes as a single CSV field
+		template<typename T>
+		static void writeValue(std::ostream &os, const T &val) { os << val; }
+		static void writeValue(std::ostream &os, const CPS::Complex &val) {
+			os << val.real() << std::showpos << val.imag() << std::noshowpos << "j";
+		}
 
 	public:
 		using Ptr = std::shared_ptr<Event>;
 
 		virtual void execute() = 0;
+		/// Write the name and the new value as two CSV fields
+		virtual void describe(std::ostream &os) const {
+			os << (mName.empty() ? "event" : mName) << ",";
+		}
 
 		Event(CPS::Real t) :
 			mTime(t)
 		{ }
-	};
 
-	class EventComparator {
-	public:
-		bool operator() (const Event::Ptr &l, const Event::Ptr &r) {
-			return l->mTime > r->mTime;
-		}
+		virtual ~Event() { }
+
+		// #### Setter ####
+		void setName(const CPS::String &name) { mName = name; }
+
+		// #### Getter ####
+		CPS::Real time() const { return mTime; }
+		const CPS::String & name() const { return mName; }
 	};
 
 	template<typename T>
@@ -78,6 +93,11 @@ namespace DPsim {
 		void execute() {
 			mAttribute->set(mNewValue);
 		}
+
+		void describe(std::ostream &os) const {
+			os << (mName.empty() ? "attribute" : mName) << ",";
+			writeValue(os, mNewValue);
+		}
 	};
 
 	class SwitchEvent : public Event, public SharedFactory<SwitchEvent> {
@@ -101,18 +121,85 @@ namespace DPsim {
 			else
 				mSwitch->open();
 		}
+
+		void describe(std::ostream &os) const {
+			os << (mName.empty() ? "switch" : mName) << "," << (mNewState ? "closed" : "open");
+		}
 	};
 
+	/// \brief Calendar queue which dispatches the events of a simulation step in O(1).
+	///
+	/// Events are mapped to the index of the first step whose time is not
+	/// before the event time when they are added. An event of step s is
+	/// stored in bucket s modulo the number of buckets, which is kept
+	/// ordered by step and event time. Events with the same time are
+	/// executed in the order in which they have been added.
 	class EventQueue {
 
 	protected:
-		std::priority_queue<Event::Ptr, std::deque<Event::Ptr>, EventComparator> mEvents;
+		struct Entry {
+			UInt step;
+			Event::Ptr event;
+		};
+		using Bucket = std::deque<Entry>;
+
+		/// Calendar buckets, the number of buckets is a power of two
+		std::vector<Bucket> mBuckets;
+		/// Time step which is used to map event times to step indices
+		Real mTimeStep;
+		/// Index of the first step which has not been dispatched yet
+		UInt mNextStep = 0;
+		/// Time of the last dispatched step
+		Real mLastTime = 0;
+		/// Number of queued events
+		UInt mSize = 0;
+		/// Number of executed events
+		UInt mExecuted = 0;
+		/// Optional event log
+		std::ofstream mLog;
+
+		/// Index of the first step whose time is not before the given time
+		UInt stepIndex(Real time) const;
+		/// Insert an entry into its bucket behind all entries which are not later
+		void insert(Entry entry);
+		/// Redistribute all events to the given number of buckets
+		void resize(UInt buckets);
+		/// Execute an event and write it to the event log
+		void execute(const Entry &entry, Real currentTime);
 
 	public:
-		///
+		EventQueue(Real timeStep, UInt buckets = 1024);
+
+		/// Schedule a single event
 		void addEvent(Event::Ptr e);
-		///
-		void handleEvents(CPS::Real currentTime);
+		/// Schedule multiple events. Presorted events are appended to
+		/// their buckets without searching.
+		void addEvents(const std::vector<Event::Ptr> &events);
+		/// Load a presorted event stream from a CSV file with the columns
+		/// time, object name, attribute name, value and an optional imaginary part.
+		/// Objects are looked up in the components and nodes of the system.
+		void loadEvents(const String &filename, const CPS::SystemTopology &system);
+		/// Execute all events which are due at the step of currentTime
+		void handleEvents(Real currentTime);
+		/// Discard the events before the step of the given time without
+		/// executing them, e.g. when resuming from a checkpoint
+		void skip(Real time);
+		/// Time of the first step with queued events which is not after the
+		/// given time, or infinity if there is none
+		Real nextStepTime(Real until) const;
+
+		// #### Setter ####
+		/// Change the time step and map the queued events to the new step indices
+		void setTimeStep(Real timeStep);
+		/// Write every executed event to a CSV file with the columns
+		/// time, step, scheduled time, event name and new value.
+		/// An empty filename disables the event log.
+		void setLog(const String &filename);
+
+		// #### Getter ####
+		Real timeStep() const { return mTimeStep; }
+		UInt size() const { return mSize; }
+		UInt executed() const { return mExecuted; }
+		UInt buckets() const { return mBuckets.size(); }
 	};
 }
-
@@ -0,0 +1,89 @@
+/** Latency histogram
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// Histogram of latencies in nanoseconds with logarithmic buckets.
+	/// Each power of two is split into 32 linear sub-buckets, so values are
+	/// resolved with a relative error below 3.2% up to about 18 minutes.
+	/// Recording is lock-free and allocation-free. A single thread may record,
+	/// while other threads read consistent, if slightly outdated, statistics.
+	class Histogram {
+	public:
+		/// Number of sub-buckets per power of two
+		static constexpr UInt subBucketBits = 5;
+		static constexpr UInt subBuckets = 1 << subBucketBits;
+		/// Largest recorded power of two
+		static constexpr UInt maxExponent = 40;
+		static constexpr UInt numBuckets = 2 * subBuckets + (maxExponent - subBucketBits) * subBuckets;
+
+	protected:
+		std::array<std::atomic<uint64_t>, numBuckets> mBuckets;
+		std::atomic<uint64_t> mCount;
+		std::atomic<uint64_t> mSum;
+		std::atomic<uint64_t> mMin;
+		std::atomic<uint64_t> mMax;
+
+		/// Only the recording thread writes, so relaxed accesses suffice
+		static void add(std::atomic<uint64_t> &a, uint64_t v) {
+			a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+		}
+
+	public:
+		Histogram() { reset(); }
+
+		/// Index of the bucket containing value
+		static UInt bucket(uint64_t value);
+		/// Smallest value of the bucket with the given index
+		static uint64_t lowerBound(UInt bucket);
+
+		/// Record a latency in nanoseconds
+		void record(uint64_t value) {
+			add(mBuckets[bucket(value)], 1);
+			add(mCount, 1);
+			add(mSum, value);
+
+			if (value < mMin.load(std::memory_order_relaxed))
+				mMin.store(value, std::memory_order_relaxed);
+			if (value > mMax.load(std::memory_order_relaxed))
+				mMax.store(value, std::memory_order_relaxed);
+		}
+
+		/// Clear all recorded values
+		void reset();
+
+		// #### Getter ####
+		uint64_t count() const { return mCount.load(std::memory_order_relaxed); }
+		/// Smallest recorded value, zero if empty
+		uint64_t min() const { return count() ? mMin.load(std::memory_order_relaxed) : 0; }
+		uint64_t max() const { return mMax.load(std::memory_order_relaxed); }
+		Real mean() const;
+		/// Value below which the given fraction (0..1) of all values lies
+		uint64_t percentile(Real fraction) const;
+	};
+}
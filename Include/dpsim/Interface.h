@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 
 #include <villas/sample.h>
@@ -30,6 +31,7 @@
 
 #include <dpsim/Config.h>
 #include <dpsim/Definitions.h>
+#include <dpsim/Timer.h>
 #include <cps/Attribute.h>
 #include <cps/PtrFactory.h>
 
@@ -51,17 +53,89 @@ namespace DPsim {
 		typedef struct ::shmem_conf Config;
 		typedef struct ::shmem_int ShmemInterface;
 
+		/// Statistics of the blocking reads
+		struct Statistics {
+			/// Number of samples read
+			UInt reads = 0;
+			/// Samples which arrived only after the wait went to sleep
+			UInt lateSamples = 0;
+			/// Reads which ended without a new sample, keeping the old values
+			UInt missedSamples = 0;
+			/// Total and maximum time spent waiting for samples
+			Timer::Ticks waitTime = Timer::Ticks::zero();
+			Timer::Ticks maxWaitTime = Timer::Ticks::zero();
+		};
+
 	protected:
+		/// Attribute exchanged at a fixed index of the samples
+		template<typename T>
+		struct Mapping {
+			typename CPS::Attribute<T>::Ptr attribute;
+			Int idx;
+		};
+
+		template<typename T>
+		using Mappings = std::vector<Mapping<T>>;
+
 		std::vector<std::function<void(Sample*)>> mExports, mImports;
+		/// Number of values written by the export callbacks
+		Int mExportCallbackLength = 0;
+
+		/// Attribute imports and exports, sorted by index when opening the interface
+		Mappings<Int> mIntImports, mIntExports;
+		Mappings<Real> mRealImports, mRealExports;
+		Mappings<Bool> mBoolImports, mBoolExports;
+		Mappings<Complex> mComplexImports, mComplexExports;
+		/// Number of values a received sample must contain
+		Int mImportLength = 0;
+		/// Number of values written to each sample
+		Int mExportLength = 0;
 
 		ShmemInterface mShmem;
+		/// Last sent sample, referenced rather than copied
 		Sample *mLastSample;
 
+		/// Number of samples read or written per exchange
+		UInt mBatchSize = 1;
+		/// Samples allocated for the current write batch
+		std::vector<Sample*> mWriteBatch;
+		/// Number of samples filled in the current write batch
+		UInt mBatched = 0;
+		/// Samples received in the last read
+		std::vector<Sample*> mReadBatch;
+		/// Write complex values as two doubles instead of a pair of floats
+		Bool mDoublePrecision = false;
+
+		/// Number of polls before a blocking read starts yielding the CPU
+		UInt mSpins = 1000;
+		/// Number of polls with yielding before a blocking read starts sleeping
+		UInt mYields = 100;
+		/// Longest sleep between two polls
+		Timer::Ticks mMaxSleep = std::chrono::microseconds(100);
+		/// Timeout of blocking reads relative to their start, zero for none
+		Timer::Ticks mReadTimeout = Timer::Ticks::zero();
+		/// Absolute deadline of blocking reads, ignored if not set
+		Timer::IntervalTimePoint mDeadline;
+		Statistics mStatistics;
+
 		bool mOpened;
 		int mSequence;
 		String mRName, mWName;
 		Config mConf;
 
+		/// Sort the attribute mappings and check them against the sample length
+		void resolveMappings();
+		/// Copy the imported values from a received sample to the attributes
+		void importValues(Sample *smp);
+		/// Copy the exported attribute values into a sample
+		void exportValues(Sample *smp);
+		/// Write the first cnt samples of the current batch to the queue
+		Int writeBatch(UInt cnt);
+		/// Release the samples of the current batch that were not written
+		void releaseBatch();
+		/// Poll for new samples until they arrive or the deadline expires
+		Int waitForSamples();
+
 	public:
 
 		/** Create a Interface using the given shmem object names.
@@ -98,8 +172,45 @@ namespace DPsim {
 		void open();
 		void close();
 
+		// #### Setter ####
+		/// Exchange up to batchSize samples per access to the shared memory queues.
+		/// writeValues() stages one sample per call and sends them at once
+		/// when the batch is full, readValues() drains up to batchSize samples
+		/// and applies the newest one. Must be called before open().
+		void setBatchSize(UInt batchSize) { mBatchSize = batchSize > 0 ? batchSize : 1; }
+		/// Exchange complex values as two double-precision values at idx and idx+1
+		/// instead of a single-precision complex value at idx.
+		void setDoublePrecision(Bool doublePrecision) { mDoublePrecision = doublePrecision; }
+		/// Configure how blocking reads wait for samples: poll busily for the
+		/// first spins attempts, then yield the CPU for the next yields attempts,
+		/// then sleep between polls with a backoff of up to maxSleep.
+		void setWaitStrategy(UInt spins, UInt yields, Timer::Ticks maxSleep) {
+			mSpins = spins;
+			mYields = yields;
+			mMaxSleep = maxSleep;
+		}
+		/// Give up blocking reads after the timeout and keep the previous values.
+		/// Without a timeout or deadline, blocking reads wait for the remote and
+		/// warn after waiting for one second and every doubled time after it.
+		void setReadTimeout(Timer::Ticks timeout) { mReadTimeout = timeout; }
+		/// Give up blocking reads at the deadline and keep the previous values.
+		/// The real-time simulation sets it to the next timer tick before each step
+		/// and clears it after the run. A default time point clears the deadline.
+		void setDeadline(const Timer::IntervalTimePoint &deadline) { mDeadline = deadline; }
+
+		// #### Getter ####
+		UInt batchSize() const { return mBatchSize; }
+		Bool doublePrecision() const { return mDoublePrecision; }
+		const Statistics & statistics() const { return mStatistics; }
+		String name() const { return mWName + " <-> " + mRName; }
+
 		void addImport(std::function<void(Sample*)> l) { mImports.push_back(l); }
-		void addExport(std::function<void(Sample*)> l) { mExports.push_back(l); }
+		/// Add a callback which writes the first length values of each sample.
+		/// Callbacks may also extend the length of the sample themselves.
+		void addExport(std::function<void(Sample*)> l, Int length = 0) {
+			mExports.push_back(l);
+			mExportCallbackLength = std::max(mExportCallbackLength, length);
+		}
 
 		void addImport(CPS::Attribute<Int>::Ptr attr, Int idx);
 		void addImport(CPS::Attribute<Real>::Ptr attr, Int idx);
@@ -121,6 +232,9 @@ namespace DPsim {
 		 * calculate needed voltages.
 		 */
 		void writeValues();
+
+		/// Write the samples staged in the current batch without waiting for it to fill up.
+		void flush();
 	};
 }
 
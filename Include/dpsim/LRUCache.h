@@ -0,0 +1,132 @@
+/** Least recently used cache
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// Cache which evicts the least recently used entries as soon as the
+	/// number of entries or their accumulated size exceeds the limits.
+	/// A limit of zero disables the respective check.
+	template <typename Key, typename Value, typename Hash = std::hash<Key>>
+	class LRUCache {
+	protected:
+		struct Entry {
+			Key key;
+			Value value;
+			std::size_t size;
+		};
+		using EntryList = std::list<Entry>;
+
+		/// Entries ordered from the most to the least recently used one
+		EntryList mEntries;
+		/// Lookup table for the entries
+		std::unordered_map<Key, typename EntryList::iterator, Hash> mIndex;
+		/// Maximum number of entries
+		std::size_t mMaxEntries;
+		/// Maximum accumulated size of all entries
+		std::size_t mMaxSize;
+		/// Accumulated size of all entries
+		std::size_t mSize = 0;
+
+		// #### Statistics ####
+		UInt mHits = 0;
+		UInt mMisses = 0;
+		UInt mEvictions = 0;
+
+		/// Remove least recently used entries until the limits are met.
+		/// The most recently used entry is always kept.
+		void evict() {
+			while (mEntries.size() > 1 &&
+				((mMaxEntries > 0 && mEntries.size() > mMaxEntries) ||
+				 (mMaxSize > 0 && mSize > mMaxSize))) {
+				auto &last = mEntries.back();
+
+				mSize -= last.size;
+				mIndex.erase(last.key);
+				mEntries.pop_back();
+				mEvictions++;
+			}
+		}
+
+	public:
+		LRUCache(std::size_t maxEntries = 32, std::size_t maxSize = 1024 * 1024 * 1024) :
+			mMaxEntries(maxEntries),
+			mMaxSize(maxSize) { }
+
+		/// Returns a pointer to the cached value or nullptr if there is none.
+		/// The entry becomes the most recently used one.
+		Value* get(const Key &key) {
+			auto it = mIndex.find(key);
+			if (it == mIndex.end()) {
+				mMisses++;
+				return nullptr;
+			}
+
+			mEntries.splice(mEntries.begin(), mEntries, it->second);
+			mHits++;
+
+			return &it->second->value;
+		}
+
+		/// Insert or replace a value which occupies size bytes
+		Value& put(const Key &key, const Value &value, std::size_t size) {
+			auto it = mIndex.find(key);
+			if (it != mIndex.end()) {
+				mSize -= it->second->size;
+				mEntries.erase(it->second);
+			}
+
+			mEntries.push_front({ key, value, size });
+			mIndex[key] = mEntries.begin();
+			mSize += size;
+
+			evict();
+
+			return mEntries.front().value;
+		}
+
+		void clear() {
+			mEntries.clear();
+			mIndex.clear();
+			mSize = 0;
+		}
+
+		// #### Setter ####
+		void setLimits(std::size_t maxEntries, std::size_t maxSize) {
+			mMaxEntries = maxEntries;
+			mMaxSize = maxSize;
+
+			evict();
+		}
+
+		// #### Getter ####
+		std::size_t entries() const { return mEntries.size(); }
+		std::size_t size() const { return mSize; }
+		UInt hits() const { return mHits; }
+		UInt misses() const { return mMisses; }
+		UInt evictions() const { return mEvictions; }
+	};
+}
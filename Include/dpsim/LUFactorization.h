@@ -0,0 +1,108 @@
+/** LU factorization of system matrices
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <iostream>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/Solver.h>
+
+namespace DPsim {
+	/// Fill-reducing column permutation of a sparse system matrix
+	using SparseOrdering = Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>;
+	/// Right sides or solutions of several systems with one column per system.
+	/// The values of one unknown are contiguous, so the substitutions process
+	/// all systems with each entry of the factors.
+	using BatchMatrix = Eigen::Matrix<Real, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+	/// LU factorization of a system matrix which is stored either dense or sparse.
+	///
+	/// Sparse matrices are permuted with a column ordering which is computed
+	/// beforehand by computeOrdering(). All matrices sharing one nonzero pattern,
+	/// e.g. the system matrices of different switch states, can therefore reuse
+	/// the expensive part of the symbolic analysis.
+	///
+	/// Solving does not allocate memory if the result vector already has the
+	/// size of the right side. For sparse matrices, the factors are therefore
+	/// copied out of Eigen's supernodal storage, whose solve allocates a
+	/// work vector, and all permutations are applied in place.
+	class LUFactorization {
+	protected:
+		/// Storage format of the factorized matrix
+		Solver::MatrixType mType;
+		/// Dense LU decomposition with partial pivoting
+		CPS::LUFactorized mDenseLu;
+		/// Strictly lower triangular part of the sparse factor L with implicit unit diagonal
+		SparseMatrix mLower;
+		/// Upper triangular sparse factor U
+		SparseMatrix mUpper;
+		/// Row permutation applied to the right side before the triangular solves
+		std::vector<int> mRowPermutation;
+		/// Permutation applied to the result of the triangular solves,
+		/// which combines the column ordering with the one of the factorization
+		std::vector<int> mColPermutation;
+		/// First index of each cycle of mColPermutation
+		std::vector<int> mColPermutationCycles;
+
+		/// Used by subclasses which factorize the matrix themselves
+		LUFactorization(Solver::MatrixType type) : mType(type) { }
+		/// Write a short description or the dense factors
+		virtual void print(std::ostream& os) const;
+
+	public:
+		using Ptr = std::shared_ptr<LUFactorization>;
+
+		/// Factorize a dense system matrix
+		LUFactorization(const Matrix& mat);
+		/// Factorize a sparse system matrix using a precomputed column ordering
+		LUFactorization(const SparseMatrix& mat, const SparseOrdering& ordering);
+		virtual ~LUFactorization() { }
+
+		/// Compute a fill-reducing column ordering (COLAMD) for the pattern of a sparse matrix
+		static void computeOrdering(const SparseMatrix& mat, SparseOrdering& ordering);
+
+		/// Solve A * x = b for x. The result vector must not alias the right side.
+		virtual void solve(const Matrix& rhs, Matrix& lhs) const;
+		/// Solve A * x = b for x and return a new result vector
+		Matrix solve(const Matrix& rhs) const;
+		/// Solve A * X = B for all columns of B with one pass over the factors.
+		/// The result must not alias the right sides.
+		virtual void solveBatch(const BatchMatrix& rhs, BatchMatrix& lhs) const;
+
+		/// Write the factors of a sparse factorization to a checkpoint
+		void write(std::ostream& os) const;
+		/// Read the factors of a sparse factorization from a checkpoint
+		static Ptr read(std::istream& is);
+
+		// #### Getter ####
+		Solver::MatrixType type() const { return mType; }
+		virtual Int rows() const { return mType == Solver::MatrixType::Dense ? (Int) mDenseLu.rows() : (Int) mUpper.rows(); }
+		/// Approximate memory occupied by the factors in bytes
+		virtual std::size_t memorySize() const;
+
+		friend std::ostream& operator<<(std::ostream& os, const LUFactorization& lu);
+	};
+
+	std::ostream& operator<<(std::ostream& os, const LUFactorization& lu);
+}
@@ -0,0 +1,73 @@
+/** Low-rank update of an LU factorization
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/LUFactorization.h>
+
+namespace DPsim {
+	/// Solves a system matrix A + dA using the factorization of A, where
+	/// dA only touches a few rows and columns (Sherman-Morrison-Woodbury).
+	///
+	/// With I being the k touched indices, E the n x k selection of the
+	/// corresponding unit vectors and C = dA(I,I), the solution is
+	///   x = x0 - Z * (1 + C * Z(I,:))^-1 * C * x0(I)
+	/// with x0 = A^-1 * b and Z = A^-1 * E. Z and the product of the inverse
+	/// capacitance matrix with C are computed once per update, so each solve
+	/// costs one solve with A and O(n * k) additional operations and does not
+	/// allocate memory.
+	class LowRankUpdate {
+	protected:
+		/// Factorization of the base matrix A
+		LUFactorization::Ptr mBase;
+		/// Rows and columns touched by the correction
+		std::vector<UInt> mIndices;
+		/// Inverse capacitance matrix times the correction restricted to the touched indices
+		Matrix mCorrection;
+		/// Base solution for the unit vectors of the touched indices
+		Matrix mBaseSolutions;
+		/// Base solution at the touched indices
+		Matrix mTouched;
+		/// Coefficients of the base solutions subtracted from the base solution
+		Matrix mCoefficients;
+
+	public:
+		using Ptr = std::shared_ptr<LowRankUpdate>;
+
+		LowRankUpdate(LUFactorization::Ptr base) : mBase(base) { }
+
+		/// Number of rows and columns touched by a correction
+		static UInt rank(const SparseMatrix& correction);
+		/// Replace the correction to the base matrix.
+		/// A zero correction falls back to plain solves with the base factorization.
+		void update(const SparseMatrix& correction);
+		/// Solve (A + dA) * x = b for x. The result vector must not alias the right side.
+		void solve(const Matrix& rhs, Matrix& lhs);
+
+		// #### Getter ####
+		LUFactorization::Ptr base() const { return mBase; }
+		UInt rank() const { return (UInt) mIndices.size(); }
+	};
+}
@@ -21,27 +21,70 @@
 
 #pragma once
 
+#include <functional>
 #include <iostream>
 #include <vector>
 #include <list>
-#include <unordered_map>
-#include <bitset>
+#include <map>
+#include <typeindex>
+#include <unordered_set>
 
 #include <dpsim/Solver.h>
 #include <dpsim/DataLogger.h>
+#include <dpsim/LUFactorization.h>
+#include <dpsim/LRUCache.h>
+#include <dpsim/LowRankUpdate.h>
+#include <dpsim/PartitionedFactorization.h>
+#include <dpsim/SharedFactorizations.h>
+#include <dpsim/WorkerPool.h>
+#include <dpsim/PowerFlowSolver.h>
 #include <cps/Solver/MNASwitchInterface.h>
 #include <cps/SignalComponent.h>
 #include <cps/PowerComponent.h>
 
-#define SWITCH_NUM 32
-
 namespace DPsim {
 	/// Solver class using Modified Nodal Analysis (MNA).
 	template <typename VarType>
 	class MnaSolver : public Solver {
+	public:
+		/// States of all switches in the order of mSwitches, true if closed
+		using SwitchStatus = std::vector<Bool>;
+
+		/// Time step and switch states which select a system matrix
+		struct SystemKey {
+			Real timeStep;
+			SwitchStatus switchStatus;
+
+			bool operator==(const SystemKey& other) const {
+				return timeStep == other.timeStep && switchStatus == other.switchStatus;
+			}
+		};
+
+		struct SystemKeyHash {
+			std::size_t operator()(const SystemKey& key) const {
+				return std::hash<Real>()(key.timeStep) ^ (std::hash<SwitchStatus>()(key.switchStatus) << 1);
+			}
+		};
+
+		/// Solvers which are stepped in lockstep by stepBatch()
+		struct Batch {
+			std::vector<MnaSolver*> solvers;
+			/// Time of the step of each solver
+			std::vector<Real> times;
+			/// Time of the next step of each solver, set by stepBatch()
+			std::vector<Real> nextTimes;
+			/// Solver indices grouped by their factorization
+			std::vector<UInt> order;
+			/// Right sides and solutions of a group, one column per solver
+			BatchMatrix rightSides;
+			BatchMatrix leftSides;
+		};
+
 	protected:
 		// General simulation settings
-		/// System time step is constant for MNA solver
+		/// Name which is used for the logs
+		String mName;
+		/// System time step, which can be changed between steps with setTimeStep()
 		Real mTimeStep;
 		/// Simulation domain, which can be dynamic phasor (DP) or EMT
 		CPS::Domain mDomain;
@@ -71,23 +114,127 @@ namespace DPsim {
 		///
 		CPS::SignalComponent::List mSignalComponents;
 
+		/// Power components of one concrete type which are stepped in one loop
+		struct ComponentBatch {
+			std::type_index type;
+			/// Type name used for logging
+			String name;
+			/// Components owned by mPowerComponents
+			std::vector<CPS::MNAInterface*> components;
+			/// False if mnaStep does not contribute to the right side vector
+			Bool step;
+		};
+		/// Power components grouped by type in the order of first appearance
+		std::vector<ComponentBatch> mComponentBatches;
+
+		// #### Attributes related to parallel steps ####
+		/// Number of threads which step the components
+		UInt mThreads = 1;
+		/// CPUs to pin the threads to
+		std::vector<Int> mThreadCpus;
+		/// Workers which step the components and solve the blocks of a
+		/// partitioned system if more than one thread is used
+		std::shared_ptr<WorkerPool> mWorkerPool;
+		/// Components with a step in the order of the batches, which include the switches.
+		/// Each worker steps a fixed contiguous range of them.
+		std::vector<CPS::MNAInterface*> mSteppedComponents;
+		/// Components with a post-step in the order of the batches
+		std::vector<CPS::MNAInterface*> mPostSteppedComponents;
+		/// Right side vectors of the workers, the first worker uses mRightSideVector
+		std::vector<Matrix> mWorkerRightSideVectors;
+		/// Time of the current step passed to the worker tasks
+		Real mStepTime = 0;
+		/// Task which steps the components of a worker
+		WorkerPool::Task mStepTask;
+		/// Task which post-steps the components of a worker
+		WorkerPool::Task mPostStepTask;
+
+		// #### Attributes related to the partitioned factorization ####
+		/// Tear the system into blocks which are factorized and solved independently
+		Bool mPartitioned = false;
+		/// Requested number of blocks, see PartitionedFactorization::computePartition()
+		UInt mPartitions = 0;
+		/// Nodes and components whose nodes belong to the interface of the blocks
+		std::vector<String> mTearingObjects;
+		/// Block of each unknown or -1 for the interface, shared by all system matrices
+		std::vector<Int> mPartition;
+
 		// #### MNA specific attributes ####
-		/// System matrix A that is modified by matrix stamps
-		std::bitset<SWITCH_NUM> mCurrentSwitchStatus;
-		/// Temporary system matrix, i.e. for initialization
+		/// Current switch states which select the system matrix
+		SwitchStatus mCurrentSwitchStatus;
+		/// Dense system matrix which was stamped last. Sparse and partitioned
+		/// systems are stamped into mSparseSystemMatrix instead and pass this
+		/// matrix empty to mnaStep(), so their components must not access the
+		/// system matrix in their steps. See checkStepSystemMatrix().
 		Matrix mTmpSystemMatrix;
+		/// Sparse system matrix which was stamped last
+		SparseMatrix mSparseSystemMatrix;
+		/// Matrix which covers the nodes of one component, see collectStamp()
+		Matrix mStampMatrix;
+		/// Factorization used by solve() for the current switch status
+		LUFactorization::Ptr mActiveLuFactorization;
 		/// LU decomposition of system matrix A
-		CPS::LUFactorized mTmpLuFactorization;
+		LUFactorization::Ptr mTmpLuFactorization;
+		/// Storage format of the system matrices and their factorizations
+		Solver::MatrixType mMatrixType = Solver::MatrixType::Dense;
+		/// Fill-reducing column ordering shared by all sparse system matrices
+		SparseOrdering mSparseOrdering;
+		/// Factorizations shared with the solvers of equal systems, may be null
+		SharedFactorizations::Ptr mSharedFactorizations;
 		/// Source vector of known quantities
 		Matrix mRightSideVector;
 		/// Solution vector of unknown quantities
 		Matrix mLeftSideVector;
+		/// LU factorizations of the time steps and switch states visited so far.
+		/// They are created on demand and the least recently used ones are evicted.
+		LRUCache<SystemKey, LUFactorization::Ptr, SystemKeyHash> mLuFactorizations;
+		/// Apply switch changes as low-rank corrections to a base factorization
+		Bool mLowRankSwitchUpdates = false;
+		/// Maximum rank of the correction before the base factorization is replaced
+		UInt mMaxUpdateRank = 16;
+		/// Change of the system matrix caused by closing each switch
+		std::vector<SparseMatrix> mSwitchClosingStamps;
+		/// Switch status of the base factorization used for low-rank updates
+		SwitchStatus mBaseSwitchStatus;
+		/// Base factorization and correction for the current switch status
+		LowRankUpdate::Ptr mLowRankUpdate;
+
+		// #### Attributes related to variable time steps ####
+		/// Compute the change of the solution in each step
+		Bool mTrackSolutionChange = false;
+		/// Solution of the previous step
+		Matrix mPreviousLeftSideVector;
+		/// Largest change of the solution in the last step relative to its largest value
+		Real mSolutionChange = 0;
+		/// Steps which allocated memory without a switch status change,
+		/// only counted if built with WITH_ALLOCATION_COUNTER
+		UInt mAllocatingSteps = 0;
+
+		/// Checkpoint which is restored by initialize()
+		std::istream* mCheckpoint = nullptr;
+
+		// #### Attributes related to steady-state initialization ####
 		/// Switch to trigger steady-state initialization
 		Bool mSteadyStateInit = false;
-		/// Map of system matrices where the key is the bitset describing the switch states
-		std::unordered_map< std::bitset<SWITCH_NUM>, Matrix > mSwitchedMatrices;
-		/// Map of LU factorizations related to the system matrices
-		std::unordered_map< std::bitset<SWITCH_NUM>, CPS::LUFactorized > mLuFactorizations;
+		/// Method of the steady-state initialization
+		Solver::SteadyStateMethod mSteadyStateMethod = Solver::SteadyStateMethod::TimeStepping;
+		/// Relative change of the solution below which the steady state is reached
+		Real mSteadyStateTolerance = 1e-4;
+		/// Maximum number of iterations or time steps, zero selects the default of the method
+		UInt mSteadyStateMaxIterations = 0;
+		/// Log the left and right side vectors of the steady-state initialization
+		Bool mSteadyStateLogging = false;
+
+		// #### Attributes related to the power flow ####
+		/// Bus specifications of the power flow by node name
+		std::map<String, PowerFlowSolver::Bus> mPowerFlowBuses;
+		/// Components whose power is given by the bus specifications.
+		/// They are not part of the admittance matrix.
+		std::unordered_set<String> mPowerFlowInjections;
+		/// Relative power mismatch of the power flow
+		Real mPowerFlowTolerance = 1e-8;
+		/// Maximum number of Newton-Raphson iterations
+		UInt mPowerFlowMaxIterations = 20;
 
 		// #### Attributes related to switching ####
 		/// Index of the next switching event
@@ -108,13 +255,11 @@ namespace DPsim {
 		DataLogger mLeftVectorLog;
 		/// Right side vector logger
 		DataLogger mRightVectorLog;
-		/// Left side vector logger for initialization
-		DataLogger mInitLeftVectorLog;
-		/// Right side vector logger for initialization
-		DataLogger mInitRightVectorLog;
+		/// Left side vector logger for initialization, if enabled
+		DataLogger::Ptr mInitLeftVectorLog;
+		/// Right side vector logger for initialization, if enabled
+		DataLogger::Ptr mInitRightVectorLog;
 
-		/// TODO: check that every system matrix has the same dimensions
-		void initialize(CPS::SystemTopology system);
 		/// Identify Nodes and PowerComponents and SignalComponents
 		void identifyTopologyObjects();
 		///
@@ -124,16 +269,95 @@ namespace DPsim {
 		/// Creates virtual nodes inside components.
 		/// The MNA algorithm handles these nodes in the same way as network nodes.
 		void createVirtualNodes();
-		// TODO: check if this works with AC sources
+		/// Bring the DP system to its periodic steady state before the simulation
 		void steadyStateInitialization();
+		/// Step the system with the simulation time step until the solution settles
+		void timeSteppingSteadyStateInitialization();
+		/// Solve for the steady-state phasors and iterate on the node voltages
+		/// if components depend on them. Only valid in the DP domain.
+		void directSteadyStateInitialization();
+		/// Initialize the MNA specific parts of the components for a time step
+		void mnaInitializeComponents(Real timeStep);
+		/// Stamp and factorize the system matrix used by the initialization
+		void createInitSystemMatrix();
+		/// Step the system during the initialization and log the vectors
+		void initStep(Real time, Real logTime);
+		/// Initialize the power components from the initial node voltages
+		void initializeFromPowerflow();
+		/// Solve the power flow of the network and use the result as
+		/// initial node voltages. The components are left initialized
+		/// for the simulation time step.
+		void solvePowerFlow();
+		/// Use the network node voltages of a solution as initial voltages
+		void setInitialNodeVoltages(const Matrix& leftSideVector);
 		/// Create left and right side vector
 		void createEmptyVectors();
 		/// Create system matrix
 		void createEmptySystemMatrix();
+		/// Group power components by their concrete type
+		void createComponentBatches();
+		/// Create the workers and their tasks if more than one thread is used
+		void createWorkerPool();
+		/// Component types which are not stepped, see addTypeWithoutStep()
+		static std::unordered_set<std::type_index>& typesWithoutStep();
+		/// Nonzero entries of system matrix stamps
+		using StampEntries = std::vector<Eigen::Triplet<Real>>;
+		/// Components stamp into mTmpSystemMatrix instead of mSparseSystemMatrix
+		Bool denseSystem() const {
+			return mMatrixType == Solver::MatrixType::Dense && !mPartitioned;
+		}
+		/// Add the entries which a component stamps into the system matrix.
+		/// Components only stamp into dense matrices at the indices of their
+		/// nodes. To pass a matrix which only covers these nodes, the terminal
+		/// and virtual nodes of the component are numbered from zero during the
+		/// stamp and renumbered afterwards. Components therefore have to look up
+		/// the indices of their nodes when stamping instead of caching them.
+		/// Objects which are no power components stamp a matrix of the whole
+		/// system, so sparse systems must not contain them, see checkSparseStamps().
+		void collectStamp(CPS::MNAInterface::Ptr comp,
+			const std::function<void(Matrix&)>& stamp, StampEntries& entries);
+		/// Stamp sparse and partitioned systems dense if they contain objects
+		/// whose nodes are unknown, as collectStamp() cannot localize their stamps
+		void checkSparseStamps();
+		/// Throw if a component resized the empty system matrix passed to
+		/// mnaStep() by sparse and partitioned systems
+		void checkStepSystemMatrix() const;
+		/// Stamp the system matrix for the current time step with the switches
+		/// in the given states or in their own states if status is null
+		void stampSystemMatrix(const SwitchStatus* status);
+		/// Factorize the system matrix which was stamped last
+		LUFactorization::Ptr factorizeSystemMatrix();
+		/// Stamp and factorize the system matrix for the current time step and the given switch state
+		LUFactorization::Ptr createSwitchedFactorization(const SwitchStatus& status);
+		/// Returns the cached factorization for the current time step and the given switch state or creates it
+		LUFactorization::Ptr switchedFactorization(const SwitchStatus& status);
+		/// Compute the system matrix change caused by closing each switch
+		void createSwitchClosingStamps();
+		/// Indices of the unknowns of the tearing nodes and components
+		std::vector<Int> tornUnknowns();
+		/// Restore the node voltages and component attributes of a checkpoint.
+		/// Returns the stored factorization if it belongs to the restored switch states.
+		LUFactorization::Ptr restoreCheckpoint(std::istream& is);
+		/// Update the low-rank correction after a switch status change or
+		/// refactorize if the rank of the correction exceeds mMaxUpdateRank
+		void updateLowRankCorrection();
+		/// Factorize a dense system matrix
+		LUFactorization::Ptr factorize(const Matrix& mat);
+		/// Factorize a sparse system matrix using the shared column ordering
+		/// or the partition
+		LUFactorization::Ptr factorize(const SparseMatrix& mat);
 		/// Solve system matrices
 		void solve();
-		///
-		void updateSwitchStatus();
+		/// Step the components which stamp the right side vector of a step
+		void prepareStep(Real time);
+		/// Update the components and nodes with the solution of a step.
+		/// Returns the time of the next step.
+		Real finishStep(Real time);
+		/// Read the switch states and select the matching factorization.
+		/// Returns true if any switch changed its state.
+		Bool updateSwitchStatus();
+		/// Format switch states for logging
+		static String switchStatusString(const SwitchStatus& status);
 	public:
 		/// This constructor should not be called by users.
 		MnaSolver(String name,
@@ -141,6 +365,7 @@ namespace DPsim {
 			CPS::Domain domain = CPS::Domain::DP,
 			CPS::Logger::Level logLevel = CPS::Logger::Level::INFO,
 			Bool steadyStateInit = false, Int downSampleRate = 1) :
+			mName(name),
 			mTimeStep(timeStep),
 			mDomain(domain),
 			mSteadyStateInit(steadyStateInit),
@@ -148,9 +373,7 @@ namespace DPsim {
 			mLogLevel(logLevel),
 			mLog(name + "_MNA", logLevel),
 			mLeftVectorLog(name + "_LeftVector", logLevel != CPS::Logger::Level::NONE),
-			mRightVectorLog(name + "_RightVector", logLevel != CPS::Logger::Level::NONE),
-			mInitLeftVectorLog(name + "_InitLeftVector", logLevel != CPS::Logger::Level::NONE),
-			mInitRightVectorLog(name + "_InitRightVector", logLevel != CPS::Logger::Level::NONE)
+			mRightVectorLog(name + "_RightVector", logLevel != CPS::Logger::Level::NONE)
 		{ }
 
 		/// Constructor to be used in simulation examples.
@@ -168,8 +391,33 @@ namespace DPsim {
 		///
 		virtual ~MnaSolver() { };
 
+		/// TODO: check that every system matrix has the same dimensions
+		void initialize(CPS::SystemTopology system);
+
 		/// Solve system A * x = z for x and current time
 		Real step(Real time);
+		/// Step solvers in lockstep. Solvers whose active factorization is the
+		/// same object, e.g. because their equal system matrices are looked up
+		/// in shared factorizations, solve their right sides as one block with
+		/// one pass over the factors. All other solvers solve on their own.
+		static void stepBatch(Batch& batch);
+		/// Fault in the system vectors, matrices and log buffers
+		void prefault();
+		/// Initialize the components for a new time step and select the
+		/// factorization for it, which is cached like the ones of switch states.
+		/// The components keep their state, e.g. the currents of inductors.
+		/// Returns false and keeps the previous time step if the time step is
+		/// not positive or the components cannot be stamped for it.
+		Bool setTimeStep(Real timeStep);
+		/// Compute solutionChange() after each step
+		void setTrackSolutionChange(Bool track);
+		/// Write the node voltages, all component attributes of supported types and
+		/// optionally the sparse factorization of the current switch states.
+		void saveCheckpoint(std::ostream& os, Bool factorizations) const;
+		Real solutionChange() const { return mSolutionChange; }
+		/// Number of steps which allocated memory although the switch status
+		/// did not change. Always zero unless built with WITH_ALLOCATION_COUNTER.
+		UInt allocatingSteps() const { return mAllocatingSteps; }
 		/// Log left and right vector values for each simulation step
 		void log(Real time) {
 			if (mDomain == CPS::Domain::EMT) {
@@ -184,7 +432,97 @@ namespace DPsim {
 		// #### Getter ####
 		Matrix& leftSideVector() { return mLeftSideVector; }
 		Matrix& rightSideVector() { return mRightSideVector; }
+		/// Dense system matrix, empty for sparse and partitioned systems
 		Matrix& systemMatrix() { return mTmpSystemMatrix; }
+		/// Sparse system matrix, empty for dense systems
+		const SparseMatrix& sparseSystemMatrix() const { return mSparseSystemMatrix; }
+
+		/// Register a component type whose mnaStep does not contribute to the
+		/// right side vector, e.g. because it only stamps the system matrix.
+		/// Components of this type are skipped when stepping the system.
+		template <typename ComponentType>
+		static void addTypeWithoutStep() {
+			typesWithoutStep().insert(typeid(ComponentType));
+		}
+
+		// #### Setter ####
+		/// Select dense or sparse system matrices. Must be called before initialize().
+		void setSystemMatrixType(Solver::MatrixType type) { mMatrixType = type; }
+		/// Limit the number of cached switch state factorizations and their memory in bytes.
+		/// A limit of zero disables the respective check.
+		void setFactorizationCacheLimits(UInt maxEntries, std::size_t maxSize) {
+			mLuFactorizations.setLimits(maxEntries, maxSize);
+		}
+		/// Write the left and right side vector logs on background threads.
+		/// Must be called before initialize().
+		void setAsyncLogging(UInt capacity, DataLogger::OverflowPolicy policy) {
+			mLeftVectorLog.setAsync(capacity, policy);
+			mRightVectorLog.setAsync(capacity, policy);
+		}
+		/// Step the components on multiple threads, optionally pinned to the given CPUs.
+		/// The calling thread keeps its affinity, see WorkerPool().
+		/// Must be called before initialize().
+		void setThreads(UInt threads, const std::vector<Int>& cpus = {}) {
+			mThreads = threads;
+			mThreadCpus = cpus;
+		}
+		/// Factorize the system as independent sparse blocks, which are coupled
+		/// by the unknowns of the tearing nodes and all nodes of the tearing
+		/// components, e.g. lines. Further tearing nodes are chosen until there
+		/// are the given number of blocks, zero only tears at the given objects.
+		/// The blocks are solved by the threads of setThreads().
+		/// Must be called before initialize().
+		void setPartitioning(UInt blocks, const std::vector<String>& tearingObjects = {}) {
+			mPartitioned = true;
+			mPartitions = blocks;
+			mTearingObjects = tearingObjects;
+		}
+		/// Look up the system matrices in factorizations which are shared with
+		/// other solvers before factorizing them. Must be called before initialize().
+		void setSharedFactorizations(SharedFactorizations::Ptr factorizations) {
+			mSharedFactorizations = factorizations;
+		}
+		/// Restore the state written by saveCheckpoint() in initialize() instead
+		/// of solving the power flow and the steady state. The stream is read
+		/// by initialize() and has to stay open until then. The time step of
+		/// the checkpoint replaces the one of the solver.
+		void setCheckpoint(std::istream& is) { mCheckpoint = &is; }
+		/// Configure the steady-state initialization. A maxIterations of zero
+		/// selects 50 iterations of the direct method or 10 s of time steps.
+		/// The direct method requires the DP domain, other domains fall back
+		/// to time stepping, which is also the default.
+		/// Logging writes the vectors of each iteration to "<name>_InitLeftVector"
+		/// and "<name>_InitRightVector". Must be called before initialize().
+		void setSteadyStateInitialization(Solver::SteadyStateMethod method,
+			Real tolerance = 1e-4, UInt maxIterations = 0, Bool logging = false) {
+			mSteadyStateMethod = method;
+			mSteadyStateTolerance = tolerance;
+			mSteadyStateMaxIterations = maxIterations;
+			mSteadyStateLogging = logging;
+		}
+		/// Specify a bus of the power flow which is solved before the components are
+		/// initialized. The power of the given components, e.g. generators and
+		/// loads, is represented by the bus, so they are not part of the admittance
+		/// matrix. Nodes without specification are PQ buses without injection.
+		/// Components with virtual nodes, e.g. voltage sources, have to be given
+		/// as injections. Must be called before initialize().
+		void addPowerFlowBus(const String &node, PowerFlowSolver::Bus bus,
+			const std::vector<String> &components = {}) {
+			mPowerFlowBuses[node] = bus;
+			mPowerFlowInjections.insert(components.begin(), components.end());
+		}
+		/// Set the relative power mismatch and the iteration limit of the power flow
+		void setPowerFlowSettings(Real tolerance, UInt maxIterations) {
+			mPowerFlowTolerance = tolerance;
+			mPowerFlowMaxIterations = maxIterations;
+		}
+		/// Keep one base factorization and apply switch changes as low-rank corrections.
+		/// The matrix is refactorized when more than maxRank rows and columns differ
+		/// from the base. Must be called before initialize().
+		void setLowRankSwitchUpdates(Bool enable, UInt maxRank = 16) {
+			mLowRankSwitchUpdates = enable;
+			mMaxUpdateRank = maxRank;
+		}
 	};
 
 
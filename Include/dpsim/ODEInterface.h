@@ -0,0 +1,52 @@
+/** Interface of components with a state-space model
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <memory>
+
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// Interface of components whose dynamics are given by a state-space
+	/// model dy/dt = f(t, y), which is integrated by the ODESolver.
+	class ODEInterface {
+	public:
+		using Ptr = std::shared_ptr<ODEInterface>;
+
+		virtual ~ODEInterface() { }
+
+		/// Number of state variables
+		virtual UInt odeStates() = 0;
+		/// Write the states at the beginning of a step. They may have been
+		/// changed since the last step, e.g. by events or inputs.
+		virtual void odePreStep(Real state[]) = 0;
+		/// Compute the derivatives of the states
+		virtual void odeStateSpace(Real time, const Real state[], Real dstate_dt[]) = 0;
+		/// Take the states at the end of a step
+		virtual void odePostStep(Real time, const Real state[]) = 0;
+
+		/// True if odeJacobian() is implemented
+		virtual Bool odeHasJacobian() { return false; }
+		/// Write df/dy column-major to jacobian, whose columns are stride apart
+		virtual void odeJacobian(Real time, const Real state[], Real jacobian[], Int stride) { }
+	};
+}
@@ -1,4 +1,4 @@
-/** DAE Solver
+/** ODE Solver
  *
  * @file
  * @author Markus Mirz <mmirz@eonerc.rwth-aachen.de>
@@ -23,9 +23,14 @@
 
 #pragma once
 
+#include <dpsim/Config.h>
+
 #ifdef WITH_SUNDIALS
 
+#include <vector>
+
 #include <dpsim/Solver.h>
+#include <dpsim/ODEInterface.h>
 #include <cps/SystemTopology.h>
 #include <cps/Logger.h>
 
@@ -48,17 +53,27 @@
 using namespace CPS;
 
 namespace DPsim {
-	/// Solver class for ODE (Ordinary Differential Equation) systems
+	/// \brief Solver class for ODE (Ordinary Differential Equation) systems.
+	///
+	/// Integrates the state-space models of all components which implement
+	/// ODEInterface with ARKode. The integrator, its vectors and the linear
+	/// solver of the implicit method are created once. Each step restarts
+	/// the integrator from the current states of the components with
+	/// ARKodeReInit, which reuses all memory.
 	class ODESolver: public Solver {
 	protected:
 		/// Constant time step
-		Real mTimestep;
+		Real mTimeStep;
 		/// Components of the solver
-		Component::List mComponents;
+		std::vector<ODEInterface::Ptr> mComponents;
+		/// Index of the first state of each component
+		std::vector<Int> mOffsets;
+		/// Use an implicit method, e.g. for stiff systems
+		Bool mImplicit;
 
 		// ### General problem variables ###
 		/// Dimension of differential variables
-  		sunindextype mProbDim;
+		sunindextype mProbDim = 0;
 		// reusable error-checking flag
 		int flag;
 		// vector for storing solution
@@ -74,21 +89,31 @@ namespace DPsim {
 		/// Scalar absolute tolerance
 		realtype abstol = RCONST(1.0e-10);
 
+		/// Right-hand side of the entire system
+		int StateSpace(realtype t, N_Vector y, N_Vector ydot);
+		/// Block-diagonal Jacobian of the entire system
+		int Jacobian(realtype t, N_Vector y, N_Vector fy, SUNMatrix J);
+		/// Create the integrator and the linear solver of the implicit method
+		void initialize(Real t0);
+		/// Free the integrator, its vectors and the linear solver
+		void release();
+
 	public:
-		/// Create solve object with given parameters
-		ODESolver(String name, SystemTopology system, Real dt, Real t0);
+		/// Create the integrator for the ODE components of the system.
+		/// Throws SolverException if ARKode cannot be set up.
+		ODESolver(String name, SystemTopology system, Real dt, Real t0, Bool implicit = false);
 		/// Deallocate all memory
 		~ODESolver();
 
 		/// use wrappers similar to DAE_Solver
-    	static int StateSpaceWrapper(realtype t, N_Vector y, N_Vector ydot, void *user_data);
-    	// neeeded for implicit solve:
-    	static int JacobianWrapper(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
-            N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
-    	/// ARKode- standard error detection function; in DAE-solver not detection function is used -> for efficiency purposes?
+		static int StateSpaceWrapper(realtype t, N_Vector y, N_Vector ydot, void *user_data);
+		// neeeded for implicit solve:
+		static int JacobianWrapper(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
+			N_Vector tmp1, N_Vector tmp2, N_Vector tmp3);
+		/// ARKode- standard error detection function; in DAE-solver not detection function is used -> for efficiency purposes?
 		static int check_flag(void *flagvalue, const std::string funcname, int opt);
-		///
-    	int solve(Real initial_time, bool implicit);
+		/// Integrate the states of the components over one time step
+		Real step(Real time);
 	};
 }
 #endif // WITH_SUNDIALS
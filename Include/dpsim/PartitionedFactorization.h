@@ -0,0 +1,124 @@
+/** Partitioned LU factorization
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/LUFactorization.h>
+#include <dpsim/WorkerPool.h>
+
+namespace DPsim {
+	/// \brief Factorization of a system matrix which is torn into independent blocks.
+	///
+	/// The unknowns are divided into blocks, which are only coupled with each
+	/// other through a set of interface unknowns, e.g. the voltages of tearing
+	/// nodes. With the unknowns ordered block by block and the interface last,
+	/// the matrix has a bordered block-diagonal form:
+	///
+	///     | A_1         B_1 |
+	///     |     ...     ... |
+	///     |         A_k B_k |
+	///     | C_1 ... C_k  D  |
+	///
+	/// Each block A_i is factorized on its own. The interface unknowns are
+	/// solved with the Schur complement S = D - sum_i C_i A_i^-1 B_i. A solve
+	/// computes y_i = A_i^-1 b_i, x_s = S^-1 (b_s - sum_i C_i y_i) and
+	/// x_i = y_i - A_i^-1 B_i x_s. The block solves are distributed over the
+	/// workers of a pool, the interface system is solved by the calling thread.
+	class PartitionedFactorization : public LUFactorization {
+	protected:
+		struct Block {
+			/// Indices of the unknowns of the block in the system
+			std::vector<Int> unknowns;
+			/// Sparse factorization of the diagonal block A_i
+			LUFactorization::Ptr lu;
+			/// Coupling C_i of the interface with the block
+			SparseMatrix toInterface;
+			/// Response A_i^-1 B_i of the block to the interface unknowns
+			Matrix coupling;
+			/// Right side and solution of the block in the current solve
+			mutable Matrix rhs;
+			mutable Matrix solution;
+		};
+
+		/// Dimension of the system
+		Int mRows;
+		/// Decoupled blocks of the system
+		std::vector<Block> mBlocks;
+		/// Indices of the interface unknowns in the system
+		std::vector<Int> mInterface;
+		/// Dense LU decomposition of the Schur complement
+		CPS::LUFactorized mInterfaceLu;
+		/// Right side and solution of the interface in the current solve
+		mutable Matrix mInterfaceRhs;
+		mutable Matrix mInterfaceSolution;
+		/// Workers which solve the blocks, may be null
+		std::shared_ptr<WorkerPool> mWorkerPool;
+		/// Arguments of the current solve passed to the worker tasks
+		mutable const Matrix* mRhs = nullptr;
+		mutable Matrix* mLhs = nullptr;
+		mutable Int mCol = 0;
+		/// Column-major copies of the arguments of solveBatch()
+		mutable Matrix mBatchRhs;
+		mutable Matrix mBatchLhs;
+		/// Task which solves the blocks of a worker for their own right sides
+		WorkerPool::Task mForwardTask;
+		/// Task which corrects the block solutions of a worker for the interface solution
+		WorkerPool::Task mBackwardTask;
+
+		/// Returns the begin and end of the blocks processed by a worker
+		std::pair<UInt, UInt> blockRange(UInt worker) const;
+		/// Run a task on the workers or, without workers, on the calling thread
+		void run(const WorkerPool::Task& task) const;
+		void print(std::ostream& os) const;
+
+	public:
+		using Ptr = std::shared_ptr<PartitionedFactorization>;
+		using LUFactorization::solve;
+
+		/// Factorize a sparse system matrix. The partition assigns each unknown
+		/// to a block or to the interface (-1). Throws SolverException if
+		/// unknowns of different blocks are coupled or a block is singular.
+		PartitionedFactorization(const SparseMatrix& mat, const std::vector<Int>& partition,
+			std::shared_ptr<WorkerPool> workerPool = nullptr);
+
+		/// Assign the unknowns to at most the given number of blocks. The torn
+		/// unknowns always belong to the interface. While there are fewer blocks
+		/// than requested, the largest one is split by a level set of a
+		/// breadth-first search, whose unknowns are added to the interface.
+		/// Zero blocks keeps one block per connected part of the torn system.
+		static void computePartition(const SparseMatrix& mat, const std::vector<Int>& torn,
+			UInt blocks, std::vector<Int>& partition);
+
+		void solve(const Matrix& rhs, Matrix& lhs) const;
+		/// Solves the columns one after another, as the blocks are solved column-wise
+		void solveBatch(const BatchMatrix& rhs, BatchMatrix& lhs) const;
+
+		// #### Getter ####
+		Int rows() const { return mRows; }
+		std::size_t memorySize() const;
+		UInt blocks() const { return (UInt) mBlocks.size(); }
+		UInt interfaceSize() const { return (UInt) mInterface.size(); }
+	};
+}
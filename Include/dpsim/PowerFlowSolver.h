@@ -0,0 +1,97 @@
+/** Newton-Raphson power flow
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// \brief Newton-Raphson power flow in polar coordinates.
+	///
+	/// The unknowns are the voltage angles of all PQ and PV buses and the
+	/// voltage magnitudes of the PQ buses. The Jacobian has the nonzero
+	/// pattern of the admittance matrix, so its fill-reducing ordering is
+	/// computed in the first iteration and reused by the following ones.
+	/// Buses without admittance are not solved and keep a zero voltage.
+	class PowerFlowSolver {
+	public:
+		enum class BusType { PQ, PV, Slack };
+
+		/// Specification of a bus. Powers are injected into the network,
+		/// i.e. generation is positive and consumption negative.
+		struct Bus {
+			BusType type = BusType::PQ;
+			/// Active power for PQ and PV buses
+			Real P = 0;
+			/// Reactive power for PQ buses
+			Real Q = 0;
+			/// Voltage magnitude for PV and slack buses
+			Real V = 0;
+			/// Voltage angle for the slack bus
+			Real angle = 0;
+		};
+
+	protected:
+		/// Bus admittance matrix
+		SparseMatrixComp mAdmittance;
+		/// Bus specifications in the order of the admittance matrix
+		std::vector<Bus> mBuses;
+		/// Bus voltages
+		MatrixComp mVoltages;
+		/// Index of the angle and the power balance of each bus in the
+		/// Jacobian and the mismatch vector, -1 if not solved
+		std::vector<Int> mAngleIndices;
+		/// Index of the magnitude and the reactive power balance of each
+		/// bus, -1 if the magnitude is not solved
+		std::vector<Int> mMagnitudeIndices;
+		/// Number of unknowns
+		UInt mNumUnknowns = 0;
+		/// Power which the mismatch is relative to
+		Real mBasePower = 1;
+		/// Relative power mismatch after the last iteration
+		Real mMismatch = 0;
+		/// Number of iterations of the last solve
+		UInt mIterations = 0;
+
+		/// Compute the complex power injections of the current voltages
+		MatrixComp powers() const;
+		/// Compute the Jacobian of the power balances for the current voltages
+		void jacobian(const MatrixComp& currents, SparseMatrix& jac) const;
+
+	public:
+		PowerFlowSolver(const SparseMatrixComp& admittance, const std::vector<Bus>& buses);
+
+		/// Run Newton-Raphson iterations until the largest power mismatch
+		/// relative to the largest specified power is below the tolerance.
+		/// Returns false if maxIterations are exceeded.
+		Bool solve(Real tolerance = 1e-8, UInt maxIterations = 20);
+
+		// #### Getter ####
+		const MatrixComp & voltages() const { return mVoltages; }
+		/// Complex power injected at each bus
+		MatrixComp injections() const { return powers(); }
+		Real mismatch() const { return mMismatch; }
+		UInt iterations() const { return mIterations; }
+	};
+}
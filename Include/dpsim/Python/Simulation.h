@@ -77,6 +77,7 @@ namespace Python {
 		bool realTime;
 		bool startSync;
 		bool failOnOverrun;
+		bool busyWait; /// Poll the clock before each tick instead of blocking
 		bool singleStepping; /// Debugger like stepping for simulations
 
 		Timer::StartTimePoint startTime;
@@ -103,6 +104,8 @@ namespace Python {
 		static PyObject* addInterface(Simulation *self, PyObject *args, PyObject *kwargs);
 		static PyObject* addLogger(Simulation* self, PyObject* args, PyObject *kwargs);
 		static PyObject* addEvent(Simulation* self, PyObject* args);
+		static PyObject* loadEvents(Simulation* self, PyObject* args);
+		static PyObject* setTimeStep(Simulation* self, PyObject* args, PyObject *kwargs);
 		static PyObject* pause(Simulation *self, PyObject *args);
 		static PyObject* start(Simulation *self, PyObject *args);
 		static PyObject* step(Simulation *self, PyObject *args);
@@ -116,6 +119,7 @@ namespace Python {
 		static PyObject* steps(Simulation *self, void *ctx);
 		static PyObject* time(Simulation *self, void *ctx);
 		static PyObject* finalTime(Simulation *self, void *ctx);
+		static PyObject* latencies(Simulation *self, void *ctx);
 
 		static const char *doc;
 		static const char *docStart;
@@ -124,11 +128,14 @@ namespace Python {
 		static const char *docStep;
 		static const char *docAddInterface;
 		static const char *docAddEvent;
+		static const char *docLoadEvents;
+		static const char *docSetTimeStep;
 		static const char *docAddLogger;
 		static const char *docAddEventFD;
 		static const char *docRemoveEventFD;
 		static const char *docState;
 		static const char *docName;
+		static const char *docLatencies;
 		static PyMethodDef methods[];
 		static PyGetSetDef getset[];
 		static PyTypeObject type;
@@ -0,0 +1,50 @@
+/** Real-time execution environment
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include <dpsim/Config.h>
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// Settings of the execution environment of a real-time simulation.
+	/// They are applied to the simulation thread before the first tick.
+	struct RealTimeSettings {
+		/// CPUs the simulation thread may run on, all if empty
+		std::vector<Int> cpus;
+		/// SCHED_FIFO priority of the simulation thread, zero keeps the current policy
+		Int priority = 0;
+		/// Lock all current and future pages of the process into memory
+		Bool lockMemory = false;
+		/// Number of bytes of stack to fault in
+		std::size_t prefaultStack = 0;
+
+		/// Apply the settings to the calling thread.
+		/// Returns a description of each setting which could not be applied.
+		std::vector<String> apply() const;
+	};
+
+	/// Write to each page of the memory region, so that it is mapped
+	/// before the real-time loop starts. The contents stay unchanged.
+	void prefaultMemory(const void *begin, std::size_t size);
+}
@@ -26,6 +26,7 @@
 #include <chrono>
 
 #include <dpsim/Config.h>
+#include <dpsim/RealTime.h>
 #include <dpsim/Simulation.h>
 #include <dpsim/Timer.h>
 
@@ -36,6 +37,8 @@ namespace DPsim {
 	protected:
 		Real mTimeStep;
 		Timer mTimer;
+		/// Execution environment of the simulation thread
+		RealTimeSettings mRealTimeSettings;
 
 	public:
 		/// Creates system matrix according to a given System topology
@@ -53,6 +56,18 @@ namespace DPsim {
 		void run(const Timer::StartClock::duration &startIn = std::chrono::seconds(1));
 
 		void run(const Timer::StartClock::time_point &startAt);
+
+		/// Select how the simulation waits for the next time step
+		void setTimerMode(Timer::Mode mode) { mTimer.setMode(mode); }
+		/// Set CPU affinity, scheduling priority and memory locking of the simulation thread
+		void setRealTimeSettings(const RealTimeSettings &settings) { mRealTimeSettings = settings; }
+
+		/** Apply the real-time settings to the calling thread and fault in the
+		 * memory of the solver and the loggers. Called by run() before the timer starts.
+		 *
+		 * @returns A description of each setting which could not be applied.
+		 */
+		std::vector<String> prepare();
 	};
 }
 
@@ -0,0 +1,74 @@
+/** Factorizations shared between solvers
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/LUFactorization.h>
+
+namespace DPsim {
+	/// \brief Factorizations of system matrices which are shared by several solvers.
+	///
+	/// Solvers of equal systems, e.g. the scenarios of an ensemble, look up
+	/// their system matrices here before factorizing them. A matrix is only
+	/// factorized by the first solver which requests it, concurrent requests
+	/// wait for that factorization. The factorizations are used read-only
+	/// and can be solved with from several threads. Entries are kept until
+	/// the object is destroyed.
+	class SharedFactorizations {
+	public:
+		using Ptr = std::shared_ptr<SharedFactorizations>;
+		using Factorize = std::function<LUFactorization::Ptr()>;
+
+	protected:
+		struct Entry {
+			Solver::MatrixType type;
+			/// Nonzeros of the factorized matrix to compare it exactly
+			SparseMatrix matrix;
+			std::shared_future<LUFactorization::Ptr> lu;
+		};
+
+		std::mutex mMutex;
+		/// Entries by the hash of their matrix
+		std::unordered_multimap<std::size_t, Entry> mEntries;
+		UInt mHits = 0;
+		UInt mMisses = 0;
+
+		static std::size_t hash(const SparseMatrix& mat, Solver::MatrixType type);
+		static Bool equal(const SparseMatrix& left, const SparseMatrix& right);
+
+	public:
+		/// Returns the factorization of an equal matrix of the same type or
+		/// the one returned by factorize, which is stored for later requests
+		LUFactorization::Ptr get(const SparseMatrix& mat, Solver::MatrixType type, const Factorize& factorize);
+
+		// #### Getter ####
+		UInt entries();
+		UInt hits();
+		UInt misses();
+	};
+}
@@ -30,6 +30,8 @@
 #include <dpsim/DataLogger.h>
 #include <dpsim/Solver.h>
 #include <dpsim/Event.h>
+#include <dpsim/PowerFlowSolver.h>
+#include <dpsim/Subsystem.h>
 #include <cps/Definitions.h>
 #include <cps/PowerComponent.h>
 #include <cps/Logger.h>
@@ -41,6 +43,9 @@
 #endif
 
 namespace DPsim {
+	// Declared only, as LUFactorization.h hides the stream operators of the global namespace
+	class SharedFactorizations;
+
 	/// \brief The Simulation holds a SystemTopology and a Solver.
 	///
 	/// Every time step, the Simulation calls the step function of the Solver.
@@ -58,18 +63,96 @@ namespace DPsim {
 		Real mFinalTime;
 		/// Time variable that is incremented at every step
 		Real mTime = 0;
-		/// Simulation timestep
+		/// Simulation timestep, which is changed by setTimeStep() or the adaptive time step
 		Real mTimeStep;
 		/// Number of step which have been executed for this simulation.
 		Int mTimeStepCount = 0;
 		/// Simulation log level
 		CPS::Logger::Level mLogLevel;
+		/// System topology which is passed to the solver
+		CPS::SystemTopology mSystem;
+		/// Simulation domain, which can be dynamic phasor (DP) or EMT
+		CPS::Domain mDomain;
 		///
 		Solver::Type mSolverType;
+		/// Storage format of the system matrices of the MNA solver and the Jacobian of the DAE solver
+		Solver::MatrixType mSystemMatrixType = Solver::MatrixType::Dense;
+		/// Maximum number of switch state factorizations cached by the MNA solver
+		UInt mFactorizationCacheEntries = 32;
+		/// Maximum memory in bytes used by cached switch state factorizations
+		std::size_t mFactorizationCacheSize = 1024 * 1024 * 1024;
+		/// Apply switch changes as low-rank corrections in the MNA solver
+		Bool mLowRankSwitchUpdates = false;
+		/// Maximum rank of the switch correction before refactorizing
+		UInt mMaxUpdateRank = 16;
+		/// Number of threads used by the MNA solver to step the components
+		UInt mThreads = 1;
+		/// CPUs to pin the solver threads to
+		std::vector<Int> mThreadCpus;
+		/// Tear the system into blocks in the MNA solver
+		Bool mPartitioned = false;
+		/// Requested number of blocks of the partitioned system
+		UInt mPartitions = 0;
+		/// Nodes and components at which the system is torn
+		std::vector<String> mTearingObjects;
+		/// Write the logs on background threads
+		Bool mAsyncLogging = false;
+		/// Number of samples buffered by each asynchronous logger
+		UInt mAsyncLoggingCapacity = 4096;
+		/// Behavior of asynchronous loggers if their buffer is full
+		DataLogger::OverflowPolicy mAsyncLoggingPolicy = DataLogger::OverflowPolicy::Drop;
+		/// Integrate the ODE solver with an implicit method
+		Bool mImplicitODE = false;
+		/// Record the latencies of the step phases
+		Bool mProfiling = false;
+		/// Latency histograms of the step phases
+		StepProfiler mProfiler;
+		/// Switch to trigger steady-state initialization
+		Bool mSteadyStateInit = false;
+		/// Method of the steady-state initialization
+		Solver::SteadyStateMethod mSteadyStateMethod = Solver::SteadyStateMethod::TimeStepping;
+		/// Relative tolerance of the steady-state initialization
+		Real mSteadyStateTolerance = 1e-4;
+		/// Iteration limit of the steady-state initialization, zero selects the default
+		UInt mSteadyStateMaxIterations = 0;
+		/// Log the vectors of the steady-state initialization
+		Bool mSteadyStateLogging = false;
+		struct PowerFlowBusMapping {
+			/// Name of the node
+			String node;
+			/// Bus type and specified values
+			PowerFlowSolver::Bus bus;
+			/// Components represented by the bus
+			std::vector<String> components;
+		};
+		/// Buses of the power flow which is solved by the MNA solver before initialization
+		std::vector<PowerFlowBusMapping> mPowerFlowBuses;
+		/// Relative power mismatch of the power flow
+		Real mPowerFlowTolerance = 1e-8;
+		/// Maximum number of Newton-Raphson iterations of the power flow
+		UInt mPowerFlowMaxIterations = 20;
+		/// Adapt the time step to the change of the solution
+		Bool mAdaptiveTimeStep = false;
+		/// Smallest time step of the adaptive time step, which is used after events
+		Real mMinTimeStep = 0;
+		/// Largest time step of the adaptive time step
+		Real mMaxTimeStep = 0;
+		/// Relative solution change per step below which the time step is increased
+		Real mTimeStepTolerance = 1e-3;
+		/// Number of consecutive steps whose solution change was below the tolerance
+		UInt mQuietSteps = 0;
+		/// Factorizations shared with other simulations of the same system
+		std::shared_ptr<SharedFactorizations> mSharedFactorizations;
+		/// Checkpoint which is restored by initialize()
+		std::unique_ptr<std::ifstream> mCheckpoint;
+		/// Set after the solver has been created by initialize()
+		Bool mInitialized = false;
 		///
 		std::shared_ptr<Solver> mSolver;
 		/// The simulation event queue
 		EventQueue mEvents;
+		/// Parts of the system which are solved with shorter time steps
+		std::vector<Subsystem::Ptr> mSubsystems;
 
 #ifdef WITH_SHMEM
 		struct InterfaceMapping {
@@ -104,6 +187,23 @@ namespace DPsim {
 			Solver::Type solverType = Solver::Type::MNA,
 			CPS::Logger::Level logLevel = CPS::Logger::Level::INFO);
 
+		/// Create and initialize an MNA solver for the given variable type.
+		/// The power flow buses and the partitioning only apply to the
+		/// system of the simulation, not to the subsystems.
+		template <typename VarType>
+		std::shared_ptr<Solver> createMnaSolver(String name, CPS::SystemTopology& system,
+			Real timeStep, CPS::Domain domain, Bool mainSystem);
+		/// Choose the time step of the next step from the solution change and the queued events
+		void adaptTimeStep(Bool eventsExecuted);
+		/// Exchange the inputs and execute the events before the solver step
+		void prepareStep();
+		/// Step the subsystems, log and advance the time after the solver step
+		void finishStep(Real nextTime);
+		/// Close the interfaces and flush the loggers and log their statistics
+		void closeInterfacesAndLoggers();
+		/// Close the interfaces and flush the loggers after the last step
+		void finish();
+
 	public:
 		/// Creates system matrix according to a given System topology
 		Simulation(String name, CPS::SystemTopology system,
@@ -115,17 +215,50 @@ namespace DPsim {
 		/// Desctructor
 		virtual ~Simulation();
 
+		/// Create the solver for the system topology.
+		/// This is called by run() and step() if it has not been called before.
+		void initialize();
 		/// Run simulation until total time is elapsed.
 		void run();
 		/// Solve system A * x = z for x and current time
 		Real step();
+		/// Run simulations in lockstep until all of them have reached their
+		/// final time. MNA solvers whose system matrices are equal solve their
+		/// right sides as one block, which requires the simulations to share
+		/// their factorizations, see setSharedFactorizations(). Suited for
+		/// scenarios which only differ in sources and loads. Interfaces are
+		/// not supported and the step profiles include the other simulations.
+		static void runBatch(const std::vector<Simulation*>& simulations);
 		/// Synchronize simulation with remotes by exchanging intial state over interfaces
 		void sync();
+		/// Write the time, the node voltages, the attributes of all
+		/// components and optionally the sparse factorization of the current
+		/// switch states to a binary file. Initializes the simulation if needed.
+		void saveCheckpoint(const String &filename, Bool factorizations = false);
+		/// Resume from a checkpoint of a simulation of the same system, which
+		/// replaces the power flow and steady-state initialization. Must be
+		/// called before initialize(). Events before the time of the checkpoint
+		/// are discarded, as their changes are part of the checkpoint.
+		void loadCheckpoint(const String &filename);
 
 		/// Schedule an event in the simulation
 		void addEvent(Event::Ptr e) {
 			mEvents.addEvent(e);
 		}
+		/// Schedule the attribute changes of a presorted CSV event file.
+		/// See EventQueue::loadEvents() for the format.
+		void loadEvents(const String &filename) {
+			mEvents.loadEvents(filename, mSystem);
+		}
+		/// Solve a part of the system with its own MNA solver and a time step
+		/// which divides the simulation time step. The returned subsystem
+		/// connects attributes of the subsystem with the ones of the simulation.
+		Subsystem::Ptr addSubsystem(String name, CPS::SystemTopology system,
+			Real timeStep, CPS::Domain domain = CPS::Domain::EMT) {
+			auto subsystem = std::make_shared<Subsystem>(name, system, timeStep, domain);
+			mSubsystems.push_back(subsystem);
+			return subsystem;
+		}
 #ifdef WITH_SHMEM
 		///
 		void addInterface(Interface *eint, Bool sync, Bool syncStart, UInt downsampling = 1) {
@@ -139,16 +272,119 @@ namespace DPsim {
 		std::vector<InterfaceMapping> & interfaces() { return mInterfaces; }
 #endif
 		void addLogger(DataLogger::Ptr logger, UInt downsampling = 1) {
+			if (mAsyncLogging)
+				logger->setAsync(mAsyncLoggingCapacity, mAsyncLoggingPolicy);
 			mLoggers.push_back({logger, downsampling});
 		}
 
+		// #### Setter ####
+		/// Change the time step, also between steps of a running simulation.
+		/// The solver factorizes its system matrix once for each time step and
+		/// switch state and caches the factorizations, so alternating between
+		/// a few time steps does not refactorize.
+		/// Throws std::invalid_argument if the time step is not positive and
+		/// SolverException if the solver cannot change to it.
+		void setTimeStep(Real timeStep);
+		/// Adapt the time step between minTimeStep and maxTimeStep. The time step
+		/// is reset to minTimeStep when events are executed, doubled after several
+		/// steps in which the relative change of the solution stays below the
+		/// tolerance and halved when it exceeds ten times the tolerance.
+		/// Steps are shortened so that they do not pass queued events.
+		void setAdaptiveTimeStep(Real minTimeStep, Real maxTimeStep, Real tolerance = 1e-3);
+		/// Select dense or sparse system matrices for the MNA solver and a
+		/// dense or sparse Jacobian for the DAE solver. Sparse matrices are
+		/// recommended for large networks.
+		void setSystemMatrixType(Solver::MatrixType type) { mSystemMatrixType = type; }
+		/// Integrate the ODE solver with an implicit method, which solves a
+		/// linear system with the Jacobian of the components in each stage
+		/// and is suited for stiff systems. The default method is explicit.
+		void setImplicitODE(Bool implicit) { mImplicitODE = implicit; }
+		/// Limit the switch state factorizations which are kept by the MNA solver.
+		/// A limit of zero disables the respective check.
+		void setFactorizationCacheLimits(UInt maxEntries, std::size_t maxSize) {
+			mFactorizationCacheEntries = maxEntries;
+			mFactorizationCacheSize = maxSize;
+		}
+		/// Keep one factorization in the MNA solver and apply switch changes as
+		/// low-rank corrections until more than maxRank rows and columns differ.
+		void setLowRankSwitchUpdates(Bool enable, UInt maxRank = 16) {
+			mLowRankSwitchUpdates = enable;
+			mMaxUpdateRank = maxRank;
+		}
+		/// Enable the steady-state initialization of DP simulations with the MNA solver.
+		/// See MnaSolver::setSteadyStateInitialization().
+		void setSteadyStateInitialization(Solver::SteadyStateMethod method,
+			Real tolerance = 1e-4, UInt maxIterations = 0, Bool logging = false) {
+			mSteadyStateInit = true;
+			mSteadyStateMethod = method;
+			mSteadyStateTolerance = tolerance;
+			mSteadyStateMaxIterations = maxIterations;
+			mSteadyStateLogging = logging;
+		}
+		/// Specify a bus of the power flow which initializes the node voltages.
+		/// See MnaSolver::addPowerFlowBus().
+		void addPowerFlowBus(const String &node, PowerFlowSolver::Bus bus,
+			const std::vector<String> &components = {}) {
+			mPowerFlowBuses.push_back({ node, bus, components });
+		}
+		/// Set the relative power mismatch and the iteration limit of the power flow
+		void setPowerFlowSettings(Real tolerance, UInt maxIterations) {
+			mPowerFlowTolerance = tolerance;
+			mPowerFlowMaxIterations = maxIterations;
+		}
+		/// Step the components of the MNA solver on multiple threads,
+		/// optionally pinned to the given CPUs. The simulation thread
+		/// keeps its affinity and is expected to run on the first CPU.
+		void setThreads(UInt threads, const std::vector<Int>& cpus = {}) {
+			mThreads = threads;
+			mThreadCpus = cpus;
+		}
+		/// Factorize and solve the system as independent blocks on the solver threads.
+		/// See MnaSolver::setPartitioning().
+		void setPartitioning(UInt blocks, const std::vector<String>& tearingObjects = {}) {
+			mPartitioned = true;
+			mPartitions = blocks;
+			mTearingObjects = tearingObjects;
+		}
+		/// Share the factorizations of equal system matrices with other
+		/// simulations, e.g. the scenarios of an ensemble
+		void setSharedFactorizations(std::shared_ptr<SharedFactorizations> factorizations) {
+			mSharedFactorizations = factorizations;
+		}
+		/// Record the latency of each phase of the simulation steps in histograms.
+		/// They are available from profiler() and as "latency_<phase>_<mean|p99|max>" attributes.
+		void setProfiling(Bool profiling) {
+			mProfiling = profiling;
+			if (mSolver)
+				mSolver->setProfiler(profiling ? &mProfiler : nullptr);
+		}
+		/// Write the executed events to "<name>_events.csv" in the log directory
+		void setEventLogging(Bool enabled) {
+			mEvents.setLog(enabled ? CPS::Logger::logDir() + "/" + mName + "_events.csv" : "");
+		}
+		/// Write the logs of the simulation and the solver on background threads,
+		/// so that file I/O does not delay the simulation steps.
+		/// Applies to the loggers added before and after this call.
+		void setAsyncLogging(UInt capacity = 4096,
+			DataLogger::OverflowPolicy policy = DataLogger::OverflowPolicy::Drop) {
+			mAsyncLogging = true;
+			mAsyncLoggingCapacity = capacity;
+			mAsyncLoggingPolicy = policy;
+
+			for (auto& lg : mLoggers)
+				lg.logger->setAsync(capacity, policy);
+		}
+
 		// #### Getter ####
 		String name() const { return mName; }
 		Real time() const { return mTime; }
 		Real finalTime() const { return mFinalTime; }
 		Int timeStepCount() const { return mTimeStepCount; }
+		const StepProfiler & profiler() const { return mProfiler; }
 		Real timeStep() const { return mTimeStep; }
+		const EventQueue & events() const { return mEvents; }
 		std::vector<LoggerMapping> & loggers() { return mLoggers; }
+		std::vector<Subsystem::Ptr> & subsystems() { return mSubsystems; }
 	};
 
 }
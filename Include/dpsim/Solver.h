@@ -27,6 +27,7 @@
 
 #include <dpsim/Definitions.h>
 #include <dpsim/Config.h>
+#include <dpsim/StepProfiler.h>
 #include <cps/Logger.h>
 #include <cps/SystemTopology.h>
 
@@ -39,14 +40,42 @@ namespace DPsim {
 
 	/// Base class for more specific solvers such as MNA, ODE or IDA.
 	class Solver {
+	protected:
+		/// Records the latency of the phases of step(), if set
+		StepProfiler *mProfiler = nullptr;
+
 	public:
 		virtual ~Solver() { }
 
-		enum class Type { MNA, DAE };
+		enum class Type { MNA, DAE, ODE };
+		/// Storage format of the linear system matrices
+		enum class MatrixType { Dense, Sparse };
+		/// Method of the steady-state initialization
+		enum class SteadyStateMethod {
+			/// Step the system with the simulation time step until it settles
+			TimeStepping,
+			/// Solve for the phasors of the periodic steady state directly
+			Direct
+		};
 
 		/// Solve system A * x = z for x and current time
 		virtual Real step(Real time) = 0;
 		/// Log results
 		virtual void log(Real time) { };
+		/// Fault in the memory used by step() and log() before a real-time run
+		virtual void prefault() { };
+		/// Change the time step before the next step.
+		/// Returns false if the solver only supports a constant time step.
+		virtual Bool setTimeStep(Real timeStep) { return false; }
+		/// Compute solutionChange() after each step
+		virtual void setTrackSolutionChange(Bool track) { };
+		/// Largest change of the solution in the last step relative to its largest value
+		virtual Real solutionChange() const { return 0; }
+		/// Write the state of the solver to a checkpoint, optionally with its factorizations
+		virtual void saveCheckpoint(std::ostream& os, Bool factorizations) const {
+			throw UnsupportedSolverException();
+		}
+		/// Record the phases of the following steps with the given profiler
+		void setProfiler(StepProfiler *profiler) { mProfiler = profiler; }
 	};
 }
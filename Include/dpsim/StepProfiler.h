@@ -0,0 +1,106 @@
+/** Step phase profiler
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/Histogram.h>
+
+namespace DPsim {
+	/// Measures the latency of the phases of each simulation step.
+	/// A step is divided by calls to lap(), which attribute the time since
+	/// the previous call to a phase. finish() records the accumulated phase
+	/// times and the total step time in one histogram per phase.
+	class StepProfiler {
+	public:
+		enum class Phase : UInt {
+			InterfaceRead,
+			Events,
+			PreStep,
+			Solve,
+			PostStep,
+			VoltageUpdate,
+			Logging,
+			InterfaceWrite,
+			Total
+		};
+
+		static constexpr UInt numPhases = (UInt) Phase::Total + 1;
+
+		using Clock = std::chrono::steady_clock;
+
+	protected:
+		std::array<Histogram, numPhases> mHistograms;
+		/// Time spent in each phase during the current step
+		std::array<uint64_t, numPhases> mCurrent;
+		/// Phases which were entered during the current step
+		std::array<Bool, numPhases> mEntered;
+		Clock::time_point mStepStart;
+		Clock::time_point mLastLap;
+
+	public:
+		StepProfiler() {
+			mCurrent.fill(0);
+			mEntered.fill(false);
+		}
+
+		static const char * phaseName(Phase phase);
+
+		/// Begin a new step
+		void start() {
+			mStepStart = mLastLap = Clock::now();
+		}
+
+		/// Attribute the time since the last lap to the given phase
+		void lap(Phase phase) {
+			auto now = Clock::now();
+
+			mCurrent[(UInt) phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - mLastLap).count();
+			mEntered[(UInt) phase] = true;
+			mLastLap = now;
+		}
+
+		/// Record the phases of the current step
+		void finish() {
+			mCurrent[(UInt) Phase::Total] = std::chrono::duration_cast<std::chrono::nanoseconds>(mLastLap - mStepStart).count();
+			mEntered[(UInt) Phase::Total] = true;
+
+			for (UInt i = 0; i < numPhases; i++) {
+				if (mEntered[i])
+					mHistograms[i].record(mCurrent[i]);
+
+				mCurrent[i] = 0;
+				mEntered[i] = false;
+			}
+		}
+
+		/// Clear all histograms
+		void reset() {
+			for (auto &h : mHistograms)
+				h.reset();
+		}
+
+		const Histogram & histogram(Phase phase) const { return mHistograms[(UInt) phase]; }
+	};
+}
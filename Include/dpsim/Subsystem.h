@@ -0,0 +1,135 @@
+/** Subsystem of a multi-rate simulation
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <dpsim/Definitions.h>
+#include <dpsim/Solver.h>
+#include <cps/Attribute.h>
+#include <cps/SystemTopology.h>
+
+namespace DPsim {
+	/// \brief Part of a multi-rate simulation which is solved with a shorter time step.
+	///
+	/// The subsystem has its own solver and domain. It is stepped after each
+	/// step of the simulation over the preceding simulation time step, so that
+	/// the values of the simulation can be interpolated between the last two
+	/// steps. The values of the subsystem are averaged over its steps and
+	/// passed to the simulation before its next step.
+	///
+	/// Phasors of a DP simulation can be passed to an EMT subsystem and
+	/// instantaneous values of an EMT subsystem to a DP simulation. They are
+	/// shifted by the system frequency to or from the time domain.
+	class Subsystem {
+	protected:
+		/// Name used for the logs of the solver
+		String mName;
+		/// Components and nodes of the subsystem
+		CPS::SystemTopology mSystem;
+		/// Time step of the subsystem
+		Real mTimeStep;
+		/// Domain of the subsystem
+		CPS::Domain mDomain;
+		/// Solver of the subsystem
+		std::shared_ptr<Solver> mSolver;
+		/// Number of subsystem steps per simulation step
+		UInt mRatio = 1;
+		/// Angular frequency used to shift phasors
+		Real mOmega = 0;
+		/// Set after the values of the simulation have been sampled once
+		Bool mStarted = false;
+		/// Time of the last simulation step
+		Real mLastTime = 0;
+
+		/// Store the values of the simulation after its step
+		std::vector<std::function<void()>> mSampleInputs;
+		/// Set the interpolated values for a fraction of the simulation time step
+		std::vector<std::function<void(Real fraction, Real time)>> mApplyInputs;
+		/// Sum up the values of the subsystem after each step
+		std::vector<std::function<void(Real time)>> mAccumulateOutputs;
+		/// Pass the averaged values to the simulation and restart the averages
+		std::vector<std::function<void()>> mApplyOutputs;
+
+		template <typename T>
+		struct Interpolation {
+			T previous;
+			T current;
+		};
+
+		template <typename T>
+		struct Average {
+			T sum;
+			UInt count;
+		};
+
+		/// Interpolate a value of the simulation and convert it for the subsystem
+		template <typename From, typename To>
+		void addInterpolatedInput(typename CPS::Attribute<From>::Ptr from,
+			typename CPS::Attribute<To>::Ptr to, std::function<To(From, Real)> convert);
+		/// Average a value of the subsystem and pass it to the simulation
+		template <typename T>
+		void addAveragedOutput(typename CPS::Attribute<T>::Ptr from, typename CPS::Attribute<T>::Ptr to);
+
+	public:
+		using Ptr = std::shared_ptr<Subsystem>;
+
+		Subsystem(String name, CPS::SystemTopology system, Real timeStep, CPS::Domain domain) :
+			mName(name), mSystem(system), mTimeStep(timeStep), mDomain(domain) { }
+
+		/// Pass a value of the simulation to the subsystem
+		void addInput(CPS::Attribute<Real>::Ptr from, CPS::Attribute<Real>::Ptr to);
+		/// Pass a value of the simulation to the subsystem
+		void addInput(CPS::Attribute<Complex>::Ptr from, CPS::Attribute<Complex>::Ptr to);
+		/// Pass a phasor of the simulation as instantaneous value to the subsystem
+		void addInput(CPS::Attribute<Complex>::Ptr from, CPS::Attribute<Real>::Ptr to);
+		/// Pass a value of the subsystem to the simulation
+		void addOutput(CPS::Attribute<Real>::Ptr from, CPS::Attribute<Real>::Ptr to);
+		/// Pass a value of the subsystem to the simulation
+		void addOutput(CPS::Attribute<Complex>::Ptr from, CPS::Attribute<Complex>::Ptr to);
+		/// Pass an instantaneous value of the subsystem as phasor to the simulation.
+		/// The phasor is demodulated over the last period of the system frequency.
+		void addOutput(CPS::Attribute<Real>::Ptr from, CPS::Attribute<Complex>::Ptr to);
+
+		/// Use the solver for a simulation with the given time step.
+		/// Throws std::invalid_argument if it is not a multiple of the subsystem time step.
+		void setSolver(std::shared_ptr<Solver> solver, Real simulationTimeStep, Real omega);
+		/// Pass the averaged values of the subsystem to the simulation
+		void applyOutputs();
+		/// Step the subsystem up to the time of the last simulation step.
+		/// Throws std::invalid_argument if the subsystem time step does not
+		/// divide the interval since the previous simulation step.
+		void step(Real simulationTime);
+		/// Fault in the memory of the solver
+		void prefault() { mSolver->prefault(); }
+
+		// #### Getter ####
+		String name() const { return mName; }
+		CPS::SystemTopology & system() { return mSystem; }
+		Real timeStep() const { return mTimeStep; }
+		CPS::Domain domain() const { return mDomain; }
+		UInt ratio() const { return mRatio; }
+		std::shared_ptr<Solver> solver() const { return mSolver; }
+	};
+}
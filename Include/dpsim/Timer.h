@@ -22,6 +22,7 @@
 #pragma once
 
 #include <dpsim/Config.h>
+#include <dpsim/Histogram.h>
 
 #include <chrono>
 
@@ -41,6 +42,13 @@ namespace DPsim {
 		using StartTimePoint = std::chrono::time_point<StartClock, Ticks>;
 		using IntervalTimePoint = std::chrono::time_point<IntervalClock, Ticks>;
 
+		enum class Mode {
+			/// Block until the tick in the kernel
+			sleep,
+			/// Sleep until shortly before the tick, then poll the clock
+			hybrid
+		};
+
 	protected:
 		enum State {
 			running,
@@ -57,6 +65,20 @@ namespace DPsim {
 		long long mOverruns;
 		long long mTicks;
 		int mFlags;
+		Mode mMode = Mode::sleep;
+
+		/// Time between the wake-up and the tick which is polled in hybrid mode
+		Ticks mWakeMargin;
+		/// Moving average and deviation of the wake-up error in hybrid mode
+		Real mWakeError = 0;
+		Real mWakeJitter = 0;
+		/// Delay between the ticks and the return from sleep() in nanoseconds
+		Histogram mLateness;
+
+		/// Wait for the next tick in hybrid mode and return the number of elapsed ticks
+		uint64_t sleepHybrid();
+		/// Adapt the wake-up margin to the error of the last wake-up
+		void updateWakeMargin(Ticks error);
 
 	public:
 		enum Flags : int {
@@ -87,10 +109,29 @@ namespace DPsim {
 			return mTicks;
 		}
 
+		Mode mode() {
+			return mMode;
+		}
+
+		/// Current margin between wake-up and tick in hybrid mode
+		Ticks wakeMargin() {
+			return mWakeMargin;
+		}
+
+		/// Delays between the ticks and the return from sleep()
+		const Histogram & lateness() {
+			return mLateness;
+		}
+
 		Ticks interval() {
 			return mTickInterval;
 		}
 
+		/// Point in time of the next tick
+		IntervalTimePoint nextTick() {
+			return mNextTick;
+		}
+
 		// Setter
 		void setStartTime(const StartTimePoint &start) {
 			mStartAt = start;
@@ -103,6 +144,11 @@ namespace DPsim {
 		void setInterval(double dt) {
 			mTickInterval = Timer::Ticks((uintmax_t) (dt * 1e9));
 		}
+
+		/// Must be called before start()
+		void setMode(Mode mode) {
+			mMode = mode;
+		}
 };
 
 #ifdef HAVE_TIMERFD
@@ -22,10 +22,12 @@
 #pragma once
 
 #include <list>
+#include <unordered_map>
 
 #include <dpsim/Timer.h>
 #include <dpsim/Solver.h>
 #include <cps/Logger.h>
+#include <cps/SystemTopology.h>
 
 namespace DPsim {
 
@@ -85,4 +87,7 @@ public:
 	std::map<String, Real> options;
 };
 
+/// Components and nodes of a system by their names. Components hide nodes of the same name.
+std::unordered_map<String, CPS::IdentifiedObject::Ptr> objectsByName(const CPS::SystemTopology &system);
+
 }
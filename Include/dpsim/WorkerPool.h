@@ -0,0 +1,96 @@
+/** Pool of worker threads
+ *
+ * @file
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <dpsim/Config.h>
+#include <dpsim/Definitions.h>
+
+namespace DPsim {
+	/// Fixed set of threads which execute a task together with the calling thread.
+	///
+	/// The workers busy-wait for the next task and block after a while, because
+	/// the tasks are issued once per simulation step and need to start with low latency.
+	/// The calling thread waits for the workers in the same way.
+	class WorkerPool {
+	public:
+		/// A task is called once on each worker with the index of the worker.
+		/// Index zero is the calling thread.
+		using Task = std::function<void(UInt)>;
+
+	protected:
+		/// Threads of the workers 1 to size() - 1
+		std::vector<std::thread> mThreads;
+		/// Task of the current run
+		std::atomic<const Task*> mTask;
+		/// Incremented for each run to wake up the workers
+		std::atomic<UInt> mGeneration;
+		/// Number of workers which have finished the current run
+		std::atomic<UInt> mFinished;
+		/// Set to stop the workers
+		std::atomic<Bool> mStop;
+		/// Exceptions thrown by the task of each worker in the current run
+		std::vector<std::exception_ptr> mErrors;
+		/// Number of threads which block in wait()
+		std::atomic<UInt> mWaiting;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+
+		void work(UInt index);
+		/// Poll until done returns true and block if it takes longer
+		template <typename Predicate>
+		void wait(Predicate done);
+		/// Wake up the threads which block in wait()
+		void notify();
+		/// Stop and join all worker threads
+		void stop();
+		/// Pin a thread to a CPU
+		static void setAffinity(std::thread::native_handle_type thread, Int cpu);
+
+	public:
+		/// Start threads - 1 workers. If cpus is not empty, worker i is
+		/// pinned to cpus[i % cpus.size()]. The calling thread is worker 0
+		/// and is not pinned, cpus[0] is the CPU it is expected to run on.
+		WorkerPool(UInt threads, const std::vector<Int>& cpus = {});
+		~WorkerPool();
+
+		/// Run the task on all workers and wait until all of them are done.
+		/// If the task throws on any worker, the exception of the worker
+		/// with the lowest index is rethrown after all of them are done.
+		void run(const Task& task);
+
+		// #### Getter ####
+		UInt size() const { return (UInt) mThreads.size() + 1; }
+
+		/// Returns the begin and end of the part of count items processed by a worker
+		std::pair<UInt, UInt> range(UInt worker, UInt count) const {
+			return { count * worker / size(), count * (worker + 1) / size() };
+		}
+	};
+}
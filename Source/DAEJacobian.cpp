@@ -0,0 +1,236 @@
+/** Jacobian of the DAE residual
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include <dpsim/DAEJacobian.h>
+
+using namespace DPsim;
+
+DAEJacobian::DAEJacobian(Int size, Int unitRows) :
+	mSize(size),
+	mUnitRows(unitRows) { }
+
+void DAEJacobian::addComponent(CPS::DAEInterface::ResFn residual, DAEJacobianInterface::Ptr jacobian) {
+	Component comp;
+	comp.residual = residual;
+	comp.jacobian = jacobian;
+	mComponents.push_back(comp);
+}
+
+void DAEJacobian::evaluate(Component& comp, Real time, std::vector<Real>& values) {
+	for (auto row : comp.rows)
+		mResidual[row] = 0;
+
+	mOffsets = comp.offsets;
+	comp.residual(time, mState.data(), mDerivative.data(), mResidual.data(), mOffsets);
+
+	values.resize(comp.rows.size());
+	for (UInt i = 0; i < comp.rows.size(); i++)
+		values[i] = mResidual[comp.rows[i]];
+}
+
+void DAEJacobian::probe(Component& comp, std::vector<Real>& variables, const std::vector<Real>& steps,
+	std::vector<Int>& columns) {
+	// Variables are perturbed in blocks and a block is only probed
+	// variable by variable if the residual of the component changes
+	const Int blockSize = 64;
+	std::vector<Real> saved(blockSize);
+
+	columns.clear();
+	evaluate(comp, 0, mBase);
+
+	auto changed = [&]() {
+		evaluate(comp, 0, mPerturbed);
+		for (UInt i = 0; i < mBase.size(); i++) {
+			if (std::abs(mPerturbed[i] - mBase[i]) > 1e-9 * (1 + std::abs(mBase[i])))
+				return true;
+		}
+		return false;
+	};
+
+	for (Int begin = 0; begin < mSize; begin += blockSize) {
+		Int end = std::min(mSize, begin + blockSize);
+
+		std::copy(variables.begin() + begin, variables.begin() + end, saved.begin());
+		for (Int i = begin; i < end; i++)
+			variables[i] += steps[i];
+		Bool blockChanged = changed();
+		std::copy(saved.begin(), saved.begin() + (end - begin), variables.begin() + begin);
+
+		if (!blockChanged)
+			continue;
+
+		for (Int i = begin; i < end; i++) {
+			variables[i] += steps[i];
+			if (changed())
+				columns.push_back(i);
+			variables[i] = saved[i - begin];
+		}
+	}
+}
+
+void DAEJacobian::analyzePattern(const std::vector<int>& offsets) {
+	// Random values and steps make it unlikely that a dependency vanishes
+	// at the probed state or that the changes of a block cancel each other
+	std::mt19937 random(1);
+	std::uniform_real_distribution<Real> distribution(0.5, 1.5);
+
+	std::vector<Real> steps(mSize);
+	mState.resize(mSize);
+	mDerivative.resize(mSize);
+	mResidual.assign(mSize, 0);
+	for (Int i = 0; i < mSize; i++) {
+		mState[i] = distribution(random);
+		mDerivative[i] = distribution(random);
+		steps[i] = 1e-2 * distribution(random);
+	}
+
+	mPattern.clear();
+	for (Int i = 0; i < mUnitRows; i++)
+		mPattern.emplace_back(i, i, 0);
+
+	UInt maxRows = 0;
+	mOffsets = offsets;
+	for (auto& comp : mComponents) {
+		comp.offsets = mOffsets;
+
+		std::fill(mResidual.begin(), mResidual.end(), 0);
+		comp.residual(0, mState.data(), mDerivative.data(), mResidual.data(), mOffsets);
+		std::vector<int> next = mOffsets;
+
+		comp.rows.clear();
+		for (Int row = 0; row < mSize; row++) {
+			if (mResidual[row] != 0)
+				comp.rows.push_back(row);
+		}
+		maxRows = std::max(maxRows, (UInt) comp.rows.size());
+
+		if (comp.jacobian) {
+			mRecording = true;
+			mOffsets = comp.offsets;
+			comp.jacobian->daeJacobian(0, mState.data(), mDerivative.data(), 1, *this, mOffsets);
+			mRecording = false;
+		}
+		else {
+			probe(comp, mState, steps, comp.stateColumns);
+			probe(comp, mDerivative, steps, comp.derivativeColumns);
+
+			for (auto row : comp.rows) {
+				for (auto col : comp.stateColumns)
+					mPattern.emplace_back(row, col, 0);
+				for (auto col : comp.derivativeColumns)
+					mPattern.emplace_back(row, col, 0);
+			}
+		}
+
+		mOffsets = next;
+	}
+
+	mMatrix.resize(mSize, mSize);
+	mMatrix.setFromTriplets(mPattern.begin(), mPattern.end());
+	mMatrix.makeCompressed();
+	mPattern.clear();
+	mPattern.shrink_to_fit();
+
+	// Computing the Jacobian does not allocate memory
+	mBase.reserve(maxRows);
+	mPerturbed.reserve(maxRows);
+}
+
+void DAEJacobian::extendPattern() {
+	for (Int col = 0; col < mSize; col++) {
+		for (SparseMatrix::InnerIterator it(mMatrix, col); it; ++it)
+			mPattern.emplace_back(it.row(), col, 0);
+	}
+
+	mMatrix.setFromTriplets(mPattern.begin(), mPattern.end());
+	mMatrix.makeCompressed();
+	mPattern.clear();
+}
+
+void DAEJacobian::compute(Real time, const Real state[], const Real dstate_dt[], Real cj) {
+	std::fill(mMatrix.valuePtr(), mMatrix.valuePtr() + mMatrix.nonZeros(), 0);
+
+	for (Int i = 0; i < mUnitRows; i++)
+		add(i, i, 1);
+
+	std::copy(state, state + mSize, mState.begin());
+	std::copy(dstate_dt, dstate_dt + mSize, mDerivative.begin());
+
+	for (auto& comp : mComponents) {
+		if (comp.jacobian) {
+			mOffsets = comp.offsets;
+			comp.jacobian->daeJacobian(time, state, dstate_dt, cj, *this, mOffsets);
+			continue;
+		}
+
+		evaluate(comp, time, mBase);
+
+		// Forward differences in the columns the component depends on
+		auto differences = [&](std::vector<Real>& variables, const std::vector<Int>& columns, Real scale) {
+			for (auto col : columns) {
+				Real saved = variables[col];
+				variables[col] += std::sqrt(std::numeric_limits<Real>::epsilon()) * std::max(1.0, std::abs(saved));
+				Real step = variables[col] - saved;
+
+				evaluate(comp, time, mPerturbed);
+				variables[col] = saved;
+
+				for (UInt i = 0; i < comp.rows.size(); i++)
+					add(comp.rows[i], col, scale * (mPerturbed[i] - mBase[i]) / step);
+			}
+		};
+
+		differences(mState, comp.stateColumns, 1);
+		differences(mDerivative, comp.derivativeColumns, cj);
+	}
+
+	// An analytic Jacobian may depend on a variable whose entry vanished
+	// at the probed state. Its pattern is extended and the Jacobian is
+	// computed again, which only happens once for each missing entry.
+	if (!mPattern.empty()) {
+		extendPattern();
+		compute(time, state, dstate_dt, cj);
+	}
+}
+
+void DAEJacobian::add(Int row, Int col, Real value) {
+	if (row < 0 || row >= mSize || col < 0 || col >= mSize)
+		throw SolverException();
+
+	if (mRecording) {
+		mPattern.emplace_back(row, col, 0);
+		return;
+	}
+
+	const int* begin = mMatrix.innerIndexPtr() + mMatrix.outerIndexPtr()[col];
+	const int* end = mMatrix.innerIndexPtr() + mMatrix.outerIndexPtr()[col + 1];
+	const int* entry = std::lower_bound(begin, end, row);
+	if (entry == end || *entry != row) {
+		mPattern.emplace_back(row, col, 0);
+		return;
+	}
+
+	mMatrix.valuePtr()[entry - mMatrix.innerIndexPtr()] += value;
+}
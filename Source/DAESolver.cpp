@@ -28,9 +28,15 @@ using namespace CPS;
 
 //#define NVECTOR_DATA(vec) NV_DATA_S (vec) // Returns pointer to the first element of array vec
 
-DAESolver::DAESolver(String name, SystemTopology system, Real dt, Real t0) :
+DAESolver::DAESolver(String name, SystemTopology system, Real dt, Real t0, Solver::MatrixType matrixType) :
 	mSystem(system),
-	mTimestep(dt) {
+	mTimestep(dt),
+	mMatrixType(matrixType) {
+
+#ifndef WITH_KLU
+	if (mMatrixType == Solver::MatrixType::Sparse)
+		throw UnsupportedSolverException();
+#endif
 
 	// Defines offset vector of the residual which is composed as follows:
 	// mOffset[0] = # nodal voltage equations
@@ -121,7 +127,7 @@ void DAESolver::initialize(Real t0)
 		});
 	}
 
-	for (int j = 1; j < mNEQ; j++) {
+	while (counter < mNEQ) {
 		// Initialize nodal current equations
 		sval[counter++] = 0;
 	}
@@ -129,7 +135,7 @@ void DAESolver::initialize(Real t0)
 	s_dtval = N_VGetArrayPointer_Serial(dstate_dt);
 
 	// Set inital values for state derivative for now all equal to 0
-	for (int i = 0; i < (mNEQ-1); i++) {
+	for (int i = 0; i < mNEQ; i++) {
 		s_dtval[i] = 0; // TODO: add derivative calculation
 	}
 
@@ -154,10 +160,28 @@ void DAESolver::initialize(Real t0)
 //		throw CPS::Exception();
 //	}
 
+	// The pattern of the Jacobian is probed from the residual functions of
+	// the components, which are called after the node voltage equations
+	mJacobian = std::make_unique<DAEJacobian>(mNEQ, (Int) mNodes.size());
+	for (UInt i = 0; i < mComponents.size(); i++)
+		mJacobian->addComponent(mResidualFunctions[i], std::dynamic_pointer_cast<DAEJacobianInterface>(mComponents[i]));
+	mJacobian->analyzePattern({ (int) mNodes.size(), 0 });
+
 	// Allocate and connect Matrix A and solver LS to IDA
-	A = SUNDenseMatrix(mNEQ, mNEQ);
-	LS = SUNDenseLinearSolver(state, A);
+#ifdef WITH_KLU
+	if (mMatrixType == Solver::MatrixType::Sparse) {
+		mJacobianNonZeros = mJacobian->nonZeros();
+		A = SUNSparseMatrix(mNEQ, mNEQ, mJacobianNonZeros, CSC_MAT);
+		LS = SUNKLU(state, A);
+	}
+	else
+#endif
+	{
+		A = SUNDenseMatrix(mNEQ, mNEQ);
+		LS = SUNDenseLinearSolver(state, A);
+	}
 	ret = IDADlsSetLinearSolver(mem, LS, A);
+	ret = IDADlsSetJacFn(mem, &DAESolver::jacobianFunctionWrapper);
 
 	(void) ret;
 }
@@ -202,6 +226,54 @@ int DAESolver::residualFunction(realtype ttime, N_Vector state, N_Vector dstate_
 	return 0;
 }
 
+int DAESolver::jacobianFunctionWrapper(realtype ttime, realtype cj, N_Vector state, N_Vector dstate_dt,
+	N_Vector resid, SUNMatrix jacobian, void *user_data, N_Vector tmp1, N_Vector tmp2, N_Vector tmp3)
+{
+	DAESolver *self = reinterpret_cast<DAESolver *>(user_data);
+
+	try {
+		return self->jacobianFunction(ttime, cj, state, dstate_dt, jacobian);
+	}
+	catch (SolverException &) {
+		// A component added an entry outside of the matrix
+		return -1;
+	}
+}
+
+int DAESolver::jacobianFunction(realtype ttime, realtype cj, N_Vector state, N_Vector dstate_dt, SUNMatrix jacobian)
+{
+	mJacobian->compute(ttime, NV_DATA_S(state), NV_DATA_S(dstate_dt), cj);
+	const SparseMatrix &mat = mJacobian->matrix();
+
+#ifdef WITH_KLU
+	if (SUNMatGetID(jacobian) == SUNMATRIX_SPARSE) {
+		// The pattern was extended, so the matrix is reallocated and KLU
+		// analyzes the new pattern in its next factorization
+		if (mat.nonZeros() != mJacobianNonZeros) {
+			mJacobianNonZeros = (Int) mat.nonZeros();
+			if (SUNKLUReInit(LS, jacobian, mJacobianNonZeros, SUNKLU_REINIT_FULL) != SUNLS_SUCCESS)
+				return -1;
+		}
+
+		for (Int col = 0; col <= mNEQ; col++)
+			SM_INDEXPTRS_S(jacobian)[col] = mat.outerIndexPtr()[col];
+		for (Int i = 0; i < mat.nonZeros(); i++) {
+			SM_INDEXVALS_S(jacobian)[i] = mat.innerIndexPtr()[i];
+			SM_DATA_S(jacobian)[i] = mat.valuePtr()[i];
+		}
+		return 0;
+	}
+#endif
+
+	SUNMatZero(jacobian);
+	for (Int col = 0; col < mNEQ; col++) {
+		for (SparseMatrix::InnerIterator it(mat, col); it; ++it)
+			SM_ELEMENT_D(jacobian, it.row(), col) = it.value();
+	}
+
+	return 0;
+}
+
 Real DAESolver::step(Real time) {
 
 	int ret = IDASolve(mem, time, &tret, state, dstate_dt, IDA_NORMAL);  // TODO: find alternative to IDA_NORMAL
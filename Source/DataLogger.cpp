@@ -19,27 +19,39 @@
  *********************************************************************************/
 
 #include <iomanip>
+#include <limits>
+#include <cstdint>
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
 
 #include <dpsim/DataLogger.h>
+#include <dpsim/RealTime.h>
 #include <cps/Logger.h>
 
 using namespace DPsim;
 
-DataLogger::DataLogger(String name, Bool enabled) :
-	mEnabled(enabled) {
+DataLogger::DataLogger(String name, Bool enabled, Format format, UInt precision, UInt chunkSize) :
+	mEnabled(enabled),
+	mFormat(format),
+	mPrecision(precision == 4 ? 4 : 8),
+	mChunkSize(chunkSize > 0 ? chunkSize : 1),
+	mEnqueuedRows(0),
+	mWrittenRows(0),
+	mStopWriter(false),
+	mDroppedSamples(0),
+	mDecimatedSamples(0) {
 	if (!mEnabled)
 		return;
 
-	String filename = CPS::Logger::logDir() + "/" + name + ".csv";
+	String filename = CPS::Logger::logDir() + "/" + name
+		+ (mFormat == Format::Binary ? ".dpsim" : ".csv");
 
 	fs::path p = filename;
 
 	if (p.has_parent_path() && !fs::exists(p.parent_path()))
 		fs::create_directory(p.parent_path());
 
-	mLogFile = std::ofstream(filename);
+	mLogFile = std::ofstream(filename, std::ios::out | std::ios::binary);
 	if (!mLogFile.is_open()) {
 		// TODO: replace by exception
 		std::cerr << "Cannot open log file " << filename << std::endl;
@@ -48,47 +60,302 @@ DataLogger::DataLogger(String name, Bool enabled) :
 }
 
 DataLogger::~DataLogger() {
-	if (mLogFile.is_open())
+	stopWriter();
+
+	if (mLogFile.is_open()) {
+		if (mFormat == Format::Binary)
+			writeChunk();
 		mLogFile.close();
+	}
 }
 
 void DataLogger::flush() {
+	// The writer thread is idle once it has written all rows,
+	// so the file can be accessed by the logging thread.
+	while (mWrittenRows.load(std::memory_order_acquire) < mEnqueuedRows)
+		std::this_thread::yield();
+
+	if (mFormat == Format::Binary)
+		writeChunk();
 	mLogFile.flush();
 }
 
-void DataLogger::setColumnNames(std::vector<String> names) {
-	if (mLogFile.tellp() == std::ofstream::pos_type(0)) {
-		mLogFile << std::right << std::setw(14) << "time";
-		for (auto name : names) {
-			mLogFile << ", " << std::right << std::setw(13) << name;
+void DataLogger::setAsync(UInt capacity, OverflowPolicy policy) {
+	mAsync = true;
+	mCapacity = capacity > 0 ? capacity : 1;
+	mPolicy = policy;
+}
+
+template<typename T>
+static void prefaultVector(const std::vector<T> &v) {
+	prefaultMemory(v.data(), v.size() * sizeof(T));
+}
+
+void DataLogger::prefault() {
+	if (!mEnabled)
+		return;
+
+	// Attribute loggers know their columns in advance, so the header can be
+	// written and the buffers allocated as they would be for the first sample
+	if ((mFormat == Format::Binary || mAsync) && !mHeaderWritten && !mAttributes.empty()) {
+		std::vector<String> names;
+		for (auto it : mAttributes)
+			names.push_back(it.first);
+
+		resolveAttributes();
+		setColumnNames(names);
+
+		if (mAsync && !mWriter.joinable())
+			startWriter((UInt) mRowValues.size());
+	}
+
+	prefaultVector(mRowValues);
+	prefaultVector(mChunkTimes);
+	prefaultVector(mChunkValues);
+	prefaultVector(mChunkFloats);
+	prefaultVector(mSlots);
+}
+
+void DataLogger::startWriter(UInt count) {
+	mRowSize = count + 1;
+	mSlots.resize(mCapacity * mRowSize);
+
+	mWriter = std::thread(&DataLogger::write, this);
+}
+
+void DataLogger::stopWriter() {
+	if (!mWriter.joinable())
+		return;
+
+	mStopWriter = true;
+	mWriter.join();
+}
+
+void DataLogger::write() {
+	uint64_t written = mWrittenRows.load(std::memory_order_relaxed);
+
+	while (true) {
+		// Remaining rows are written before the thread is stopped
+		if (written == mEnqueuedRows.load(std::memory_order_acquire)) {
+			if (mStopWriter)
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
 		}
-		mLogFile << '\n';
+
+		const Real *row = &mSlots[(written % mCapacity) * mRowSize];
+		writeRow(row[0], row + 1, mRowSize - 1);
+
+		mWrittenRows.store(++written, std::memory_order_release);
 	}
 }
 
-void DataLogger::logDataLine(Real time, Real data) {
+void DataLogger::enqueueRow(Real time, const Real* values, UInt count) {
+	if (!mWriter.joinable())
+		startWriter(count);
+
+	if (mPolicy == OverflowPolicy::Decimate && mDecimationCounter++ % mDecimation != 0) {
+		mDecimatedSamples++;
+		return;
+	}
+
+	uint64_t enqueued = mEnqueuedRows.load(std::memory_order_relaxed);
+
+	while (enqueued - mWrittenRows.load(std::memory_order_acquire) >= mCapacity) {
+		if (mPolicy == OverflowPolicy::Block) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		mDroppedSamples++;
+		if (mPolicy == OverflowPolicy::Decimate) {
+			mDecimation *= 2;
+			mDecimationCounter = 1;
+		}
+		return;
+	}
+
+	if (mPolicy == OverflowPolicy::Decimate && mDecimation > 1 &&
+		enqueued - mWrittenRows.load(std::memory_order_relaxed) < mCapacity / 2)
+		mDecimation /= 2;
+
+	Real *row = &mSlots[(enqueued % mCapacity) * mRowSize];
+	row[0] = time;
+	for (UInt i = 1; i < mRowSize; i++)
+		row[i] = i <= count ? values[i - 1] : std::numeric_limits<Real>::quiet_NaN();
+
+	mEnqueuedRows.store(enqueued + 1, std::memory_order_release);
+}
+
+void DataLogger::writeRow(Real time, const Real* values, UInt count) {
+	if (mFormat == Format::Binary)
+		logBinaryRow(time, values, count);
+	else
+		writeCSVRow(time, values, count);
+}
+
+void DataLogger::logRow(Real time, const Real* values, UInt count) {
 	if (!mEnabled)
 		return;
-		
+
+	// The header is always written by the logging thread before the writer starts
+	if (!mHeaderWritten) {
+		if (mFormat == Format::Binary) {
+			std::vector<String> names;
+			for (UInt i = 0; i < count; i++) {
+				std::stringstream name;
+				name << "column" << std::setfill('0') << std::setw(5) << i;
+				names.push_back(name.str());
+			}
+			writeBinaryHeader(names);
+		}
+		mHeaderWritten = true;
+	}
+
+	if (mAsync)
+		enqueueRow(time, values, count);
+	else
+		writeRow(time, values, count);
+}
+
+void DataLogger::writeCSVRow(Real time, const Real* values, UInt count) {
 	mLogFile << std::scientific << std::right << std::setw(14) << time;
-	mLogFile << ", " << std::right << std::setw(13) << data;
+	for (UInt i = 0; i < count; i++) {
+		mLogFile << ", " << std::right << std::setw(13) << values[i];
+	}
 	mLogFile << '\n';
 }
 
-void DataLogger::logDataLine(Real time, const Matrix& data) {
-	if (!mEnabled)
+template <typename T>
+static void writeValue(std::ofstream &file, T value) {
+	file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void writeString(std::ofstream &file, const String &str) {
+	writeValue<uint32_t>(file, (uint32_t) str.size());
+	file.write(str.data(), str.size());
+}
+
+void DataLogger::writeBinaryHeader(const std::vector<String>& names) {
+	mHeaderWritten = true;
+	mColumns = (UInt) names.size();
+
+	mLogFile.write("DPSIMLOG", 8);
+	writeValue<uint32_t>(mLogFile, 1);
+	writeValue<uint32_t>(mLogFile, 0x01020304);
+	writeValue<uint32_t>(mLogFile, mPrecision);
+	writeValue<uint32_t>(mLogFile, mColumns + 1);
+
+	writeString(mLogFile, "time");
+	writeString(mLogFile, "s");
+	for (auto& name : names) {
+		auto unit = mUnits.find(name);
+		writeString(mLogFile, name);
+		writeString(mLogFile, unit != mUnits.end() ? unit->second : "");
+	}
+
+	mChunkTimes.resize(mChunkSize);
+	mChunkValues.resize(mChunkSize * mColumns);
+	if (mPrecision == 4)
+		mChunkFloats.resize(mChunkSize);
+}
+
+void DataLogger::logBinaryRow(Real time, const Real* values, UInt count) {
+	mChunkTimes[mChunkRows] = time;
+	for (UInt i = 0; i < mColumns; i++) {
+		mChunkValues[i * mChunkSize + mChunkRows] = i < count
+			? values[i]
+			: std::numeric_limits<Real>::quiet_NaN();
+	}
+
+	if (++mChunkRows == mChunkSize)
+		writeChunk();
+}
+
+void DataLogger::writeChunk() {
+	if (mChunkRows == 0)
 		return;
 
-	mLogFile << std::scientific << std::right << std::setw(14) << time;
-	for (Int i = 0; i < data.rows(); i++) {
-		mLogFile << ", " << std::right << std::setw(13) << data(i, 0);
+	writeValue<uint32_t>(mLogFile, mChunkRows);
+	mLogFile.write(reinterpret_cast<const char *>(mChunkTimes.data()), mChunkRows * sizeof(Real));
+
+	for (UInt i = 0; i < mColumns; i++) {
+		const Real *column = &mChunkValues[i * mChunkSize];
+
+		if (mPrecision == 4) {
+			for (UInt k = 0; k < mChunkRows; k++)
+				mChunkFloats[k] = (float) column[k];
+			mLogFile.write(reinterpret_cast<const char *>(mChunkFloats.data()), mChunkRows * sizeof(float));
+		}
+		else
+			mLogFile.write(reinterpret_cast<const char *>(column), mChunkRows * sizeof(Real));
+	}
+
+	mChunkRows = 0;
+}
+
+void DataLogger::resolveAttributes() {
+	mRealAttributes.clear();
+	mIntAttributes.clear();
+
+	// Complex and matrix attributes have already been split into
+	// real and integer attributes by addAttribute()
+	for (auto it : mAttributes) {
+		auto realAttr = std::dynamic_pointer_cast<CPS::Attribute<Real>>(it.second);
+		auto intAttr = std::dynamic_pointer_cast<CPS::Attribute<Int>>(it.second);
+		if (!realAttr && !intAttr)
+			throw CPS::InvalidAttributeException();
+
+		mRealAttributes.push_back(realAttr);
+		mIntAttributes.push_back(intAttr);
+	}
+
+	mRowValues.resize(mAttributes.size());
+}
+
+void DataLogger::setColumnNames(std::vector<String> names) {
+	if (!mEnabled || mHeaderWritten)
+		return;
+
+	if (mFormat == Format::Binary) {
+		writeBinaryHeader(names);
+		return;
+	}
+
+	mHeaderWritten = true;
+	mLogFile << std::right << std::setw(14) << "time";
+	for (auto name : names) {
+		mLogFile << ", " << std::right << std::setw(13) << name;
 	}
 	mLogFile << '\n';
 }
 
+void DataLogger::logDataLine(Real time, Real data) {
+	if (!mEnabled)
+		return;
+
+	logRow(time, &data, 1);
+}
+
+void DataLogger::logDataLine(Real time, const Matrix& data) {
+	if (!mEnabled)
+		return;
+
+	// The first column is stored contiguously
+	logRow(time, data.data(), (UInt) data.rows());
+}
+
 void DataLogger::logDataLine(Real time, const MatrixComp& data) {
 	if (!mEnabled)
 		return;
+
+	if (mFormat == Format::Binary || mAsync) {
+		// Real and imaginary part are stored in separate columns
+		logRow(time, reinterpret_cast<const Real *>(data.data()), 2 * (UInt) data.rows());
+		return;
+	}
+
+	mHeaderWritten = true;
 	mLogFile << std::scientific << std::right << std::setw(14) << time;
 	for (Int i = 0; i < data.rows(); i++) {
 		mLogFile << ", " << std::right << std::setw(13) << data(i, 0);
@@ -97,7 +364,7 @@ void DataLogger::logDataLine(Real time, const MatrixComp& data) {
 }
 
 void DataLogger::logPhasorNodeValues(Real time, const Matrix& data) {
-	if (mLogFile.tellp() == std::ofstream::pos_type(0)) {
+	if (!mHeaderWritten) {
 		std::vector<String> names;
 		for (Int i = 0; i < data.rows(); i++) {
 			std::stringstream name;
@@ -113,7 +380,7 @@ void DataLogger::logPhasorNodeValues(Real time, const Matrix& data) {
 }
 
 void DataLogger::logEMTNodeValues(Real time, const Matrix& data) {
-	if (mLogFile.tellp() == std::ofstream::pos_type(0)) {
+	if (!mHeaderWritten) {
 		std::vector<String> names;
 		for (Int i = 0; i < data.rows(); i++) {
 			std::stringstream name;
@@ -126,7 +393,31 @@ void DataLogger::logEMTNodeValues(Real time, const Matrix& data) {
 }
 
 void DataLogger::log(Real time) {
-	if (mLogFile.tellp() == std::ofstream::pos_type(0)) {
+	if (mFormat == Format::Binary || mAsync) {
+		if (!mEnabled)
+			return;
+
+		if (!mHeaderWritten) {
+			std::vector<String> names;
+			for (auto it : mAttributes)
+				names.push_back(it.first);
+
+			resolveAttributes();
+			setColumnNames(names);
+		}
+
+		for (UInt i = 0; i < mRowValues.size(); i++) {
+			mRowValues[i] = mRealAttributes[i]
+				? mRealAttributes[i]->get()
+				: (Real) mIntAttributes[i]->get();
+		}
+
+		logRow(time, mRowValues.data(), (UInt) mRowValues.size());
+		return;
+	}
+
+	if (!mHeaderWritten) {
+		mHeaderWritten = true;
 		mLogFile << std::right << std::setw(14) << "time";
 		for (auto it : mAttributes)
 			mLogFile << ", " << std::right << std::setw(13) << it.first;
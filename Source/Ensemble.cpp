@@ -0,0 +1,127 @@
+/** Ensemble of simulations
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
+#include <dpsim/Ensemble.h>
+#include <dpsim/SharedFactorizations.h>
+#include <dpsim/Utils.h>
+
+using namespace CPS;
+using namespace DPsim;
+
+Ensemble::Ensemble(String name, TopologyFactory topology,
+	Real timeStep, Real finalTime,
+	Domain domain, Solver::Type solverType,
+	Logger::Level logLevel) :
+	mName(name),
+	mTopology(topology),
+	mTimeStep(timeStep),
+	mFinalTime(finalTime),
+	mDomain(domain),
+	mSolverType(solverType),
+	mLogLevel(logLevel) { }
+
+std::unique_ptr<Simulation> Ensemble::createScenario(const Scenario& scenario) {
+	String name = mName + "_" + scenario.name;
+	SystemTopology system = mTopology();
+
+	auto sim = std::make_unique<Simulation>(name, system, mTimeStep, mFinalTime, mDomain, mSolverType, mLogLevel);
+	sim->setSharedFactorizations(mFactorizations);
+
+	if (mSetup)
+		mSetup(*sim, system);
+	if (scenario.setup)
+		scenario.setup(*sim, system);
+
+	if (!mLoggedAttributes.empty()) {
+		auto logger = DataLogger::make(name + "_results");
+
+		auto objects = objectsByName(system);
+		for (auto& logged : mLoggedAttributes) {
+			auto obj = objects.find(logged.first);
+			if (obj == objects.end())
+				throw std::invalid_argument("Unknown object " + logged.first + " in scenario " + scenario.name);
+
+			logger->addAttribute(logged.first + "." + logged.second, obj->second->attribute(logged.second));
+		}
+
+		sim->addLogger(logger);
+	}
+
+	return sim;
+}
+
+void Ensemble::runBatch(UInt first, UInt count) {
+	std::vector<std::unique_ptr<Simulation>> sims;
+	std::vector<Simulation*> batch;
+
+	for (UInt i = first; i < first + count; i++) {
+		sims.push_back(createScenario(mScenarios[i]));
+		batch.push_back(sims.back().get());
+	}
+
+	if (batch.size() == 1)
+		batch[0]->run();
+	else
+		Simulation::runBatch(batch);
+}
+
+void Ensemble::run(UInt threads) {
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	UInt batches = ((UInt) mScenarios.size() + mBatchSize - 1) / mBatchSize;
+	threads = std::min(threads, batches);
+
+	mFactorizations = std::make_shared<SharedFactorizations>();
+
+	// Scenarios take very different times, so each thread takes the next
+	// batch as soon as it has finished the last one
+	std::atomic<UInt> next(0);
+	std::vector<std::exception_ptr> errors(batches);
+
+	auto work = [&]() {
+		for (UInt i = next++; i < batches; i = next++) {
+			try {
+				UInt first = i * mBatchSize;
+				runBatch(first, std::min(mBatchSize, (UInt) mScenarios.size() - first));
+			}
+			catch (...) {
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (UInt i = 1; i < threads; i++)
+		workers.emplace_back(work);
+	work();
+
+	for (auto& worker : workers)
+		worker.join();
+
+	for (auto& error : errors) {
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
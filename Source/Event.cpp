@@ -19,25 +19,315 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *********************************************************************************/
 
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <experimental/filesystem>
+
+namespace fs = std::experimental::filesystem;
+
 #include <dpsim/Event.h>
+#include <dpsim/Utils.h>
 
 using namespace DPsim;
 using namespace CPS;
 
+EventQueue::EventQueue(Real timeStep, UInt buckets) :
+	mTimeStep(timeStep) {
+	UInt size = 1;
+	while (size < buckets)
+		size <<= 1;
+
+	mBuckets.resize(size);
+}
+
+UInt EventQueue::stepIndex(Real time) const {
+	// Tolerate rounding errors of event times which are multiples of the time step
+	Real steps = time / mTimeStep - 1e-6;
+
+	return steps > 0 ? (UInt) std::ceil(steps) : 0;
+}
+
+static bool entryBefore(UInt step1, Real time1, UInt step2, Real time2) {
+	return step1 < step2 || (step1 == step2 && time1 < time2);
+}
+
+void EventQueue::insert(Entry entry) {
+	if (entry.step < mNextStep)
+		entry.step = mNextStep;
+
+	if (mSize >= 2 * mBuckets.size())
+		resize(2 * mBuckets.size());
+
+	auto &bucket = mBuckets[entry.step & (mBuckets.size() - 1)];
+
+	if (bucket.empty() || !entryBefore(entry.step, entry.event->mTime, bucket.back().step, bucket.back().event->mTime))
+		bucket.push_back(std::move(entry));
+	else {
+		auto it = std::upper_bound(bucket.begin(), bucket.end(), entry, [](const Entry &l, const Entry &r) {
+			return entryBefore(l.step, l.event->mTime, r.step, r.event->mTime);
+		});
+		bucket.insert(it, std::move(entry));
+	}
+
+	mSize++;
+}
+
+void EventQueue::resize(UInt buckets) {
+	std::vector<Entry> entries;
+	entries.reserve(mSize);
+
+	// Entries of the same step share a bucket, so the stable sort keeps their order
+	for (auto &bucket : mBuckets) {
+		for (auto &entry : bucket)
+			entries.push_back(std::move(entry));
+	}
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry &l, const Entry &r) {
+		return entryBefore(l.step, l.event->mTime, r.step, r.event->mTime);
+	});
+
+	mBuckets.clear();
+	mBuckets.resize(buckets);
+
+	for (auto &entry : entries)
+		mBuckets[entry.step & (buckets - 1)].push_back(std::move(entry));
+}
+
 void EventQueue::addEvent(Event::Ptr e) {
-	mEvents.push(e);
+	insert({ stepIndex(e->mTime), e });
+}
+
+void EventQueue::addEvents(const std::vector<Event::Ptr> &events) {
+	UInt buckets = mBuckets.size();
+	while (2 * buckets < mSize + events.size())
+		buckets <<= 1;
+
+	if (buckets != mBuckets.size())
+		resize(buckets);
+
+	for (auto &e : events)
+		insert({ stepIndex(e->mTime), e });
+}
+
+void EventQueue::loadEvents(const String &filename, const SystemTopology &system) {
+	std::ifstream file(filename);
+	if (!file.is_open())
+		throw SystemError("Cannot open event file " + filename);
+
+	auto objects = objectsByName(system);
+	std::vector<Event::Ptr> events;
+	String line;
+	UInt lineNumber = 0;
+
+	while (std::getline(file, line)) {
+		lineNumber++;
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::vector<String> fields;
+		std::stringstream ss(line);
+		String field;
+		while (std::getline(ss, field, ','))
+			fields.push_back(field);
+
+		auto error = [&](const String &msg) {
+			return std::invalid_argument(filename + ":" + std::to_string(lineNumber) + ": " + msg);
+		};
+
+		if (fields.size() < 4 || fields.size() > 5)
+			throw error("Expected time, object, attribute, value and optional imaginary part");
+
+		Real time;
+		try {
+			time = std::stod(fields[0]);
+		} catch (std::logic_error &) {
+			// Skip the header
+			if (lineNumber == 1)
+				continue;
+			throw error("Invalid time " + fields[0]);
+		}
+
+		const String &objName = fields[1];
+		const String &attrName = fields[2];
+		const String &value = fields[3];
+
+		auto obj = objects.find(objName);
+		if (obj == objects.end())
+			throw error("Unknown object " + objName);
+
+		Event::Ptr evt;
+		try {
+			obj->second->attribute(attrName);
+
+			if (auto attr = obj->second->attribute<Real>(attrName))
+				evt = AttributeEvent<Real>::make(time, attr, std::stod(value));
+			else if (auto attr = obj->second->attribute<Complex>(attrName))
+				evt = AttributeEvent<Complex>::make(time, attr,
+					Complex(std::stod(value), fields.size() > 4 ? std::stod(fields[4]) : 0));
+			else if (auto attr = obj->second->attribute<Int>(attrName))
+				evt = AttributeEvent<Int>::make(time, attr, (Int) std::stol(value));
+			else if (auto attr = obj->second->attribute<UInt>(attrName))
+				evt = AttributeEvent<UInt>::make(time, attr, (UInt) std::stoul(value));
+			else if (auto attr = obj->second->attribute<Bool>(attrName)) {
+				if (value != "true" && value != "false" && value != "1" && value != "0")
+					throw error("Invalid boolean " + value);
+				evt = AttributeEvent<Bool>::make(time, attr, value == "true" || value == "1");
+			}
+			else
+				throw error("Unsupported type of attribute " + attrName);
+		}
+		catch (InvalidAttributeException &) {
+			throw error("Unknown attribute " + objName + "." + attrName);
+		}
+		catch (std::invalid_argument &) {
+			throw error("Invalid value " + value);
+		}
+		catch (std::out_of_range &) {
+			throw error("Invalid value " + value);
+		}
+
+		evt->setName(objName + "." + attrName);
+		events.push_back(evt);
+	}
+
+	addEvents(events);
+}
+
+void EventQueue::execute(const Entry &entry, Real currentTime) {
+	entry.event->execute();
+	mExecuted++;
+
+	if (mLog.is_open()) {
+		mLog << currentTime << "," << entry.step << "," << entry.event->mTime << ",";
+		entry.event->describe(mLog);
+		mLog << '\n';
+	}
 }
 
 void EventQueue::handleEvents(Real currentTime) {
-	Event::Ptr e;
+	UInt step = (UInt) std::llround(currentTime / mTimeStep);
+	if (step < mNextStep)
+		return;
+
+	mLastTime = currentTime;
+
+	if (mSize == 0) {
+		mNextStep = step + 1;
+		return;
+	}
+
+	// Take the due events out of the buckets before executing them,
+	// as events may schedule further events
+	std::vector<Entry> due;
+
+	if (step - mNextStep >= mBuckets.size()) {
+		// More than one calendar year has been skipped
+		for (auto &bucket : mBuckets) {
+			while (!bucket.empty() && bucket.front().step <= step) {
+				due.push_back(std::move(bucket.front()));
+				bucket.pop_front();
+			}
+		}
+		std::stable_sort(due.begin(), due.end(), [](const Entry &l, const Entry &r) {
+			return entryBefore(l.step, l.event->mTime, r.step, r.event->mTime);
+		});
+	}
+	else {
+		for (UInt s = mNextStep; s <= step; s++) {
+			auto &bucket = mBuckets[s & (mBuckets.size() - 1)];
+
+			while (!bucket.empty() && bucket.front().step <= s) {
+				due.push_back(std::move(bucket.front()));
+				bucket.pop_front();
+			}
+		}
+	}
+
+	mNextStep = step + 1;
+	mSize -= due.size();
+
+	for (auto &entry : due)
+		execute(entry, currentTime);
+}
+
+void EventQueue::skip(Real time) {
+	UInt step = (UInt) std::llround(time / mTimeStep);
+	if (step <= mNextStep)
+		return;
+
+	for (auto &bucket : mBuckets) {
+		while (!bucket.empty() && bucket.front().step < step) {
+			bucket.pop_front();
+			mSize--;
+		}
+	}
+
+	mNextStep = step;
+	mLastTime = (step - 1) * mTimeStep;
+}
+
+Real EventQueue::nextStepTime(Real until) const {
+	UInt last = (UInt) std::llround(until / mTimeStep);
+	UInt next = std::numeric_limits<UInt>::max();
+
+	if (mSize == 0 || last < mNextStep)
+		return std::numeric_limits<Real>::infinity();
+
+	if (last - mNextStep >= mBuckets.size()) {
+		// The front of each bucket is its earliest entry
+		for (auto &bucket : mBuckets) {
+			if (!bucket.empty())
+				next = std::min(next, bucket.front().step);
+		}
+	}
+	else {
+		for (UInt s = mNextStep; s <= last; s++) {
+			auto &bucket = mBuckets[s & (mBuckets.size() - 1)];
+
+			if (!bucket.empty() && bucket.front().step <= s) {
+				next = s;
+				break;
+			}
+		}
+	}
+
+	return next <= last ? next * mTimeStep : std::numeric_limits<Real>::infinity();
+}
+
+void EventQueue::setTimeStep(Real timeStep) {
+	if (mNextStep > 0)
+		mNextStep = (UInt) std::llround(mLastTime / timeStep) + 1;
+	mTimeStep = timeStep;
+
+	for (auto &bucket : mBuckets) {
+		for (auto &entry : bucket)
+			entry.step = std::max(stepIndex(entry.event->mTime), mNextStep);
+	}
+
+	resize(mBuckets.size());
+}
+
+void EventQueue::setLog(const String &filename) {
+	if (mLog.is_open())
+		mLog.close();
+
+	if (filename.empty())
+		return;
 
-	while (!mEvents.empty()) {
-		e = mEvents.top();
-		if (e->mTime > currentTime)
-			break;
+	fs::path p = filename;
 
-		e->execute();
-		std::cout << currentTime << ": Handle event" << std::endl;
-		mEvents.pop();
+	if (p.has_parent_path() && !fs::exists(p.parent_path()))
+		fs::create_directory(p.parent_path());
+
+	mLog.open(filename);
+	if (!mLog.is_open()) {
+		std::cerr << Logger::prefix() << "Cannot open event log " << filename << std::endl;
+		return;
 	}
+
+	mLog << std::setprecision(12);
+	mLog << "time,step,scheduled,event,value" << '\n';
 }
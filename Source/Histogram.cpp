@@ -0,0 +1,91 @@
+/** Latency histogram
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <dpsim/Histogram.h>
+
+using namespace DPsim;
+
+UInt Histogram::bucket(uint64_t value) {
+	// Values below two times the sub-buckets are stored linearly
+	if (value < 2 * subBuckets)
+		return (UInt) value;
+
+	UInt exponent = 63 - __builtin_clzll(value);
+	if (exponent > maxExponent)
+		return numBuckets - 1;
+
+	UInt sub = (value >> (exponent - subBucketBits)) & (subBuckets - 1);
+
+	return 2 * subBuckets + (exponent - subBucketBits - 1) * subBuckets + sub;
+}
+
+uint64_t Histogram::lowerBound(UInt bucket) {
+	if (bucket < 2 * subBuckets)
+		return bucket;
+
+	UInt exponent = (bucket - 2 * subBuckets) / subBuckets + subBucketBits + 1;
+	UInt sub = (bucket - 2 * subBuckets) % subBuckets;
+
+	return (uint64_t) (subBuckets + sub) << (exponent - subBucketBits);
+}
+
+void Histogram::reset() {
+	for (auto &b : mBuckets)
+		b.store(0, std::memory_order_relaxed);
+
+	mCount.store(0, std::memory_order_relaxed);
+	mSum.store(0, std::memory_order_relaxed);
+	mMin.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+	mMax.store(0, std::memory_order_relaxed);
+}
+
+Real Histogram::mean() const {
+	uint64_t cnt = count();
+
+	return cnt ? (Real) mSum.load(std::memory_order_relaxed) / cnt : 0;
+}
+
+uint64_t Histogram::percentile(Real fraction) const {
+	uint64_t cnt = count();
+	if (cnt == 0)
+		return 0;
+	if (fraction >= 1)
+		return max();
+
+	uint64_t rank = (uint64_t) std::ceil(std::min(std::max(fraction, 0.0), 1.0) * cnt);
+	uint64_t seen = 0;
+
+	for (UInt i = 0; i < numBuckets; i++) {
+		seen += mBuckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank && seen > 0) {
+			// Report the middle of the bucket, but never more than the maximum
+			uint64_t upper = i + 1 < numBuckets ? lowerBound(i + 1) : max() + 1;
+			uint64_t value = (lowerBound(i) + upper - 1) / 2;
+
+			return std::min(std::max(value, min()), max());
+		}
+	}
+
+	return max();
+}
@@ -20,8 +20,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *********************************************************************************/
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+#endif
 
 #include <dpsim/Interface.h>
 #include <cps/Logger.h>
@@ -35,6 +42,8 @@ using namespace DPsim;
 void Interface::open() {
 	std::cout << Logger::prefix() << "Opening interface: " <<  mWName << " <-> " << mRName << std::endl;
 
+	resolveMappings();
+
 	if (shmem_int_open(mWName.c_str(), mRName.c_str(), &mShmem, &mConf) < 0) {
 		std::perror("Failed to open/map shared memory object");
 		std::exit(1);
@@ -43,6 +52,10 @@ void Interface::open() {
 	std::cout << Logger::prefix() << "Opened interface: " <<  mWName << " <-> " << mRName << std::endl;
 
 	mSequence = 0;
+	mBatched = 0;
+	mStatistics = Statistics();
+	mWriteBatch.assign(mBatchSize, nullptr);
+	mReadBatch.assign(mBatchSize, nullptr);
 
 	if (shmem_int_alloc(&mShmem, &mLastSample, 1) < 0) {
 		std::cout << Logger::prefix() << "Failed to allocate single sample from pool" << std::endl;
@@ -53,179 +66,341 @@ void Interface::open() {
 	mLastSample->ts.origin.tv_sec = 0;
 	mLastSample->ts.origin.tv_nsec = 0;
 
-	std::memset(&mLastSample->data, 0, mLastSample->capacity * sizeof(float));
+	std::memset(&mLastSample->data, 0, mLastSample->capacity * sizeof(mLastSample->data[0]));
+
+	mOpened = true;
 }
 
 void Interface::close() {
+	releaseBatch();
+	sample_decref(mLastSample);
+
 	shmem_int_close(&mShmem);
+
+	mOpened = false;
+}
+
+template<typename T>
+static Int sortMappings(std::vector<T> &mappings, Int width = 1) {
+	std::sort(mappings.begin(), mappings.end(), [](const T &a, const T &b) {
+		return a.idx < b.idx;
+	});
+
+	return mappings.empty() ? 0 : mappings.back().idx + width;
+}
+
+void Interface::resolveMappings() {
+	// Sorted mappings access the samples in ascending address order
+	Int complexWidth = mDoublePrecision ? 2 : 1;
+
+	mImportLength = std::max({
+		sortMappings(mIntImports),
+		sortMappings(mRealImports),
+		sortMappings(mBoolImports),
+		sortMappings(mComplexImports, complexWidth)
+	});
+
+	mExportLength = std::max({
+		sortMappings(mIntExports),
+		sortMappings(mRealExports),
+		sortMappings(mBoolExports),
+		sortMappings(mComplexExports, complexWidth),
+		mExportCallbackLength
+	});
+
+	if (mExportLength > mConf.samplelen)
+		throw std::out_of_range("not enough space in allocated sample");
+}
+
+void Interface::importValues(Sample *smp) {
+	if (mImportLength > smp->length)
+		throw std::length_error("incomplete data received from interface");
+
+	for (auto &m : mIntImports)
+		m.attribute->set(smp->data[m.idx].i);
+
+	for (auto &m : mRealImports)
+		m.attribute->set(smp->data[m.idx].f);
+
+	for (auto &m : mBoolImports)
+		m.attribute->set(smp->data[m.idx].b);
+
+	if (mDoublePrecision) {
+		for (auto &m : mComplexImports)
+			m.attribute->set(Complex(smp->data[m.idx].f, smp->data[m.idx+1].f));
+	}
+	else {
+		for (auto &m : mComplexImports) {
+			auto *z = reinterpret_cast<float*>(&smp->data[m.idx].z);
+
+			m.attribute->set(Complex(z[0], z[1]));
+		}
+	}
+
+	for (auto imp : mImports) {
+		imp(smp);
+	}
+}
+
+void Interface::exportValues(Sample *smp) {
+	smp->length = mExportLength;
+
+	for (auto &m : mIntExports)
+		smp->data[m.idx].i = m.attribute->get();
+
+	for (auto &m : mRealExports)
+		smp->data[m.idx].f = m.attribute->get();
+
+	for (auto &m : mBoolExports)
+		smp->data[m.idx].b = m.attribute->get();
+
+	if (mDoublePrecision) {
+		for (auto &m : mComplexExports) {
+			auto y = m.attribute->get();
+
+			smp->data[m.idx].f   = y.real();
+			smp->data[m.idx+1].f = y.imag();
+		}
+	}
+	else {
+		for (auto &m : mComplexExports) {
+			auto  y = m.attribute->get();
+			auto *z = reinterpret_cast<float*>(&smp->data[m.idx].z);
+
+			z[0] = y.real();
+			z[1] = y.imag();
+		}
+	}
+
+	for (auto exp : mExports) {
+		exp(smp);
+	}
+
+	// Callbacks may have written beyond the mapped values
+	smp->length = std::max<Int>(smp->length, mExportLength);
+}
+
+static inline void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#endif
+}
+
+Int Interface::waitForSamples() {
+	auto start = Timer::IntervalClock::now();
+	auto deadline = Timer::IntervalTimePoint::max();
+
+	if (mReadTimeout > Timer::Ticks::zero())
+		deadline = start + mReadTimeout;
+	if (mDeadline > Timer::IntervalTimePoint() && mDeadline < deadline)
+		deadline = mDeadline;
+
+	// Without a deadline the read blocks until the remote sends, which is
+	// reported so that a stalled remote does not hang the simulation silently
+	Bool unbounded = deadline == Timer::IntervalTimePoint::max();
+	Timer::Ticks stall = std::chrono::seconds(1);
+
+	Int ret = 0;
+	UInt polls = 0;
+	Timer::Ticks sleep = std::chrono::microseconds(1);
+
+	for (;;) {
+		// Only read if data is available, as the read itself might block
+		if (queue_signalled_available(&mShmem.read.shared->queue) > 0) {
+			ret = shmem_int_read(&mShmem, mReadBatch.data(), mBatchSize);
+			if (ret != 0)
+				break;
+		}
+
+		auto now = Timer::IntervalClock::now();
+		if (now >= deadline)
+			break;
+
+		if (unbounded && now - start >= stall) {
+			std::cerr << Logger::prefix() << "WARNING: No samples from interface " << name() << " for "
+				<< std::chrono::duration_cast<std::chrono::seconds>(now - start).count()
+				<< " s, blocking reads have no deadline or timeout" << std::endl;
+			stall *= 2;
+		}
+
+		if (polls < mSpins)
+			relax();
+		else if (polls < mSpins + mYields)
+			std::this_thread::yield();
+		else {
+			std::this_thread::sleep_until(std::min<Timer::IntervalTimePoint>(now + sleep, deadline));
+			sleep = std::min(2 * sleep, mMaxSleep);
+		}
+
+		polls++;
+	}
+
+	auto wait = Timer::IntervalClock::now() - start;
+
+	mStatistics.waitTime += wait;
+	mStatistics.maxWaitTime = std::max<Timer::Ticks>(mStatistics.maxWaitTime, wait);
+
+	if (ret == 0)
+		mStatistics.missedSamples++;
+	else if (polls > mSpins + mYields)
+		mStatistics.lateSamples++;
+
+	return ret;
 }
 
 void Interface::readValues(bool blocking) {
-	Sample *sample = nullptr;
 	int ret = 0;
 	try {
 		if (!blocking) {
 			// Check if theres actually data available
 			ret = queue_signalled_available(&mShmem.read.shared->queue);
-			if (ret <= 0)
-				return;
-
-			ret = shmem_int_read(&mShmem, &sample, 1);
-			if (ret == 0)
-				return;
+			ret = ret > 0 ? shmem_int_read(&mShmem, mReadBatch.data(), mBatchSize) : 0;
 		}
-		else {
-			while (ret == 0)
-				ret = shmem_int_read(&mShmem, &sample, 1);
+		else
+			ret = waitForSamples();
+
+		if (ret == 0) {
+			if (!blocking)
+				mStatistics.missedSamples++;
+			return;
 		}
 		if (ret < 0) {
 			std::cerr << Logger::prefix() << "Fatal error: failed to read sample from interface" << std::endl;
 			std::exit(1);
 		}
 
-		for (auto imp : mImports) {
-			imp(sample);
-		}
+		// Imports describe the current state of the remote, so only the newest sample is used
+		importValues(mReadBatch[ret - 1]);
+		mStatistics.reads += ret;
 
-		sample_decref(sample);
+		sample_decref_many(mReadBatch.data(), ret);
 	}
 	catch (std::exception& exc) {
 		/* probably won't happen (if the timer expires while we're still reading data,
 		 * we have a bigger problem somewhere else), but nevertheless, make sure that
 		 * we're not leaking memory from the queue pool */
-		if (sample)
-			sample_decref(sample);
+		if (ret > 0)
+			sample_decref_many(mReadBatch.data(), ret);
 		throw exc;
 	}
 }
 
+Int Interface::writeBatch(UInt cnt) {
+	Int ret = 0;
+	UInt written = 0;
+
+	// Keep a reference to the newest sample, so that it can be resent without copying
+	sample_incref(mWriteBatch[cnt - 1]);
+	sample_decref(mLastSample);
+	mLastSample = mWriteBatch[cnt - 1];
+
+	while (written < cnt) {
+		ret = shmem_int_write(&mShmem, mWriteBatch.data() + written, cnt - written);
+		if (ret < 0)
+			break;
+
+		written += ret;
+	}
+
+	// Samples which could not be written are not owned by the queue
+	if (written < cnt)
+		sample_decref_many(mWriteBatch.data() + written, cnt - written);
+
+	mBatched = 0;
+
+	return ret;
+}
+
+void Interface::releaseBatch() {
+	if (mBatched > 0)
+		sample_decref_many(mWriteBatch.data(), mBatchSize);
+
+	mBatched = 0;
+}
+
 void Interface::writeValues() {
 	Sample *sample = nullptr;
 	Int ret = 0;
-	bool done = false;
 	try {
-		if (shmem_int_alloc(&mShmem, &sample, 1) < 1) {
+		if (mBatched == 0 && shmem_int_alloc(&mShmem, mWriteBatch.data(), mBatchSize) < (Int) mBatchSize) {
 			std::cerr << Logger::prefix() << "Fatal error: pool underrun in: " << mWName << " <->" << mRName;
 			std::cerr << " at sequence no " << mSequence << std::endl;
 			std::exit(1);
 		}
 
-		for (auto exp : mExports) {
-			exp(sample);
-		}
+		sample = mWriteBatch[mBatched++];
+
+		exportValues(sample);
 
 		sample->sequence = mSequence++;
 		clock_gettime(CLOCK_REALTIME, &sample->ts.origin);
-		done = true;
 
-		do {
-			ret = shmem_int_write(&mShmem, &sample, 1);
-		} while (ret == 0);
+		if (mBatched < mBatchSize)
+			return;
+
+		ret = writeBatch(mBatchSize);
 		if (ret < 0)
 			std::cerr << Logger::prefix() << "Failed to write samples to interface" << std::endl;
-
-		sample_copy(mLastSample, sample);
 	}
 	catch (std::exception& exc) {
-		/* We need to at least send something, so determine where exactly the
-		 * timer expired and either resend the last successfully sent sample or
-		 * just try to send this one again.
+		/* We need to at least send something, so drop the incomplete batch
+		 * and resend the last successfully sent sample.
 		 * TODO: can this be handled better? */
-		if (!done)
-			sample = mLastSample;
+		releaseBatch();
+
+		sample = mLastSample;
+		sample_incref(sample);
 
 		while (ret == 0)
 			ret = shmem_int_write(&mShmem, &sample, 1);
 
-		if (ret < 0)
+		if (ret < 0) {
+			sample_decref(sample);
 			std::cerr << Logger::prefix() << "Failed to write samples to interface" << std::endl;
+		}
 		/* Don't throw here, because we managed to send something */
 	}
 }
 
-void Interface::addImport(Attribute<Int>::Ptr attr, Int idx) {
-	addImport([attr, idx](Sample *smp) {
-		if (idx >= smp->length)
-			throw std::length_error("incomplete data received from interface");
+void Interface::flush() {
+	if (mBatched == 0)
+		return;
 
-		attr->set(smp->data[idx].i);
-	});
+	// Return the unused samples of the batch to the pool
+	sample_decref_many(mWriteBatch.data() + mBatched, mBatchSize - mBatched);
+
+	if (writeBatch(mBatched) < 0)
+		std::cerr << Logger::prefix() << "Failed to write samples to interface" << std::endl;
 }
 
-void Interface::addImport(Attribute<Real>::Ptr attr, Int idx) {
-	addImport([attr, idx](Sample *smp) {
-		if (idx >= smp->length)
-			throw std::length_error("incomplete data received from interface");
+void Interface::addImport(Attribute<Int>::Ptr attr, Int idx) {
+	mIntImports.push_back({attr, idx});
+}
 
-		attr->set(smp->data[idx].f);
-	});
+void Interface::addImport(Attribute<Real>::Ptr attr, Int idx) {
+	mRealImports.push_back({attr, idx});
 }
 
 void Interface::addImport(Attribute<Bool>::Ptr attr, Int idx) {
-	addImport([attr, idx](Sample *smp) {
-		if (idx >= smp->length)
-			throw std::length_error("incomplete data received from interface");
-
-		attr->set(smp->data[idx].b);
-	});
+	mBoolImports.push_back({attr, idx});
 }
 
 void Interface::addImport(Attribute<Complex>::Ptr attr, Int idx) {
-	addImport([attr, idx](Sample *smp) {
-		if (idx >= smp->length)
-			throw std::length_error("incomplete data received from interface");
-
-		auto *z = reinterpret_cast<float*>(&smp->data[idx].z);
-		auto  y = Complex(z[0], z[1]);
-
-		attr->set(y);
-	});
+	mComplexImports.push_back({attr, idx});
 }
 
 void Interface::addExport(Attribute<Int>::Ptr attr, Int idx) {
-	addExport([attr, idx](Sample *smp) {
-		if (idx >= smp->capacity)
-			throw std::out_of_range("not enough space in allocated sample");
-		if (idx >= smp->length)
-			smp->length = idx + 1;
-
-		smp->data[idx].i = attr->get();
-	});
+	mIntExports.push_back({attr, idx});
 }
 
 void Interface::addExport(Attribute<Real>::Ptr attr, Int idx) {
-	addExport([attr, idx](Sample *smp) {
-		if (idx >= smp->capacity)
-			throw std::out_of_range("not enough space in allocated sample");
-		if (idx >= smp->length)
-			smp->length = idx + 1;
-
-		smp->data[idx].f = attr->get();
-	});
+	mRealExports.push_back({attr, idx});
 }
 
 void Interface::addExport(Attribute<Bool>::Ptr attr, Int idx) {
-	addExport([attr, idx](Sample *smp) {
-		if (idx >= smp->capacity)
-			throw std::out_of_range("not enough space in allocated sample");
-		if (idx >= smp->length)
-			smp->length = idx + 1;
-
-		smp->data[idx].b = attr->get();;
-	});
+	mBoolExports.push_back({attr, idx});
 }
 
 void Interface::addExport(Attribute<Complex>::Ptr attr, Int idx) {
-	addExport([attr, idx](Sample *smp) {
-		if (idx >= smp->capacity)
-			throw std::out_of_range("not enough space in allocated sample");
-		if (idx >= smp->length)
-			smp->length = idx + 1;
-
-		auto  y = attr->get();;
-		auto *z = reinterpret_cast<float*>(&smp->data[idx].z);
-
-		z[0] = y.real();
-		z[1] = y.imag();
-	});
+	mComplexExports.push_back({attr, idx});
 }
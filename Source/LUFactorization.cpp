@@ -0,0 +1,203 @@
+/** LU factorization of system matrices
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <dpsim/LUFactorization.h>
+#include <dpsim/Checkpoint.h>
+
+using namespace DPsim;
+
+LUFactorization::LUFactorization(const Matrix& mat) :
+	mType(Solver::MatrixType::Dense),
+	mDenseLu(mat) { }
+
+LUFactorization::LUFactorization(const SparseMatrix& mat, const SparseOrdering& ordering) :
+	mType(Solver::MatrixType::Sparse) {
+
+	SparseMatrix permuted = mat * ordering.inverse();
+	permuted.makeCompressed();
+
+	// The column ordering has already been applied, so the analysis
+	// left for the solver is the elimination tree of the permuted matrix.
+	Eigen::SparseLU<SparseMatrix, Eigen::NaturalOrdering<int>> lu;
+	lu.analyzePattern(permuted);
+	lu.factorize(permuted);
+
+	if (lu.info() != Eigen::Success)
+		throw SolverException();
+
+	Int dim = permuted.rows();
+
+	// Supernodes store the diagonal blocks of U together with L.
+	// All other entries of U are stored column-wise in a separate matrix.
+	std::vector<Eigen::Triplet<Real>> lower, upper;
+	auto supernodes = lu.matrixL().m_mapL;
+	auto upperEntries = lu.matrixU().m_mapU;
+	for (Int col = 0; col < dim; col++) {
+		for (decltype(supernodes)::InnerIterator it(supernodes, col); it; ++it) {
+			if (it.row() > col)
+				lower.emplace_back(it.row(), col, it.value());
+			else
+				upper.emplace_back(it.row(), col, it.value());
+		}
+		for (decltype(upperEntries)::InnerIterator it(upperEntries, col); it; ++it)
+			upper.emplace_back(it.row(), col, it.value());
+	}
+
+	mLower.resize(dim, dim);
+	mLower.setFromTriplets(lower.begin(), lower.end());
+	mUpper.resize(dim, dim);
+	mUpper.setFromTriplets(upper.begin(), upper.end());
+
+	auto& rowPerm = lu.rowsPermutation().indices();
+	mRowPermutation.assign(rowPerm.data(), rowPerm.data() + dim);
+
+	SparseOrdering colPerm = (lu.colsPermutation() * ordering).inverse();
+	mColPermutation.assign(colPerm.indices().data(), colPerm.indices().data() + dim);
+
+	std::vector<Bool> visited(dim, false);
+	for (Int start = 0; start < dim; start++) {
+		if (visited[start] || mColPermutation[start] == start)
+			continue;
+		mColPermutationCycles.push_back(start);
+		for (Int i = start; !visited[i]; i = mColPermutation[i])
+			visited[i] = true;
+	}
+}
+
+void LUFactorization::computeOrdering(const SparseMatrix& mat, SparseOrdering& ordering) {
+	Eigen::COLAMDOrdering<int> colamd;
+	colamd(mat, ordering);
+}
+
+void LUFactorization::solve(const Matrix& rhs, Matrix& lhs) const {
+	lhs.resize(rhs.rows(), rhs.cols());
+
+	// Column-wise solves keep Eigen on its vector code paths,
+	// which work in place without temporary buffers.
+	for (Int col = 0; col < rhs.cols(); col++) {
+		auto x = lhs.col(col);
+
+		if (mType == Solver::MatrixType::Dense) {
+			x.noalias() = mDenseLu.permutationP() * rhs.col(col);
+			mDenseLu.matrixLU().triangularView<Eigen::UnitLower>().solveInPlace(x);
+			mDenseLu.matrixLU().triangularView<Eigen::Upper>().solveInPlace(x);
+			continue;
+		}
+
+		for (UInt i = 0; i < mRowPermutation.size(); i++)
+			x(mRowPermutation[i]) = rhs(i, col);
+
+		mLower.triangularView<Eigen::UnitLower>().solveInPlace(x);
+		mUpper.triangularView<Eigen::Upper>().solveInPlace(x);
+
+		// Rotate each cycle of the permutation, x(p(i)) = x(i)
+		for (auto start : mColPermutationCycles) {
+			Real carry = x(start);
+			for (Int i = mColPermutation[start]; i != start; i = mColPermutation[i])
+				std::swap(carry, x(i));
+			x(start) = carry;
+		}
+	}
+}
+
+void LUFactorization::solveBatch(const BatchMatrix& rhs, BatchMatrix& lhs) const {
+	lhs.resize(rhs.rows(), rhs.cols());
+
+	if (mType == Solver::MatrixType::Dense) {
+		lhs.noalias() = mDenseLu.permutationP() * rhs;
+		mDenseLu.matrixLU().triangularView<Eigen::UnitLower>().solveInPlace(lhs);
+		mDenseLu.matrixLU().triangularView<Eigen::Upper>().solveInPlace(lhs);
+		return;
+	}
+
+	for (UInt i = 0; i < mRowPermutation.size(); i++)
+		lhs.row(mRowPermutation[i]) = rhs.row(i);
+
+	// Each entry of the factors updates the row of all systems at once
+	for (Int col = 0; col < mLower.outerSize(); col++) {
+		for (SparseMatrix::InnerIterator it(mLower, col); it; ++it)
+			lhs.row(it.row()) -= it.value() * lhs.row(col);
+	}
+
+	for (Int col = mUpper.outerSize() - 1; col >= 0; col--) {
+		lhs.row(col) /= mUpper.coeff(col, col);
+
+		// The entries of a column are sorted and the diagonal is the last one
+		for (SparseMatrix::InnerIterator it(mUpper, col); it && it.row() < col; ++it)
+			lhs.row(it.row()) -= it.value() * lhs.row(col);
+	}
+
+	for (auto start : mColPermutationCycles) {
+		for (Int i = mColPermutation[start]; i != start; i = mColPermutation[i])
+			lhs.row(start).swap(lhs.row(i));
+	}
+}
+
+Matrix LUFactorization::solve(const Matrix& rhs) const {
+	Matrix lhs(rhs.rows(), rhs.cols());
+	solve(rhs, lhs);
+	return lhs;
+}
+
+void LUFactorization::write(std::ostream& os) const {
+	if (mType != Solver::MatrixType::Sparse)
+		throw SolverException();
+
+	Checkpoint::write(os, mLower);
+	Checkpoint::write(os, mUpper);
+	Checkpoint::write(os, mRowPermutation);
+	Checkpoint::write(os, mColPermutation);
+	Checkpoint::write(os, mColPermutationCycles);
+}
+
+LUFactorization::Ptr LUFactorization::read(std::istream& is) {
+	Ptr lu(new LUFactorization(Solver::MatrixType::Sparse));
+
+	Checkpoint::read(is, lu->mLower);
+	Checkpoint::read(is, lu->mUpper);
+	Checkpoint::read(is, lu->mRowPermutation);
+	Checkpoint::read(is, lu->mColPermutation);
+	Checkpoint::read(is, lu->mColPermutationCycles);
+
+	return lu;
+}
+
+std::size_t LUFactorization::memorySize() const {
+	if (mType == Solver::MatrixType::Dense)
+		return mDenseLu.matrixLU().size() * sizeof(Real)
+			+ mDenseLu.rows() * sizeof(int);
+
+	// Each nonzero of the factors is stored with its row index
+	return (mLower.nonZeros() + mUpper.nonZeros()) * (sizeof(Real) + sizeof(int))
+		+ (2 * mUpper.cols() + 3 * mColPermutation.size()) * sizeof(int);
+}
+
+void LUFactorization::print(std::ostream& os) const {
+	if (mType == Solver::MatrixType::Dense)
+		os << mDenseLu.matrixLU();
+	else
+		os << "Sparse LU factorization of dimension " << rows()
+			<< " with " << mLower.nonZeros() + mUpper.nonZeros() << " nonzeros";
+}
+
+std::ostream& DPsim::operator<<(std::ostream& os, const LUFactorization& lu) {
+	lu.print(os);
+	return os;
+}
@@ -0,0 +1,97 @@
+/** Low-rank update of an LU factorization
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <dpsim/LowRankUpdate.h>
+
+using namespace DPsim;
+
+static std::vector<UInt> touchedIndices(const SparseMatrix& mat) {
+	std::vector<Bool> touched(mat.rows(), false);
+
+	for (Int col = 0; col < mat.outerSize(); col++) {
+		for (SparseMatrix::InnerIterator it(mat, col); it; ++it) {
+			if (it.value() == 0)
+				continue;
+			touched[it.row()] = true;
+			touched[it.col()] = true;
+		}
+	}
+
+	std::vector<UInt> indices;
+	for (UInt i = 0; i < touched.size(); i++) {
+		if (touched[i])
+			indices.push_back(i);
+	}
+	return indices;
+}
+
+UInt LowRankUpdate::rank(const SparseMatrix& correction) {
+	return (UInt) touchedIndices(correction).size();
+}
+
+void LowRankUpdate::update(const SparseMatrix& correction) {
+	mIndices = touchedIndices(correction);
+	UInt k = (UInt) mIndices.size();
+
+	if (k == 0) {
+		mCorrection.resize(0, 0);
+		mBaseSolutions.resize(0, 0);
+		return;
+	}
+
+	std::vector<Int> position(correction.rows(), -1);
+	for (UInt i = 0; i < k; i++)
+		position[mIndices[i]] = i;
+
+	Matrix reduced = Matrix::Zero(k, k);
+	for (Int col = 0; col < correction.outerSize(); col++) {
+		for (SparseMatrix::InnerIterator it(correction, col); it; ++it)
+			reduced(position[it.row()], position[it.col()]) += it.value();
+	}
+
+	Matrix unitVectors = Matrix::Zero(mBase->rows(), k);
+	for (UInt i = 0; i < k; i++)
+		unitVectors(mIndices[i], i) = 1;
+	mBase->solve(unitVectors, mBaseSolutions);
+
+	Matrix capacitance = Matrix::Identity(k, k);
+	for (UInt i = 0; i < k; i++)
+		capacitance += reduced.col(i) * mBaseSolutions.row(mIndices[i]);
+	mCorrection = capacitance.lu().solve(reduced);
+
+	mTouched = Matrix::Zero(k, 1);
+	mCoefficients = Matrix::Zero(k, 1);
+}
+
+void LowRankUpdate::solve(const Matrix& rhs, Matrix& lhs) {
+	mBase->solve(rhs, lhs);
+
+	UInt k = (UInt) mIndices.size();
+	if (k == 0)
+		return;
+
+	mTouched.resize(k, lhs.cols());
+	mCoefficients.resize(k, lhs.cols());
+	for (UInt i = 0; i < k; i++)
+		mTouched.row(i) = lhs.row(mIndices[i]);
+
+	mCoefficients.noalias() = mCorrection * mTouched;
+	lhs.noalias() -= mBaseSolutions * mCoefficients;
+}
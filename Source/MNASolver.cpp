@@ -18,7 +18,17 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *********************************************************************************/
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
 #include <dpsim/MNASolver.h>
+#include <dpsim/Checkpoint.h>
+#include <dpsim/AllocationCounter.h>
+#include <dpsim/RealTime.h>
+#include <cps/Components.h>
 
 using namespace DPsim;
 using namespace CPS;
@@ -34,6 +44,7 @@ void MnaSolver<VarType>::initialize(CPS::SystemTopology system) {
 	// We need to differentiate between power and signal components and
 	// ground nodes should be ignored.
 	identifyTopologyObjects();
+	checkSparseStamps();
 
 	// These steps complete the network information.
 	createVirtualNodes();
@@ -42,32 +53,47 @@ void MnaSolver<VarType>::initialize(CPS::SystemTopology system) {
 	// For the power components the step order should not be important
 	// but signal components need to be executed following the connections.
 	sortExecutionPriority();
+	createComponentBatches();
 
 	// The system topology is prepared and we create the MNA matrices.
 	createEmptyVectors();
 	createEmptySystemMatrix();
 
+	// The workers are also used by the factorizations of a partitioned system
+	createWorkerPool();
+
 	// TODO: Move to base solver class?
 	// This intialization according to power flow information is not MNA specific.
-	mLog.info() << "Initialize power flow" << std::endl;
-	for (auto comp : mPowerComponents) {
-		auto pComp = std::dynamic_pointer_cast<PowerComponent<VarType>>(comp);
-		if (!pComp)	continue;
-		pComp->initializeFromPowerflow(mSystem.mSystemFrequency);
+	// A restored checkpoint already contains the initialized state
+	if (!mPowerFlowBuses.empty() && !mCheckpoint) {
+		mLog.info() << "Solve power flow" << std::endl;
+		solvePowerFlow();
 	}
 
+	mLog.info() << "Initialize power flow" << std::endl;
+	initializeFromPowerflow();
+
 	// Initialize signal components.
 	for (auto comp : mSignalComponents)
 		comp->initialize();
+
+	// The components derive the state of their companion models, e.g. the
+	// history sources, from the interface voltages and currents. These are
+	// restored before the components are initialized for the time step.
+	Bool restored = mCheckpoint != nullptr;
+	LUFactorization::Ptr restoredFactorization;
+	if (restored) {
+		mLog.info() << "Restore checkpoint." << std::endl;
+		restoredFactorization = restoreCheckpoint(*mCheckpoint);
+		mCheckpoint = nullptr;
+	}
+
 	// Initialize MNA specific parts of components.
-	for (auto comp : mPowerComponents)
-		comp->mnaInitialize(mSystem.mSystemOmega, mTimeStep);
-	for (auto comp : mSwitches)
-		comp->mnaInitialize(mSystem.mSystemOmega, mTimeStep);
+	mnaInitializeComponents(mTimeStep);
 
 	// This steady state initialization is MNA specific and runs a simulation
 	// before the actual simulation executed by the user.
-	if (mSteadyStateInit && mDomain == CPS::Domain::DP) {
+	if (!restored && mSteadyStateInit && mDomain == CPS::Domain::DP) {
 		mLog.info() << "Run steady-state initialization." << std::endl;
 		steadyStateInitialization();
 		mLog.info() << "Finished steady-state initialization." << std::endl;
@@ -77,32 +103,26 @@ void MnaSolver<VarType>::initialize(CPS::SystemTopology system) {
 		comp->setBehaviour(Component::Behaviour::Simulation);
 
 	// Create initial system matrix
-	for (auto comp : mPowerComponents) {
-		comp->mnaApplySystemMatrixStamp(mTmpSystemMatrix);
-		auto idObj = std::dynamic_pointer_cast<IdentifiedObject>(comp);
-		mLog.debug() << "Stamping " << idObj->type() << " " << idObj->name()
-					<< " into system matrix: \n" << mTmpSystemMatrix << std::endl;
-	}
-	for (auto comp : mSwitches) {
-		comp->mnaApplySystemMatrixStamp(mTmpSystemMatrix);
-		auto idObj = std::dynamic_pointer_cast<IdentifiedObject>(comp);
-		mLog.debug() << "Stamping " << idObj->type() << " " << idObj->name()
-			<< " into system matrix: \n" << mTmpSystemMatrix << std::endl;
-	}
-
-	// Compute LU-factorization for system matrix
-	mTmpLuFactorization = Eigen::PartialPivLU<Matrix>(mTmpSystemMatrix);
+	stampSystemMatrix(nullptr);
 
-	// Generate switching state dependent matrix
-	for (auto& sys : mSwitchedMatrices) {
-		for (auto comp : mPowerComponents)
-			comp->mnaApplySystemMatrixStamp(sys.second);
-		for (UInt i = 0; i < mSwitches.size(); i++)
-			mSwitches[i]->mnaApplySwitchSystemMatrixStamp(sys.second, sys.first[i]);
+	// Compute LU-factorization for system matrix. A restored factorization
+	// belongs to the restored switch states, which have just been stamped.
+	mTmpLuFactorization = restoredFactorization
+		? restoredFactorization
+		: factorizeSystemMatrix();
 
-		mLuFactorizations[sys.first] = Eigen::PartialPivLU<Matrix>(sys.second);
-	}
+	// System matrices of switch states are created when they are needed
+	// for the first time. The initial state is the current one.
 	updateSwitchStatus();
+	mActiveLuFactorization = mSwitches.size() > 0
+		? switchedFactorization(mCurrentSwitchStatus)
+		: mTmpLuFactorization;
+
+	if (mLowRankSwitchUpdates && mSwitches.size() > 0) {
+		createSwitchClosingStamps();
+		mBaseSwitchStatus = mCurrentSwitchStatus;
+		mLowRankUpdate = std::make_shared<LowRankUpdate>(switchedFactorization(mBaseSwitchStatus));
+	}
 
 	// Initialize source vector for debugging
 	for (auto comp : mPowerComponents) {
@@ -116,27 +136,645 @@ void MnaSolver<VarType>::initialize(CPS::SystemTopology system) {
 	for (auto comp : system.mComponents)
 		mLog.info() << "Added " << comp->type() << " '" << comp->name() << "' to simulation." << std::endl;
 
-	mLog.info() << "System matrix: \n" << mTmpSystemMatrix << std::endl;
-	mLog.info() << "LU decomposition: \n" << mTmpLuFactorization.matrixLU() << std::endl;
+	if (denseSystem())
+		mLog.info() << "System matrix: \n" << mTmpSystemMatrix << std::endl;
+	else
+		mLog.info() << "Sparse system matrix of dimension " << mSparseSystemMatrix.rows()
+			<< " with " << mSparseSystemMatrix.nonZeros() << " nonzeros" << std::endl;
+	mLog.info() << "LU decomposition: \n" << *mTmpLuFactorization << std::endl;
 	mLog.info() << "Right side vector: \n" << mRightSideVector << std::endl;
 
-	for (auto sys : mSwitchedMatrices) {
-		mLog.info() << "Switching System matrix "
-					<< sys.first << ": \n" << sys.second << std::endl;
-		mLog.info() << "LU Factorization for System Matrix "
-					<< sys.first << ": \n" << mLuFactorizations[sys.first].matrixLU() << std::endl;
+	mLog.info() << "Initial switch status: " << switchStatusString(mCurrentSwitchStatus) << std::endl;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::collectStamp(MNAInterface::Ptr comp,
+	const std::function<void(Matrix&)>& stamp, StampEntries& entries) {
+	// Complex systems store the imaginary parts after all real parts
+	const UInt parts = std::is_same<VarType, Complex>::value ? 2 : 1;
+
+	typename CPS::Node<VarType>::List nodes;
+	std::vector<UInt> simNodes;
+	auto pComp = std::dynamic_pointer_cast<PowerComponent<VarType>>(comp);
+	if (pComp) {
+		for (auto topoNode : pComp->topologicalNodes()) {
+			auto node = std::dynamic_pointer_cast<CPS::Node<VarType>>(topoNode);
+			if (node && !node->isGround() && std::find(nodes.begin(), nodes.end(), node) == nodes.end())
+				nodes.push_back(node);
+		}
+		for (UInt idx = 0; idx < pComp->virtualNodesNumber(); idx++)
+			nodes.push_back(pComp->virtualNode(idx));
+
+		for (auto node : nodes) {
+			for (auto simNode : node->simNodes())
+				simNodes.push_back(simNode);
+		}
+	}
+	else {
+		// Without known nodes the component stamps the whole system,
+		// which only happens for dense systems, see checkSparseStamps()
+		simNodes.resize(mNumSimNodes);
+		std::iota(simNodes.begin(), simNodes.end(), 0);
+	}
+
+	auto numberNodes = [&nodes, &simNodes](Bool local) {
+		UInt idx = 0;
+		for (auto node : nodes) {
+			for (UInt phase = 0; phase < node->simNodes().size(); phase++, idx++)
+				node->setSimNode(phase, local ? idx : simNodes[idx]);
+		}
+	};
+
+	UInt size = (UInt) simNodes.size();
+	mStampMatrix.setZero(parts * size, parts * size);
+
+	numberNodes(true);
+	try {
+		stamp(mStampMatrix);
+	}
+	catch (...) {
+		numberNodes(false);
+		throw;
+	}
+	numberNodes(false);
+
+	auto index = [this, &simNodes, size](Int idx) {
+		return idx < (Int) size ? simNodes[idx] : simNodes[idx - size] + mNumSimNodes;
+	};
+	for (Int col = 0; col < mStampMatrix.cols(); col++) {
+		for (Int row = 0; row < mStampMatrix.rows(); row++) {
+			if (mStampMatrix(row, col) != 0)
+				entries.emplace_back(index(row), index(col), mStampMatrix(row, col));
+		}
+	}
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::checkSparseStamps() {
+	if (denseSystem())
+		return;
+
+	std::vector<MNAInterface::Ptr> objects(mPowerComponents.begin(), mPowerComponents.end());
+	objects.insert(objects.end(), mSwitches.begin(), mSwitches.end());
+
+	for (auto obj : objects) {
+		if (std::dynamic_pointer_cast<PowerComponent<VarType>>(obj))
+			continue;
+
+		auto idObj = std::dynamic_pointer_cast<IdentifiedObject>(obj);
+		std::cerr << Logger::prefix() << "WARNING: The nodes of " << (idObj ? idObj->name() : "an MNA object")
+			<< " are unknown, the system matrix is stamped dense and not partitioned" << std::endl;
+
+		mMatrixType = Solver::MatrixType::Dense;
+		mPartitioned = false;
+		return;
+	}
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::checkStepSystemMatrix() const {
+	if (denseSystem() || mTmpSystemMatrix.size() == 0)
+		return;
+
+	std::cerr << Logger::prefix() << "ERROR: A component changed the system matrix in its step, "
+		<< "which is only supported by dense system matrices" << std::endl;
+	throw SolverException();
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::stampSystemMatrix(const SwitchStatus* status) {
+	if (denseSystem()) {
+		mTmpSystemMatrix.setZero();
+		for (auto comp : mPowerComponents)
+			comp->mnaApplySystemMatrixStamp(mTmpSystemMatrix);
+		for (UInt i = 0; i < mSwitches.size(); i++) {
+			if (status)
+				mSwitches[i]->mnaApplySwitchSystemMatrixStamp(mTmpSystemMatrix, (*status)[i]);
+			else
+				mSwitches[i]->mnaApplySystemMatrixStamp(mTmpSystemMatrix);
+		}
+		return;
+	}
+
+	// Components can only stamp into dense matrices. Each one stamps a matrix
+	// of its own nodes, which is added to the sparse system matrix.
+	StampEntries entries;
+	for (auto comp : mPowerComponents)
+		collectStamp(comp, [&comp](Matrix& mat) { comp->mnaApplySystemMatrixStamp(mat); }, entries);
+	for (UInt i = 0; i < mSwitches.size(); i++) {
+		auto sw = mSwitches[i];
+		if (status) {
+			Bool closed = (*status)[i];
+			collectStamp(sw, [&sw, closed](Matrix& mat) { sw->mnaApplySwitchSystemMatrixStamp(mat, closed); }, entries);
+		}
+		else
+			collectStamp(sw, [&sw](Matrix& mat) { sw->mnaApplySystemMatrixStamp(mat); }, entries);
+	}
+
+	Int dim = mLeftSideVector.rows();
+	mSparseSystemMatrix.resize(dim, dim);
+	mSparseSystemMatrix.setFromTriplets(entries.begin(), entries.end());
+}
+
+template <typename VarType>
+LUFactorization::Ptr MnaSolver<VarType>::factorizeSystemMatrix() {
+	return denseSystem()
+		? factorize(mTmpSystemMatrix)
+		: factorize(mSparseSystemMatrix);
+}
+
+template <typename VarType>
+LUFactorization::Ptr MnaSolver<VarType>::factorize(const Matrix& mat) {
+	if (mSharedFactorizations) {
+		return mSharedFactorizations->get(mat.sparseView(), mMatrixType, [&mat]() {
+			return std::make_shared<LUFactorization>(mat);
+		});
+	}
+
+	return std::make_shared<LUFactorization>(mat);
+}
+
+template <typename VarType>
+LUFactorization::Ptr MnaSolver<VarType>::factorize(const SparseMatrix& mat) {
+	if (mPartitioned) {
+		if (mPartition.empty()) {
+			PartitionedFactorization::computePartition(mat, tornUnknowns(), mPartitions, mPartition);
+			mLog.info() << "Partitioned system into "
+				<< *std::max_element(mPartition.begin(), mPartition.end()) + 1 << " blocks with "
+				<< std::count(mPartition.begin(), mPartition.end(), -1) << " interface unknowns" << std::endl;
+		}
+
+		// Partitioned factorizations use buffers in their solves and cannot be shared
+		return std::make_shared<PartitionedFactorization>(mat, mPartition, mWorkerPool);
+	}
+
+	// The ordering only depends on the nonzero pattern which is (almost) the
+	// same for all switch states. It only affects the fill-in, not the result.
+	if (mSparseOrdering.size() == 0) {
+		LUFactorization::computeOrdering(mat, mSparseOrdering);
+		mLog.info() << "Computed sparse column ordering for " << mat.nonZeros()
+			<< " nonzeros" << std::endl;
+	}
+
+	if (mSharedFactorizations) {
+		return mSharedFactorizations->get(mat, mMatrixType, [this, &mat]() {
+			return std::make_shared<LUFactorization>(mat, mSparseOrdering);
+		});
+	}
+
+	return std::make_shared<LUFactorization>(mat, mSparseOrdering);
+}
+
+template <typename VarType>
+LUFactorization::Ptr MnaSolver<VarType>::createSwitchedFactorization(const SwitchStatus& status) {
+	stampSystemMatrix(&status);
+
+	auto lu = factorizeSystemMatrix();
+	mLuFactorizations.put({ mTimeStep, status }, lu, lu->memorySize());
+
+	mLog.info() << "Factorized system matrix for time step " << mTimeStep << " and switch status "
+		<< switchStatusString(status) << " (" << mLuFactorizations.entries()
+		<< " cached factorizations using " << mLuFactorizations.size()
+		<< " bytes, " << mLuFactorizations.evictions() << " evicted)" << std::endl;
+	if (denseSystem())
+		mLog.debug() << "Switching system matrix " << switchStatusString(status)
+			<< ": \n" << mTmpSystemMatrix << std::endl;
+
+	return lu;
+}
+
+template <typename VarType>
+LUFactorization::Ptr MnaSolver<VarType>::switchedFactorization(const SwitchStatus& status) {
+	auto cached = mLuFactorizations.get({ mTimeStep, status });
+	return cached ? *cached : createSwitchedFactorization(status);
+}
+
+template <typename VarType>
+Bool MnaSolver<VarType>::setTimeStep(Real timeStep) {
+	if (!(timeStep > 0) || std::isinf(timeStep))
+		return false;
+	if (timeStep == mTimeStep)
+		return true;
+
+	Real prevTimeStep = mTimeStep;
+	mTimeStep = timeStep;
+	try {
+		mnaInitializeComponents(mTimeStep);
+
+		if (mLowRankUpdate) {
+			mBaseSwitchStatus = mCurrentSwitchStatus;
+			mLowRankUpdate = std::make_shared<LowRankUpdate>(switchedFactorization(mBaseSwitchStatus));
+		}
+		else
+			mActiveLuFactorization = switchedFactorization(mCurrentSwitchStatus);
+	}
+	catch (...) {
+		// Keep the solver consistent with the previous time step
+		mLog.info() << "Failed to change time step to " << timeStep << std::endl;
+		mTimeStep = prevTimeStep;
+		mnaInitializeComponents(mTimeStep);
+		return false;
+	}
+
+	mLog.debug() << "Changed time step to " << mTimeStep << std::endl;
+
+	return true;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::setTrackSolutionChange(Bool track) {
+	mTrackSolutionChange = track;
+	mPreviousLeftSideVector = mLeftSideVector;
+	mSolutionChange = 0;
+}
+
+template <typename VarType>
+std::vector<Int> MnaSolver<VarType>::tornUnknowns() {
+	std::unordered_set<String> names(mTearingObjects.begin(), mTearingObjects.end());
+	std::vector<TopologicalNode::Ptr> nodes;
+
+	for (auto node : mNodes) {
+		if (names.erase(node->name()))
+			nodes.push_back(node);
+	}
+	for (auto comp : mSystem.mComponents) {
+		auto topoComp = std::dynamic_pointer_cast<TopologicalComponent>(comp);
+		if (!topoComp || !names.erase(comp->name()))
+			continue;
+
+		for (auto node : topoComp->topologicalNodes()) {
+			if (!node->isGround())
+				nodes.push_back(node);
+		}
+	}
+
+	for (auto& name : names)
+		std::cerr << Logger::prefix() << "WARNING: Tearing object " << name
+			<< " is not part of the system" << std::endl;
+
+	// Complex systems store the imaginary parts after all real parts
+	std::vector<Int> torn;
+	for (auto node : nodes) {
+		for (auto simNode : node->simNodes()) {
+			torn.push_back(simNode);
+			if (std::is_same<VarType, Complex>::value)
+				torn.push_back(simNode + mNumSimNodes);
+		}
+	}
+
+	return torn;
+}
+
+/// Type tags of the attributes stored in a checkpoint
+enum class CheckpointAttribute : UInt { Real, Complex, Int, UInt, Bool, Matrix, MatrixComp, Unsupported };
+
+static CheckpointAttribute checkpointAttributeType(AttributeBase::Ptr attr) {
+	if (std::dynamic_pointer_cast<Attribute<Real>>(attr))
+		return CheckpointAttribute::Real;
+	if (std::dynamic_pointer_cast<Attribute<Complex>>(attr))
+		return CheckpointAttribute::Complex;
+	if (std::dynamic_pointer_cast<Attribute<Int>>(attr))
+		return CheckpointAttribute::Int;
+	if (std::dynamic_pointer_cast<Attribute<UInt>>(attr))
+		return CheckpointAttribute::UInt;
+	if (std::dynamic_pointer_cast<Attribute<Bool>>(attr))
+		return CheckpointAttribute::Bool;
+	if (std::dynamic_pointer_cast<Attribute<Matrix>>(attr))
+		return CheckpointAttribute::Matrix;
+	if (std::dynamic_pointer_cast<Attribute<MatrixComp>>(attr))
+		return CheckpointAttribute::MatrixComp;
+	return CheckpointAttribute::Unsupported;
+}
+
+template <typename T>
+static void writeAttribute(std::ostream& os, AttributeBase::Ptr attr) {
+	Checkpoint::write(os, std::static_pointer_cast<Attribute<T>>(attr)->get());
+}
+
+/// Read a value and assign it to the attribute if it has the same type
+template <typename T>
+static Bool readAttribute(std::istream& is, AttributeBase::Ptr attr) {
+	T value;
+	Checkpoint::read(is, value);
+
+	auto typedAttr = std::dynamic_pointer_cast<Attribute<T>>(attr);
+	if (typedAttr)
+		typedAttr->set(value);
+
+	return typedAttr != nullptr;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::saveCheckpoint(std::ostream& os, Bool factorizations) const {
+	Checkpoint::write<UInt>(os, mNumSimNodes);
+	Checkpoint::write(os, mTimeStep);
+	Checkpoint::write(os, mLeftSideVector);
+
+	// Components keep their parameters and states in attributes. The states
+	// of the companion models are derived from the interface voltages and
+	// currents, which are read-only, so all attributes are stored.
+	Checkpoint::write<UInt>(os, (UInt) mSystem.mComponents.size());
+	for (auto comp : mSystem.mComponents) {
+		std::vector<std::pair<String, AttributeBase::Ptr>> attrs;
+		for (auto& it : comp->attributes()) {
+			if (checkpointAttributeType(it.second) != CheckpointAttribute::Unsupported)
+				attrs.push_back(it);
+		}
+
+		Checkpoint::write(os, comp->name());
+		Checkpoint::write<UInt>(os, (UInt) attrs.size());
+		for (auto& it : attrs) {
+			auto type = checkpointAttributeType(it.second);
+			Checkpoint::write(os, it.first);
+			Checkpoint::write(os, type);
+
+			switch (type) {
+			case CheckpointAttribute::Real: writeAttribute<Real>(os, it.second); break;
+			case CheckpointAttribute::Complex: writeAttribute<Complex>(os, it.second); break;
+			case CheckpointAttribute::Int: writeAttribute<Int>(os, it.second); break;
+			case CheckpointAttribute::UInt: writeAttribute<UInt>(os, it.second); break;
+			case CheckpointAttribute::Bool: writeAttribute<Bool>(os, it.second); break;
+			case CheckpointAttribute::Matrix: writeAttribute<Matrix>(os, it.second); break;
+			case CheckpointAttribute::MatrixComp: writeAttribute<MatrixComp>(os, it.second); break;
+			default: break;
+			}
+		}
 	}
 
-	mLog.info() << "Initial switch status: " << mCurrentSwitchStatus << std::endl;
+	// Only plain sparse factorizations can be stored, the others are recomputed
+	auto lu = mLowRankUpdate ? mLowRankUpdate->base() : mActiveLuFactorization;
+	Bool storeFactorization = factorizations && lu->type() == Solver::MatrixType::Sparse
+		&& !std::dynamic_pointer_cast<PartitionedFactorization>(lu);
+
+	Checkpoint::write(os, storeFactorization);
+	if (storeFactorization) {
+		std::vector<int> ordering(mSparseOrdering.indices().data(),
+			mSparseOrdering.indices().data() + mSparseOrdering.size());
+
+		Checkpoint::write(os, ordering);
+		Checkpoint::write(os, mLowRankUpdate ? mBaseSwitchStatus : mCurrentSwitchStatus);
+		lu->write(os);
+	}
+
+	if (!os)
+		throw SystemError("Failed to write checkpoint");
 }
 
 template <typename VarType>
-void MnaSolver<VarType>::updateSwitchStatus() {
+LUFactorization::Ptr MnaSolver<VarType>::restoreCheckpoint(std::istream& is) {
+	UInt numSimNodes = Checkpoint::read<UInt>(is);
+	Real timeStep = Checkpoint::read<Real>(is);
+	if (numSimNodes != mNumSimNodes || !(timeStep > 0))
+		throw std::invalid_argument("Checkpoint does not match the system");
+
+	// The components are initialized for the restored time step by
+	// initialize(), so nothing is factorized for the current one
+	if (timeStep != mTimeStep) {
+		mLog.info() << "Restore time step " << timeStep << std::endl;
+		mTimeStep = timeStep;
+	}
+
+	Checkpoint::read(is, mLeftSideVector);
+	if (mLeftSideVector.rows() != mRightSideVector.rows())
+		throw std::invalid_argument("Checkpoint does not match the system");
+
+	for (UInt nodeIdx = 0; nodeIdx < mNumNetNodes; nodeIdx++)
+		mNodes[nodeIdx]->mnaUpdateVoltage(mLeftSideVector);
+
+	std::map<String, Component::Ptr> components;
+	for (auto comp : mSystem.mComponents)
+		components[comp->name()] = comp;
+
+	UInt restored = 0, skipped = 0;
+	UInt numComponents = Checkpoint::read<UInt>(is);
+	for (UInt i = 0; i < numComponents; i++) {
+		String compName;
+		Checkpoint::read(is, compName);
+		auto comp = components.find(compName);
+
+		UInt numAttributes = Checkpoint::read<UInt>(is);
+		for (UInt j = 0; j < numAttributes; j++) {
+			String name;
+			Checkpoint::read(is, name);
+			auto type = Checkpoint::read<CheckpointAttribute>(is);
+
+			AttributeBase::Ptr attr;
+			if (comp != components.end()) {
+				const auto& attrs = comp->second->attributes();
+				auto it = attrs.find(name);
+				if (it != attrs.end())
+					attr = it->second;
+			}
+
+			Bool ok;
+			switch (type) {
+			case CheckpointAttribute::Real: ok = readAttribute<Real>(is, attr); break;
+			case CheckpointAttribute::Complex: ok = readAttribute<Complex>(is, attr); break;
+			case CheckpointAttribute::Int: ok = readAttribute<Int>(is, attr); break;
+			case CheckpointAttribute::UInt: ok = readAttribute<UInt>(is, attr); break;
+			case CheckpointAttribute::Bool: ok = readAttribute<Bool>(is, attr); break;
+			case CheckpointAttribute::Matrix: ok = readAttribute<Matrix>(is, attr); break;
+			case CheckpointAttribute::MatrixComp: ok = readAttribute<MatrixComp>(is, attr); break;
+			default: throw std::invalid_argument("Invalid attribute in checkpoint");
+			}
+
+			if (ok)
+				restored++;
+			else
+				skipped++;
+		}
+	}
+
+	mLog.info() << "Restored " << restored << " attributes, " << skipped
+		<< " attributes are not part of the system" << std::endl;
+
+	if (!Checkpoint::read<Bool>(is))
+		return nullptr;
+
+	std::vector<int> ordering;
+	SwitchStatus status;
+	Checkpoint::read(is, ordering);
+	Checkpoint::read(is, status);
+	auto lu = LUFactorization::read(is);
+	if (status.size() != mSwitches.size() || lu->rows() != mLeftSideVector.rows())
+		throw std::invalid_argument("Checkpoint does not match the system");
+
+	// Sparse factorizations are only used with sparse system matrices
+	if (mMatrixType != Solver::MatrixType::Sparse || mPartitioned)
+		return nullptr;
+
+	mSparseOrdering.indices() = Eigen::Map<Eigen::VectorXi>(ordering.data(), ordering.size());
+	mLuFactorizations.put({ mTimeStep, status }, lu, lu->memorySize());
+	mLog.info() << "Restored factorization for switch status " << switchStatusString(status) << std::endl;
+
+	// The factorization may belong to the base status of low-rank updates
 	for (UInt i = 0; i < mSwitches.size(); i++) {
-		mCurrentSwitchStatus.set(i, mSwitches[i]->mnaIsClosed());
+		if (status[i] != mSwitches[i]->mnaIsClosed())
+			return nullptr;
+	}
+
+	return lu;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::createSwitchClosingStamps() {
+	mSwitchClosingStamps.clear();
+
+	Int dim = mLeftSideVector.rows();
+	for (auto sw : mSwitches) {
+		StampEntries entries;
+		collectStamp(sw, [&sw](Matrix& mat) { sw->mnaApplySwitchSystemMatrixStamp(mat, true); }, entries);
+		std::size_t closed = entries.size();
+		collectStamp(sw, [&sw](Matrix& mat) { sw->mnaApplySwitchSystemMatrixStamp(mat, false); }, entries);
+
+		for (std::size_t i = closed; i < entries.size(); i++)
+			entries[i] = Eigen::Triplet<Real>(entries[i].row(), entries[i].col(), -entries[i].value());
+
+		SparseMatrix stamp(dim, dim);
+		stamp.setFromTriplets(entries.begin(), entries.end());
+		mSwitchClosingStamps.push_back(stamp.pruned());
+	}
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::updateLowRankCorrection() {
+	Int dim = mLeftSideVector.rows();
+	SparseMatrix correction(dim, dim);
+
+	for (UInt i = 0; i < mSwitches.size(); i++) {
+		if (mCurrentSwitchStatus[i] == mBaseSwitchStatus[i])
+			continue;
+		if (mCurrentSwitchStatus[i])
+			correction += mSwitchClosingStamps[i];
+		else
+			correction -= mSwitchClosingStamps[i];
+	}
+
+	if (LowRankUpdate::rank(correction) > mMaxUpdateRank) {
+		mLog.info() << "Rank of switch correction exceeds " << mMaxUpdateRank
+			<< ", refactorizing for switch status "
+			<< switchStatusString(mCurrentSwitchStatus) << std::endl;
+
+		mBaseSwitchStatus = mCurrentSwitchStatus;
+		mLowRankUpdate = std::make_shared<LowRankUpdate>(switchedFactorization(mBaseSwitchStatus));
+		return;
+	}
+
+	mLowRankUpdate->update(correction);
+	mLog.debug() << "Updated switch correction to rank " << mLowRankUpdate->rank() << std::endl;
+}
+
+template <typename VarType>
+Bool MnaSolver<VarType>::updateSwitchStatus() {
+	Bool changed = false;
+
+	for (UInt i = 0; i < mSwitches.size(); i++) {
+		Bool closed = mSwitches[i]->mnaIsClosed();
+		if (closed != mCurrentSwitchStatus[i]) {
+			mCurrentSwitchStatus[i] = closed;
+			changed = true;
+		}
+	}
+
+	if (!changed)
+		return false;
+
+	mLog.debug() << "Switch status changed to " << switchStatusString(mCurrentSwitchStatus) << std::endl;
+
+	if (mLowRankUpdate)
+		updateLowRankCorrection();
+	else if (mActiveLuFactorization)
+		mActiveLuFactorization = switchedFactorization(mCurrentSwitchStatus);
+
+	return true;
+}
+
+template <typename VarType>
+String MnaSolver<VarType>::switchStatusString(const SwitchStatus& status) {
+	// Printed with the first switch as the least significant digit like a bitset
+	String str(status.size(), '0');
+	for (UInt i = 0; i < status.size(); i++) {
+		if (status[i])
+			str[status.size() - 1 - i] = '1';
+	}
+	return str;
+}
+
+template <typename VarType>
+std::unordered_set<std::type_index>& MnaSolver<VarType>::typesWithoutStep() {
+	// Resistors only stamp the system matrix and update their
+	// interface values in mnaPostStep
+	static std::unordered_set<std::type_index> types = {
+		typeid(CPS::DP::Ph1::Resistor),
+		typeid(CPS::EMT::Ph1::Resistor)
+	};
+	return types;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::createComponentBatches() {
+	std::unordered_map<std::type_index, UInt> batchIndex;
+
+	for (auto comp : mPowerComponents) {
+		std::type_index type = typeid(*comp);
+
+		auto it = batchIndex.find(type);
+		if (it == batchIndex.end()) {
+			auto idObj = std::dynamic_pointer_cast<IdentifiedObject>(comp);
+			String name = idObj ? idObj->type() : type.name();
+
+			it = batchIndex.emplace(type, (UInt) mComponentBatches.size()).first;
+			mComponentBatches.push_back({ type, name, {}, typesWithoutStep().count(type) == 0 });
+		}
+
+		mComponentBatches[it->second].components.push_back(comp.get());
+	}
+
+	for (auto& batch : mComponentBatches) {
+		mLog.info() << "Batch of " << batch.components.size() << " " << batch.name
+			<< (batch.step ? "" : " (not stepped)") << std::endl;
 	}
 }
 
+template <typename VarType>
+void MnaSolver<VarType>::createWorkerPool() {
+	if (mThreads <= 1)
+		return;
+
+	for (auto& batch : mComponentBatches) {
+		if (batch.step)
+			mSteppedComponents.insert(mSteppedComponents.end(), batch.components.begin(), batch.components.end());
+		mPostSteppedComponents.insert(mPostSteppedComponents.end(), batch.components.begin(), batch.components.end());
+	}
+
+	mWorkerPool = std::make_unique<WorkerPool>(mThreads, mThreadCpus);
+	mWorkerRightSideVectors.assign(mThreads - 1,
+		Matrix::Zero(mRightSideVector.rows(), mRightSideVector.cols()));
+
+	// The components only add to the right side vector, so each worker
+	// stamps into its own vector and the vectors are summed in a fixed order.
+	mStepTask = [this](UInt worker) {
+		Matrix& rightSideVector = worker == 0
+			? mRightSideVector
+			: mWorkerRightSideVectors[worker - 1];
+		if (worker > 0)
+			rightSideVector.setZero();
+
+		auto range = mWorkerPool->range(worker, (UInt) mSteppedComponents.size());
+		for (UInt i = range.first; i < range.second; i++)
+			mSteppedComponents[i]->mnaStep(mTmpSystemMatrix, rightSideVector, mLeftSideVector, mStepTime);
+	};
+
+	mPostStepTask = [this](UInt worker) {
+		auto range = mWorkerPool->range(worker, (UInt) mPostSteppedComponents.size());
+		for (UInt i = range.first; i < range.second; i++)
+			mPostSteppedComponents[i]->mnaPostStep(mRightSideVector, mLeftSideVector, mStepTime);
+	};
+
+	mLog.info() << "Stepping " << mSteppedComponents.size() << " components on "
+		<< mWorkerPool->size() << " threads" << std::endl;
+}
+
 template <typename VarType>
 void MnaSolver<VarType>::identifyTopologyObjects() {
 	for (auto baseNode : mSystem.mNodes) {
@@ -160,6 +798,8 @@ void MnaSolver<VarType>::identifyTopologyObjects() {
 		auto sigComp = std::dynamic_pointer_cast<CPS::SignalComponent>(comp);
 		if (sigComp) mSignalComponents.push_back(sigComp);
 	}
+
+	mCurrentSwitchStatus.resize(mSwitches.size());
 }
 
 template <typename VarType>
@@ -195,10 +835,10 @@ void MnaSolver<VarType>::assignSimNodes() {
 
 template <typename VarType>
 void MnaSolver<VarType>::solve()  {
-	if (mSwitchedMatrices.size() > 0)
-		mLeftSideVector = mLuFactorizations[mCurrentSwitchStatus].solve(mRightSideVector);
+	if (mLowRankUpdate)
+		mLowRankUpdate->solve(mRightSideVector, mLeftSideVector);
 	else
-		mLeftSideVector = mTmpLuFactorization.solve(mRightSideVector);
+		mActiveLuFactorization->solve(mRightSideVector, mLeftSideVector);
 }
 
 template<>
@@ -215,24 +855,20 @@ void MnaSolver<Complex>::createEmptyVectors() {
 
 template<>
 void MnaSolver<Real>::createEmptySystemMatrix() {
-	mTmpSystemMatrix = Matrix::Zero(mNumSimNodes, mNumSimNodes);
-
-	if (mSwitches.size() > SWITCH_NUM)
-		throw SystemError("Too many Switches.");
-
-	for (UInt i = 0; i < mSwitches.size() * 2; i++)
-		mSwitchedMatrices[std::bitset<SWITCH_NUM>(i)] = Matrix::Zero(mNumSimNodes, mNumSimNodes);
+	// Sparse systems pass an empty matrix to the steps of the components
+	if (denseSystem())
+		mTmpSystemMatrix = Matrix::Zero(mNumSimNodes, mNumSimNodes);
+	else
+		mTmpSystemMatrix.resize(0, 0);
 }
 
 template<>
 void MnaSolver<Complex>::createEmptySystemMatrix() {
-	mTmpSystemMatrix = Matrix::Zero(2 * mNumSimNodes, 2 * mNumSimNodes);
-
-	if (mSwitches.size() > SWITCH_NUM)
-		throw SystemError("Too many Switches.");
-
-	for (UInt i = 0; i < mSwitches.size() * 2; i++)
-		mSwitchedMatrices[std::bitset<SWITCH_NUM>(i)] = Matrix::Zero(2 * mNumSimNodes, 2 * mNumSimNodes);
+	// Sparse systems pass an empty matrix to the steps of the components
+	if (denseSystem())
+		mTmpSystemMatrix = Matrix::Zero(2 * mNumSimNodes, 2 * mNumSimNodes);
+	else
+		mTmpSystemMatrix.resize(0, 0);
 }
 
 template <typename VarType>
@@ -266,54 +902,240 @@ void MnaSolver<VarType>::createVirtualNodes() {
 }
 
 template <typename VarType>
-void MnaSolver<VarType>::steadyStateInitialization() {
-	Real time = 0;
-	Real eps = 0.0001;
-	Real maxDiff, max;
-	Matrix diff;
-	Matrix prevLeftSideVector = Matrix::Zero(2 * mNumNodes, 1);
+void MnaSolver<VarType>::initializeFromPowerflow() {
+	for (auto comp : mPowerComponents) {
+		auto pComp = std::dynamic_pointer_cast<PowerComponent<VarType>>(comp);
+		if (!pComp)	continue;
+		pComp->initializeFromPowerflow(mSystem.mSystemFrequency);
+	}
+}
 
-	for (auto comp : mSystem.mComponents)
-		comp->setBehaviour(Component::Behaviour::Initialization);
+template<>
+void MnaSolver<Real>::setInitialNodeVoltages(const Matrix& leftSideVector) {
+	// The steady-state initialization is only run in the DP domain
+}
 
-	// Create system matrix
+template<>
+void MnaSolver<Complex>::setInitialNodeVoltages(const Matrix& leftSideVector) {
+	for (UInt idx = 0; idx < mNumNetNodes; idx++) {
+		auto simNodes = mNodes[idx]->simNodes();
+		MatrixComp voltage(simNodes.size(), 1);
+
+		for (UInt phase = 0; phase < simNodes.size(); phase++)
+			voltage(phase, 0) = Complex(leftSideVector(simNodes[phase], 0),
+				leftSideVector(simNodes[phase] + mNumSimNodes, 0));
+
+		mNodes[idx]->setInitialVoltage(voltage);
+	}
+}
+
+template<>
+void MnaSolver<Real>::solvePowerFlow() {
+	std::cerr << Logger::prefix() << "WARNING: The power flow is only supported in the DP domain, "
+		<< "the components are initialized without it" << std::endl;
+}
+
+template<>
+void MnaSolver<Complex>::solvePowerFlow() {
+	if (mNumSimNodes != mNumNodes) {
+		std::cerr << Logger::prefix() << "WARNING: The power flow is only supported for single-phase nodes, "
+			<< "the components are initialized without it" << std::endl;
+		return;
+	}
+
+	// Stamp the phasor admittances of the network components. As for the direct
+	// steady-state initialization, a long time step turns the companion models
+	// of inductors and capacitors into admittances. The components are
+	// initialized for the simulation time step again afterwards.
+	Real timeStep = 1e8 / mSystem.mSystemOmega;
+
+	std::vector<MNAInterface::Ptr> branches;
+	for (auto comp : mPowerComponents) {
+		auto idObj = std::dynamic_pointer_cast<IdentifiedObject>(comp);
+		if (!mPowerFlowInjections.count(idObj->name()))
+			branches.push_back(comp);
+	}
+	branches.insert(branches.end(), mSwitches.begin(), mSwitches.end());
+
+	// Only branch admittances between network nodes are part of the admittance
+	// matrix. Virtual nodes hold constraints such as the currents of voltage
+	// sources, which have to be represented by power flow buses instead.
+	StampEntries stamps;
+	String constrained;
+	for (auto comp : branches) {
+		auto pComp = std::dynamic_pointer_cast<PowerComponent<Complex>>(comp);
+		if (pComp)
+			pComp->initializeFromPowerflow(mSystem.mSystemFrequency);
+		comp->mnaInitialize(mSystem.mSystemOmega, timeStep);
+
+		StampEntries compStamps;
+		collectStamp(comp, [&comp](Matrix& mat) { comp->mnaApplySystemMatrixStamp(mat); }, compStamps);
+		for (auto& stamp : compStamps) {
+			if ((UInt) stamp.row() % mNumSimNodes >= mNumNetSimNodes
+				|| (UInt) stamp.col() % mNumSimNodes >= mNumNetSimNodes) {
+				auto idObj = std::dynamic_pointer_cast<IdentifiedObject>(comp);
+				constrained = idObj ? idObj->name() : "an MNA object";
+				break;
+			}
+		}
+		if (!constrained.empty())
+			break;
+		stamps.insert(stamps.end(), compStamps.begin(), compStamps.end());
+	}
+
+	for (auto comp : branches)
+		comp->mnaInitialize(mSystem.mSystemOmega, mTimeStep);
+
+	if (!constrained.empty()) {
+		std::cerr << Logger::prefix() << "WARNING: The power flow requires " << constrained
+			<< " to be a power flow injection as it stamps virtual nodes, "
+			<< "the components are initialized without it" << std::endl;
+		return;
+	}
+
+	// The upper left block of the DP system matrix holds the real parts
+	// of the admittances and the lower left block the imaginary parts
+	std::vector<Eigen::Triplet<Complex>> entries;
+	for (auto& stamp : stamps) {
+		if ((UInt) stamp.col() >= mNumSimNodes)
+			continue;
+		if ((UInt) stamp.row() < mNumSimNodes)
+			entries.emplace_back(stamp.row(), stamp.col(), Complex(stamp.value(), 0));
+		else
+			entries.emplace_back(stamp.row() - mNumSimNodes, stamp.col(), Complex(0, stamp.value()));
+	}
+	SparseMatrixComp admittance(mNumNetSimNodes, mNumNetSimNodes);
+	admittance.setFromTriplets(entries.begin(), entries.end());
+
+	std::vector<PowerFlowSolver::Bus> buses(mNumNetSimNodes);
+	UInt specified = 0;
+	for (UInt idx = 0; idx < mNumNetNodes; idx++) {
+		auto it = mPowerFlowBuses.find(mNodes[idx]->name());
+		if (it == mPowerFlowBuses.end())
+			continue;
+
+		buses[mNodes[idx]->simNode()] = it->second;
+		specified++;
+	}
+	if (specified < mPowerFlowBuses.size())
+		std::cerr << Logger::prefix() << "WARNING: " << mPowerFlowBuses.size() - specified
+			<< " power flow buses do not match a network node" << std::endl;
+
+	PowerFlowSolver powerFlow(admittance, buses);
+	if (powerFlow.solve(mPowerFlowTolerance, mPowerFlowMaxIterations))
+		mLog.info() << "Power flow converged after " << powerFlow.iterations() << " iterations" << std::endl;
+	else
+		std::cerr << Logger::prefix() << "WARNING: Power flow did not converge, relative mismatch "
+			<< powerFlow.mismatch() << " after " << powerFlow.iterations() << " iterations" << std::endl;
+
+	Matrix leftSideVector = Matrix::Zero(2 * mNumSimNodes, 1);
+	for (UInt node = 0; node < mNumNetSimNodes; node++) {
+		leftSideVector(node, 0) = powerFlow.voltages()(node, 0).real();
+		leftSideVector(node + mNumSimNodes, 0) = powerFlow.voltages()(node, 0).imag();
+	}
+	setInitialNodeVoltages(leftSideVector);
+
+	for (UInt idx = 0; idx < mNumNetNodes; idx++)
+		mLog.debug() << "Power flow voltage of " << mNodes[idx]->name() << ": "
+			<< powerFlow.voltages()(mNodes[idx]->simNode(), 0) << std::endl;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::mnaInitializeComponents(Real timeStep) {
 	for (auto comp : mPowerComponents)
-		comp->mnaApplySystemMatrixStamp(mTmpSystemMatrix);
+		comp->mnaInitialize(mSystem.mSystemOmega, timeStep);
 	for (auto comp : mSwitches)
-		comp->mnaApplySystemMatrixStamp(mTmpSystemMatrix);
+		comp->mnaInitialize(mSystem.mSystemOmega, timeStep);
+}
 
-	// Compute LU-factorization for system matrix
-	mTmpLuFactorization = Eigen::PartialPivLU<Matrix>(mTmpSystemMatrix);
+template <typename VarType>
+void MnaSolver<VarType>::createInitSystemMatrix() {
+	stampSystemMatrix(nullptr);
+	mTmpLuFactorization = factorizeSystemMatrix();
+}
 
-	while (time < 10) {
-		// Reset source vector
-		mRightSideVector.setZero();
+template <typename VarType>
+void MnaSolver<VarType>::initStep(Real time, Real logTime) {
+	// Reset source vector
+	mRightSideVector.setZero();
 
-		// First, step signal components and then power components
-		for (auto comp : mSignalComponents)
-			comp->step(time);
-		for (auto comp : mPowerComponents)
-			comp->mnaStep(mTmpSystemMatrix, mRightSideVector, mLeftSideVector, time);
+	// First, step signal components and then power components
+	for (auto comp : mSignalComponents)
+		comp->step(time);
+	for (auto comp : mPowerComponents)
+		comp->mnaStep(mTmpSystemMatrix, mRightSideVector, mLeftSideVector, time);
+	checkStepSystemMatrix();
 
-		// Solve MNA system
-		mLeftSideVector = mTmpLuFactorization.solve(mRightSideVector);
+	// Solve MNA system
+	mTmpLuFactorization->solve(mRightSideVector, mLeftSideVector);
 
-		// Some components need to update internal states
-		for (auto comp : mPowerComponents)
-			comp->mnaPostStep(mRightSideVector, mLeftSideVector, time);
+	// Some components need to update internal states
+	for (auto comp : mPowerComponents)
+		comp->mnaPostStep(mRightSideVector, mLeftSideVector, time);
 
-		// TODO Try to avoid this step.
-		for (UInt nodeIdx = 0; nodeIdx < mNumNetNodes; nodeIdx++)
-			mNodes[nodeIdx]->mnaUpdateVoltage(mLeftSideVector);
+	// TODO Try to avoid this step.
+	for (UInt nodeIdx = 0; nodeIdx < mNumNetNodes; nodeIdx++)
+		mNodes[nodeIdx]->mnaUpdateVoltage(mLeftSideVector);
 
-		if (mDomain == CPS::Domain::EMT) {
-			mInitLeftVectorLog.logEMTNodeValues(time, leftSideVector());
-			mInitRightVectorLog.logEMTNodeValues(time, rightSideVector());
-		}
-		else {
-			mInitLeftVectorLog.logPhasorNodeValues(time, leftSideVector());
-			mInitRightVectorLog.logPhasorNodeValues(time, rightSideVector());
-		}
+	if (!mInitLeftVectorLog)
+		return;
+
+	if (mDomain == CPS::Domain::EMT) {
+		mInitLeftVectorLog->logEMTNodeValues(logTime, leftSideVector());
+		mInitRightVectorLog->logEMTNodeValues(logTime, rightSideVector());
+	}
+	else {
+		mInitLeftVectorLog->logPhasorNodeValues(logTime, leftSideVector());
+		mInitRightVectorLog->logPhasorNodeValues(logTime, rightSideVector());
+	}
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::steadyStateInitialization() {
+	for (auto comp : mSystem.mComponents)
+		comp->setBehaviour(Component::Behaviour::Initialization);
+
+	if (mSteadyStateLogging) {
+		mInitLeftVectorLog = std::make_shared<DataLogger>(mName + "_InitLeftVector");
+		mInitRightVectorLog = std::make_shared<DataLogger>(mName + "_InitRightVector");
+	}
+
+	// The phasors solved by the direct method only exist in the DP domain
+	Bool direct = mSteadyStateMethod == Solver::SteadyStateMethod::Direct;
+	if (direct && mDomain != CPS::Domain::DP) {
+		std::cerr << Logger::prefix() << "WARNING: The direct steady-state initialization "
+			<< "requires the DP domain, stepping the system instead" << std::endl;
+		direct = false;
+	}
+
+	if (direct)
+		directSteadyStateInitialization();
+	else
+		timeSteppingSteadyStateInitialization();
+
+	// Close the initialization logs
+	mInitLeftVectorLog.reset();
+	mInitRightVectorLog.reset();
+
+	// Reset system for actual simulation
+	mRightSideVector.setZero();
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::timeSteppingSteadyStateInitialization() {
+	Real time = 0;
+	Real maxDiff = 0, max = 0;
+	Matrix diff;
+	Matrix prevLeftSideVector = Matrix::Zero(mLeftSideVector.rows(), 1);
+	UInt maxSteps = mSteadyStateMaxIterations > 0
+		? mSteadyStateMaxIterations
+		: (UInt) std::ceil(10 / mTimeStep);
+	UInt steps;
+
+	createInitSystemMatrix();
+
+	for (steps = 0; steps < maxSteps; steps++) {
+		initStep(time, time);
 
 		// Calculate new simulation time
 		time = time + mTimeStep;
@@ -324,48 +1146,284 @@ void MnaSolver<VarType>::steadyStateInitialization() {
 		maxDiff = diff.lpNorm<Eigen::Infinity>();
 		max = mLeftSideVector.lpNorm<Eigen::Infinity>();
 		// If difference is smaller than some epsilon, break
-		if ((maxDiff / max) < eps)
+		if ((maxDiff / max) < mSteadyStateTolerance)
 			break;
 	}
 
 	mLog.info() << "Max difference: " << maxDiff << " or "
-		<< maxDiff / max << "% at time " << time << std::endl;
+		<< maxDiff / max << "% at time " << time << " after " << steps << " steps" << std::endl;
+}
 
-	// Reset system for actual simulation
-	mTmpSystemMatrix.setZero();
-	mRightSideVector.setZero();
+template <typename VarType>
+void MnaSolver<VarType>::directSteadyStateInitialization() {
+	// For time steps which are long compared to the period, the DP companion
+	// models of inductors and capacitors approach the phasor admittances
+	// 1/(j omega L) and j omega C. Their history sources then alternate in
+	// sign from step to step, so the mean of two consecutive solutions is
+	// the steady-state solution of the network.
+	Real steadyStateTimeStep = 1e8 / mSystem.mSystemOmega;
+	// Number of previous iterations used by the Anderson acceleration
+	const UInt depth = 5;
+	UInt maxIterations = mSteadyStateMaxIterations > 0 ? mSteadyStateMaxIterations : 50;
+
+	std::vector<Matrix> prevG, prevF;
+	Matrix x, g, f;
+	Real change = std::numeric_limits<Real>::infinity();
+	UInt iterations;
+
+	// Stamps of the previous iteration. The system matrix is only factorized
+	// again if the components changed their stamps.
+	Matrix prevStamp;
+	SparseMatrix prevSparseStamp;
+
+	// The voltages of components such as loads or generators depend on the
+	// initial node voltages. A fixed point of the node voltages is searched,
+	// which is reached after the first iteration for linear networks. Their
+	// stamps do not depend on the voltages, so they are factorized once and
+	// the second iteration only confirms the fixed point.
+	for (iterations = 1; iterations <= maxIterations; iterations++) {
+		if (iterations > 1) {
+			setInitialNodeVoltages(x);
+			initializeFromPowerflow();
+		}
+
+		mnaInitializeComponents(steadyStateTimeStep);
+		stampSystemMatrix(nullptr);
+		if (denseSystem()) {
+			if (iterations == 1 || mTmpSystemMatrix != prevStamp) {
+				prevStamp = mTmpSystemMatrix;
+				mTmpLuFactorization = factorizeSystemMatrix();
+			}
+		}
+		else if (iterations == 1 || (mSparseSystemMatrix - prevSparseStamp).norm() != 0) {
+			prevSparseStamp = mSparseSystemMatrix;
+			mTmpLuFactorization = factorizeSystemMatrix();
+		}
+
+		initStep(0, iterations - 0.5);
+		g = mLeftSideVector;
+		initStep(0, iterations);
+		g = 0.5 * (g + mLeftSideVector);
+
+		if (iterations == 1) {
+			x = g;
+			continue;
+		}
+
+		f = g - x;
+		change = f.lpNorm<Eigen::Infinity>() / g.lpNorm<Eigen::Infinity>();
+		if (change < mSteadyStateTolerance) {
+			x = g;
+			break;
+		}
+
+		prevG.push_back(g);
+		prevF.push_back(f);
+		if (prevG.size() > depth + 1) {
+			prevG.erase(prevG.begin());
+			prevF.erase(prevF.begin());
+		}
+
+		// Anderson acceleration: combine the previous iterations so that
+		// the linearized residual is minimized
+		UInt m = prevG.size() - 1;
+		if (m == 0) {
+			x = g;
+			continue;
+		}
+
+		Matrix deltaF(f.rows(), m), deltaG(g.rows(), m);
+		for (UInt i = 0; i < m; i++) {
+			deltaF.col(i) = prevF[i + 1] - prevF[i];
+			deltaG.col(i) = prevG[i + 1] - prevG[i];
+		}
+
+		Matrix gamma = deltaF.colPivHouseholderQr().solve(f);
+		x = g - deltaG * gamma;
+	}
+
+	if (change >= mSteadyStateTolerance)
+		mLog.info() << "Steady-state initialization did not converge, relative change "
+			<< change << " after " << maxIterations << " iterations" << std::endl;
+	else
+		mLog.info() << "Steady state reached after " << iterations << " iterations" << std::endl;
+
+	// Initialize the components from the steady-state voltages for the simulation time step
+	setInitialNodeVoltages(x);
+	initializeFromPowerflow();
+	mnaInitializeComponents(mTimeStep);
+
+	mLeftSideVector = x;
+	for (UInt nodeIdx = 0; nodeIdx < mNumNetNodes; nodeIdx++)
+		mNodes[nodeIdx]->mnaUpdateVoltage(mLeftSideVector);
 }
 
 template <typename VarType>
-Real MnaSolver<VarType>::step(Real time) {
+void MnaSolver<VarType>::prefault() {
+	auto touch = [](const Matrix& m) {
+		prefaultMemory(m.data(), m.size() * sizeof(Real));
+	};
+
+	touch(mRightSideVector);
+	touch(mLeftSideVector);
+	for (auto& rightSideVector : mWorkerRightSideVectors)
+		touch(rightSideVector);
+
+	mLeftVectorLog.prefault();
+	mRightVectorLog.prefault();
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::prepareStep(Real time) {
 	// Reset source vector
 	mRightSideVector.setZero();
 
 	// First, step signal components and then power components
 	for (auto comp : mSignalComponents)
 		comp->step(time);
-	for (auto comp : mPowerComponents)
-		comp->mnaStep(mTmpSystemMatrix, mRightSideVector, mLeftSideVector, time);
-	for (auto comp : mSwitches)
-		comp->mnaStep(mTmpSystemMatrix, mRightSideVector, mLeftSideVector, time);
 
-	// Solve MNA system
-	solve();
+	if (mWorkerPool) {
+		mStepTime = time;
+		mWorkerPool->run(mStepTask);
+		for (auto& rightSideVector : mWorkerRightSideVectors)
+			mRightSideVector += rightSideVector;
+	}
+	else {
+		// Components of one type share their implementation, so each
+		// loop calls the same function on contiguous pointers.
+		for (auto& batch : mComponentBatches) {
+			if (!batch.step)
+				continue;
+			for (auto comp : batch.components)
+				comp->mnaStep(mTmpSystemMatrix, mRightSideVector, mLeftSideVector, time);
+		}
+	}
+	checkStepSystemMatrix();
+
+	if (mProfiler)
+		mProfiler->lap(StepProfiler::Phase::PreStep);
+}
 
+template <typename VarType>
+Real MnaSolver<VarType>::finishStep(Real time) {
 	// Some components need to update internal states
-	for (auto comp : mPowerComponents)
-		comp->mnaPostStep(mRightSideVector, mLeftSideVector, time);
+	if (mWorkerPool) {
+		mWorkerPool->run(mPostStepTask);
+	}
+	else {
+		for (auto& batch : mComponentBatches) {
+			for (auto comp : batch.components)
+				comp->mnaPostStep(mRightSideVector, mLeftSideVector, time);
+		}
+	}
+
+	if (mProfiler)
+		mProfiler->lap(StepProfiler::Phase::PostStep);
 
 	// TODO Try to avoid this step.
 	for (UInt nodeIdx = 0; nodeIdx < mNumNetNodes; nodeIdx++)
 		mNodes[nodeIdx]->mnaUpdateVoltage(mLeftSideVector);
 
+	if (mTrackSolutionChange) {
+		Real change = 0, max = 0;
+
+		for (Int i = 0; i < mLeftSideVector.rows(); i++) {
+			change = std::max(change, std::abs(mLeftSideVector(i, 0) - mPreviousLeftSideVector(i, 0)));
+			max = std::max(max, std::abs(mLeftSideVector(i, 0)));
+			mPreviousLeftSideVector(i, 0) = mLeftSideVector(i, 0);
+		}
+
+		mSolutionChange = max > 0 ? change / max : 0;
+	}
+
 	updateSwitchStatus();
-	mLog.debug() << "Switch status is " << mCurrentSwitchStatus << " for " << time << std::endl;
+
+	if (mProfiler)
+		mProfiler->lap(StepProfiler::Phase::VoltageUpdate);
 
 	// Calculate new simulation time
 	return time + mTimeStep;
 }
 
+template <typename VarType>
+Real MnaSolver<VarType>::step(Real time) {
+#ifdef WITH_ALLOCATION_COUNTER
+	// The copy is made before counting the allocations of the step
+	SwitchStatus status = mCurrentSwitchStatus;
+	UInt allocations = AllocationCounter::count();
+#endif
+
+	prepareStep(time);
+
+	// Solve MNA system
+	solve();
+
+	if (mProfiler)
+		mProfiler->lap(StepProfiler::Phase::Solve);
+
+	Real nextTime = finishStep(time);
+
+#ifdef WITH_ALLOCATION_COUNTER
+	// Only a new switch status may allocate memory for its factorization.
+	// Components may allocate in their steps as well, which is reported once.
+	allocations = AllocationCounter::count() - allocations;
+	if (status == mCurrentSwitchStatus && allocations > 0 && mAllocatingSteps++ == 0)
+		std::cerr << Logger::prefix() << "WARNING: Step at " << time << " made " << allocations
+			<< " heap allocations, see allocatingSteps() for the number of such steps" << std::endl;
+#endif
+
+	return nextTime;
+}
+
+template <typename VarType>
+void MnaSolver<VarType>::stepBatch(Batch& batch) {
+	UInt count = (UInt) batch.solvers.size();
+	batch.nextTimes.resize(count);
+
+	for (UInt i = 0; i < count; i++)
+		batch.solvers[i]->prepareStep(batch.times[i]);
+
+	// Solvers with the same factorization are moved next to each other
+	// and solve their right sides as one block
+	batch.order.resize(count);
+	for (UInt i = 0; i < count; i++)
+		batch.order[i] = i;
+
+	for (auto group = batch.order.begin(); group != batch.order.end(); ) {
+		MnaSolver* first = batch.solvers[*group];
+		LUFactorization* lu = first->mLowRankUpdate ? nullptr : first->mActiveLuFactorization.get();
+
+		auto end = group + 1;
+		if (lu) {
+			end = std::stable_partition(group + 1, batch.order.end(), [&](UInt i) {
+				return !batch.solvers[i]->mLowRankUpdate && batch.solvers[i]->mActiveLuFactorization.get() == lu;
+			});
+		}
+
+		Int columns = (Int) (end - group);
+		if (columns == 1) {
+			first->solve();
+		}
+		else {
+			batch.rightSides.resize(first->mRightSideVector.rows(), columns);
+			for (Int col = 0; col < columns; col++)
+				batch.rightSides.col(col) = batch.solvers[group[col]]->mRightSideVector.col(0);
+
+			lu->solveBatch(batch.rightSides, batch.leftSides);
+
+			for (Int col = 0; col < columns; col++)
+				batch.solvers[group[col]]->mLeftSideVector.col(0) = batch.leftSides.col(col);
+		}
+
+		group = end;
+	}
+
+	for (UInt i = 0; i < count; i++) {
+		if (batch.solvers[i]->mProfiler)
+			batch.solvers[i]->mProfiler->lap(StepProfiler::Phase::Solve);
+		batch.nextTimes[i] = batch.solvers[i]->finishStep(batch.times[i]);
+	}
+}
+
 template class DPsim::MnaSolver<Real>;
 template class DPsim::MnaSolver<Complex>;
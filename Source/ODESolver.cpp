@@ -20,91 +20,158 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *********************************************************************************/
 
+#include <iostream>
+
 #include <dpsim/ODESolver.h>
 
 using namespace DPsim;
 using namespace CPS;
 
-ODESolver::ODESolver(String name, SystemTopology system, Real dt, Real t0) :
-	mSystem(system), mTimestep(dt) {
-
-}
+ODESolver::ODESolver(String name, SystemTopology system, Real dt, Real t0, Bool implicit) :
+	mTimeStep(dt), mImplicit(implicit) {
 
-void ODESolver::initialize(Real t0) {
+	for (auto comp : system.mComponents) {
+		auto odeComp = std::dynamic_pointer_cast<ODEInterface>(comp);
+		if (!odeComp)
+			throw UnsupportedSolverException(); // Component does not support the ODE solver interface
 
-}
+		mOffsets.push_back(mProbDim);
+		mProbDim += odeComp->odeStates();
+		mComponents.push_back(odeComp);
+	}
 
-int ODESolver::solve (Real initial_time, bool implicit) {
-	// Not absolutely necessary; realtype by default double (same as Real)
-	realtype T0 = (realtype) initial_time;
-	realtype Tf = (realtype) initial_time+mTimeStep;
+	if (mProbDim == 0)
+		throw SolverException();
 
-	// number integration steps
-	//long int nst,
-	// number error test fails
-	//long int netf;
+	try {
+		initialize(t0);
+	}
+	catch (...) {
+		release();
+		throw;
+	}
+}
 
+void ODESolver::initialize(Real t0) {
 	// Initialize vector data structure
 	y = N_VNew_Serial(mProbDim);
-	if (check_flag((void *)y, "N_VNew_Serial", 0)) return 1;
+	if (check_flag((void *)y, "N_VNew_Serial", 0))
+		throw SolverException();
 
-	// Set initial values:
-	NV_Ith_S(y,0) = 1.0;
+	// Set initial values
+	realtype *state = NV_DATA_S(y);
+	for (UInt i = 0; i < mComponents.size(); i++)
+		mComponents[i]->odePreStep(state + mOffsets[i]);
 
 	// Create the ARKode memory structure
 	arkode_mem = ARKodeCreate();
-	if (check_flag(arkode_mem, "ARKodeCreate", 0)) return 1;
+	if (check_flag(arkode_mem, "ARKodeCreate", 0))
+		throw SolverException();
 
-	 // Call ARKodeInit to initialize the integrator memory and specify the
-	 // right-hand side function in y'=f(t,y), the inital time T0, and
-	 // the initial dependent variable vector y(fluxes+mech. vars).
-	if(implicit) {
-		flag = ARKodeInit(arkode_mem, NULL, &ODESolver::StateSpaceWrapper, T0, y);
-		if (check_flag(&flag, "ARKodeInit", 1)) return 1;
+	// Call ARKodeInit to initialize the integrator memory and specify the
+	// right-hand side function in y'=f(t,y), the inital time T0, and
+	// the initial dependent variable vector y(fluxes+mech. vars).
+	if (mImplicit) {
+		flag = ARKodeInit(arkode_mem, NULL, &ODESolver::StateSpaceWrapper, t0, y);
+		if (check_flag(&flag, "ARKodeInit", 1))
+			throw SolverException();
 
 		// Initialize dense matrix data structure
-	  A = SUNDenseMatrix(dim, dim);
-	  if (check_flag((void *)A, "SUNDenseMatrix", 0)) return 1;
+		A = SUNDenseMatrix(mProbDim, mProbDim);
+		if (check_flag((void *)A, "SUNDenseMatrix", 0))
+			throw SolverException();
 
 		// Initialize linear solver
-	  LS = SUNDenseLinearSolver(y, A);
-	  if (check_flag((void *)LS, "SUNDenseLinearSolver", 0)) return 1;
+		LS = SUNDenseLinearSolver(y, A);
+		if (check_flag((void *)LS, "SUNDenseLinearSolver", 0))
+			throw SolverException();
 
 		// Attach matrix and linear solver
 		flag = ARKDlsSetLinearSolver(arkode_mem, LS, A);
-		if (check_flag(&flag, "ARKDlsSetLinearSolver", 1)) return 1;
-
-		// Set Jacobian routine
-		flag = ARKDlsSetJacFn(arkode_mem, &ODESolver::JacobianWrapper);
-		if (check_flag(&flag, "ARKDlsSetJacFn", 1)) return 1;
+		if (check_flag(&flag, "ARKDlsSetLinearSolver", 1))
+			throw SolverException();
+
+		// Set Jacobian routine if all components provide their part,
+		// otherwise ARKode approximates it by difference quotients
+		Bool analytic = true;
+		for (auto comp : mComponents)
+			analytic = analytic && comp->odeHasJacobian();
+
+		if (analytic) {
+			flag = ARKDlsSetJacFn(arkode_mem, &ODESolver::JacobianWrapper);
+			if (check_flag(&flag, "ARKDlsSetJacFn", 1))
+				throw SolverException();
+		}
 	}
 	else {
-		flag = ARKodeInit(arkode_mem, &ODESolver::StateSpaceWrapper, NULL, T0, y);
-		if (check_flag(&flag, "ARKodeInit", 1)) return 1;
+		flag = ARKodeInit(arkode_mem, &ODESolver::StateSpaceWrapper, NULL, t0, y);
+		if (check_flag(&flag, "ARKodeInit", 1))
+			throw SolverException();
 	}
 
-	// Specify Runge-Kutta Method/order
-	//flag = ARKodeSetOrder(arkode_mem, 4);
-	//if (check_flag(&flag, "ARKodeOrderSet", 1)) return 1;
-
 	// Pass class to user functions(access member variables)
 	flag = ARKodeSetUserData(arkode_mem, this);
 	if (check_flag(&flag, "ARKodeSetUserData", 1))
-		return 1;
+		throw SolverException();
 
 	// Specify tolerances
 	flag = ARKodeSStolerances(arkode_mem, reltol, abstol);
 	if (check_flag(&flag, "ARKodeSStolerances", 1))
-		return 1;
+		throw SolverException();
+}
+
+Real ODESolver::step(Real time) {
+	realtype *state = NV_DATA_S(y);
+	for (UInt i = 0; i < mComponents.size(); i++)
+		mComponents[i]->odePreStep(state + mOffsets[i]);
+
+	// The states may have been changed since the last step, e.g. by events,
+	// so the integrator restarts from them. Its memory, the user data, the
+	// tolerances and the linear solver are kept.
+	if (mImplicit)
+		flag = ARKodeReInit(arkode_mem, NULL, &ODESolver::StateSpaceWrapper, time, y);
+	else
+		flag = ARKodeReInit(arkode_mem, &ODESolver::StateSpaceWrapper, NULL, time, y);
+	if (check_flag(&flag, "ARKodeReInit", 1))
+		throw SolverException();
 
 	// Main integrator loop
-	realtype t = T0;
-	while (Tf-t > 1.0e-15) {
-		flag = ARKode(arkode_mem, Tf, y, &t, ARK_NORMAL);
-		if (check_flag(&flag, "ARKode", 1))	break;
+	realtype t = time;
+	realtype tf = time + mTimeStep;
+	while (tf - t > 1.0e-15) {
+		flag = ARKode(arkode_mem, tf, y, &t, ARK_NORMAL);
+		if (check_flag(&flag, "ARKode", 1))
+			throw SolverException();
 	}
 
-	return flag;
+	for (UInt i = 0; i < mComponents.size(); i++)
+		mComponents[i]->odePostStep(tf, state + mOffsets[i]);
+
+	return tf;
+}
+
+int ODESolver::StateSpace(realtype t, N_Vector y, N_Vector ydot) {
+	const realtype *state = NV_DATA_S(y);
+	realtype *dstate_dt = NV_DATA_S(ydot);
+
+	for (UInt i = 0; i < mComponents.size(); i++)
+		mComponents[i]->odeStateSpace(t, state + mOffsets[i], dstate_dt + mOffsets[i]);
+
+	return 0;
+}
+
+int ODESolver::Jacobian(realtype t, N_Vector y, N_Vector fy, SUNMatrix J) {
+	const realtype *state = NV_DATA_S(y);
+	realtype *jacobian = SM_DATA_D(J);
+	Int rows = SM_ROWS_D(J);
+
+	// Components do not depend on each other's states, so each one
+	// writes a block on the diagonal of the column-major matrix
+	SUNMatZero(J);
+	for (UInt i = 0; i < mComponents.size(); i++)
+		mComponents[i]->odeJacobian(t, state + mOffsets[i], jacobian + mOffsets[i] * rows + mOffsets[i], rows);
+
+	return 0;
 }
 
 int ODESolver::StateSpaceWrapper(realtype t, N_Vector y, N_Vector ydot, void *user_data){
@@ -115,7 +182,7 @@ int ODESolver::StateSpaceWrapper(realtype t, N_Vector y, N_Vector ydot, void *us
 int ODESolver::JacobianWrapper(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
                N_Vector tmp1, N_Vector tmp2, N_Vector tmp3){
 	ODESolver *self=reinterpret_cast<ODESolver *>(user_data);
-	return self->Jacobian(t, y, fy, J, tmp1, tmp2, tmp3);
+	return self->Jacobian(t, y, fy, J);
 }
 
 // ARKode-Error checking functions
@@ -126,12 +193,12 @@ int ODESolver::JacobianWrapper(realtype t, N_Vector y, N_Vector fy, SUNMatrix J,
 //			 flag >= 0
 //	opt == 2 means function allocates memory so check if returned
 //			 NULL pointer
-int ODESolver::check_flag(void *flagvalue, const string funcname, int opt) {
+int ODESolver::check_flag(void *flagvalue, const std::string funcname, int opt) {
 	int *errflag;
 
 	// Check if SUNDIALS function returned NULL pointer - no memory allocated
 	if (opt == 0 && flagvalue == NULL) {
-		cerr << "\nSUNDIALS_ERROR: " << funcname << " failed - returned NULL pointer\n\n";
+		std::cerr << "\nSUNDIALS_ERROR: " << funcname << " failed - returned NULL pointer\n\n";
 		return 1;
 	}
 
@@ -139,22 +206,33 @@ int ODESolver::check_flag(void *flagvalue, const string funcname, int opt) {
 	else if (opt == 1) {
 		errflag = (int *) flagvalue;
 		if (*errflag < 0) {
-			cerr << "\nSUNDIALS_ERROR: " << funcname << " failed with flag = " << *errflag << "\n\n";
+			std::cerr << "\nSUNDIALS_ERROR: " << funcname << " failed with flag = " << *errflag << "\n\n";
 			return 1;
 		}
 	}
 	// Check if function returned NULL pointer - no memory allocated
 	else if (opt == 2 && flagvalue == NULL) {
-		cerr << "\nMEMORY_ERROR: " << funcname << " failed - returned NULL pointer\n\n";
+		std::cerr << "\nMEMORY_ERROR: " << funcname << " failed - returned NULL pointer\n\n";
 		return 1;
 	}
 
 	return 0;
 }
 
-ODESolver::~ODESolver() {
+void ODESolver::release() {
 	ARKodeFree(&arkode_mem);
-	N_VDestroy(y);
-  	SUNLinSolFree(LS);
-	SUNMatDestroy(A);
+	if (y)
+		N_VDestroy(y);
+	if (LS)
+		SUNLinSolFree(LS);
+	if (A)
+		SUNMatDestroy(A);
+
+	y = NULL;
+	LS = NULL;
+	A = NULL;
+}
+
+ODESolver::~ODESolver() {
+	release();
 }
@@ -0,0 +1,386 @@
+/** Partitioned LU factorization
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <queue>
+
+#include <dpsim/PartitionedFactorization.h>
+
+using namespace DPsim;
+
+using Graph = std::vector<std::vector<Int>>;
+
+/// Breadth-first level sets of the unknowns with the given label, starting at root
+static std::vector<std::vector<Int>> levelSets(const Graph& graph,
+	const std::vector<Int>& label, Int part, Int root) {
+
+	std::vector<std::vector<Int>> levels;
+	std::vector<Int> level(graph.size(), -1);
+	std::vector<Int> current = { root };
+	level[root] = 0;
+
+	while (!current.empty()) {
+		std::vector<Int> next;
+		for (auto u : current) {
+			for (auto v : graph[u]) {
+				if (label[v] == part && level[v] < 0) {
+					level[v] = (Int) levels.size() + 1;
+					next.push_back(v);
+				}
+			}
+		}
+		levels.push_back(std::move(current));
+		current = std::move(next);
+	}
+
+	return levels;
+}
+
+/// Label the connected parts of the unknowns which are not in the interface (-1)
+static Int connectedParts(const Graph& graph, std::vector<Int>& label) {
+	std::vector<Int> part(label.size(), -1);
+	Int parts = 0;
+
+	for (Int start = 0; start < (Int) label.size(); start++) {
+		if (label[start] < 0 || part[start] >= 0)
+			continue;
+
+		std::queue<Int> queue;
+		queue.push(start);
+		part[start] = parts;
+
+		while (!queue.empty()) {
+			Int u = queue.front();
+			queue.pop();
+			for (auto v : graph[u]) {
+				if (label[v] >= 0 && part[v] < 0) {
+					part[v] = parts;
+					queue.push(v);
+				}
+			}
+		}
+		parts++;
+	}
+
+	for (Int i = 0; i < (Int) label.size(); i++)
+		label[i] = label[i] < 0 ? -1 : part[i];
+
+	return parts;
+}
+
+void PartitionedFactorization::computePartition(const SparseMatrix& mat,
+	const std::vector<Int>& torn, UInt blocks, std::vector<Int>& partition) {
+
+	Int dim = mat.rows();
+
+	// The coupling of the unknowns is the symmetric pattern of the matrix
+	Graph graph(dim);
+	for (Int col = 0; col < mat.outerSize(); col++) {
+		for (SparseMatrix::InnerIterator it(mat, col); it; ++it) {
+			if (it.row() != col && it.value() != 0) {
+				graph[it.row()].push_back(col);
+				graph[col].push_back((Int) it.row());
+			}
+		}
+	}
+
+	partition.assign(dim, 0);
+	for (auto i : torn)
+		partition[i] = -1;
+
+	Int parts = connectedParts(graph, partition);
+
+	// Split the largest part at the smallest level set which leaves at least
+	// a quarter of the part on either side, or the most balanced one
+	std::vector<Bool> unsplittable;
+	while (blocks > 0 && parts < (Int) blocks) {
+		std::vector<Int> sizes(parts, 0);
+		for (auto p : partition) {
+			if (p >= 0)
+				sizes[p]++;
+		}
+		unsplittable.resize(parts, false);
+
+		Int largest = -1;
+		for (Int p = 0; p < parts; p++) {
+			if (!unsplittable[p] && (largest < 0 || sizes[p] > sizes[largest]))
+				largest = p;
+		}
+		if (largest < 0)
+			break;
+
+		Int root = (Int) (std::find(partition.begin(), partition.end(), largest) - partition.begin());
+
+		// Start at a pseudo-peripheral unknown for long and narrow level sets
+		auto levels = levelSets(graph, partition, largest, root);
+		levels = levelSets(graph, partition, largest, levels.back().front());
+
+		if (levels.size() < 3) {
+			unsplittable[largest] = true;
+			continue;
+		}
+
+		Int size = sizes[largest], before = (Int) levels[0].size();
+		Int separator = -1, balanced = 1, balance = size;
+		for (Int l = 1; l < (Int) levels.size() - 1; l++) {
+			Int after = size - before - (Int) levels[l].size();
+			if (std::min(before, after) >= size / 4 &&
+				(separator < 0 || levels[l].size() < levels[separator].size()))
+				separator = l;
+			if (std::abs(before - after) < balance) {
+				balance = std::abs(before - after);
+				balanced = l;
+			}
+			before += (Int) levels[l].size();
+		}
+		if (separator < 0)
+			separator = balanced;
+
+		for (auto i : levels[separator])
+			partition[i] = -1;
+
+		parts = connectedParts(graph, partition);
+		unsplittable.assign(parts, false);
+	}
+
+	if (blocks == 0 || parts <= (Int) blocks)
+		return;
+
+	// Assign the parts from the largest to the smallest to the smallest block
+	std::vector<Int> sizes(parts, 0);
+	for (auto p : partition) {
+		if (p >= 0)
+			sizes[p]++;
+	}
+
+	std::vector<Int> order(parts);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](Int l, Int r) { return sizes[l] > sizes[r]; });
+
+	std::vector<Int> block(parts), blockSizes(blocks, 0);
+	for (auto p : order) {
+		Int b = (Int) (std::min_element(blockSizes.begin(), blockSizes.end()) - blockSizes.begin());
+		block[p] = b;
+		blockSizes[b] += sizes[p];
+	}
+
+	for (auto& p : partition) {
+		if (p >= 0)
+			p = block[p];
+	}
+}
+
+PartitionedFactorization::PartitionedFactorization(const SparseMatrix& mat,
+	const std::vector<Int>& partition, std::shared_ptr<WorkerPool> workerPool) :
+	LUFactorization(Solver::MatrixType::Sparse),
+	mRows(mat.rows()),
+	mWorkerPool(workerPool) {
+
+	if ((Int) partition.size() != mRows)
+		throw SolverException();
+
+	// Position of each unknown within its block or the interface
+	std::vector<Int> local(mRows);
+	Int numBlocks = 0;
+	for (Int i = 0; i < mRows; i++)
+		numBlocks = std::max(numBlocks, partition[i] + 1);
+
+	std::vector<Block> blocks(numBlocks);
+	for (Int i = 0; i < mRows; i++) {
+		if (partition[i] < 0) {
+			local[i] = (Int) mInterface.size();
+			mInterface.push_back(i);
+		}
+		else {
+			auto& unknowns = blocks[partition[i]].unknowns;
+			local[i] = (Int) unknowns.size();
+			unknowns.push_back(i);
+		}
+	}
+
+	// Drop the numbers of blocks without unknowns
+	std::vector<Int> blockIndex(numBlocks, -1);
+	for (Int b = 0; b < numBlocks; b++) {
+		if (blocks[b].unknowns.empty())
+			continue;
+		blockIndex[b] = (Int) mBlocks.size();
+		mBlocks.push_back(std::move(blocks[b]));
+	}
+
+	Int interfaceSize = (Int) mInterface.size();
+	std::vector<std::vector<Eigen::Triplet<Real>>> diagonal(mBlocks.size()),
+		fromInterface(mBlocks.size()), toInterface(mBlocks.size());
+	Matrix schur = Matrix::Zero(interfaceSize, interfaceSize);
+
+	for (Int col = 0; col < mat.outerSize(); col++) {
+		for (SparseMatrix::InnerIterator it(mat, col); it; ++it) {
+			Int row = (Int) it.row();
+			Int rowBlock = partition[row] < 0 ? -1 : blockIndex[partition[row]];
+			Int colBlock = partition[col] < 0 ? -1 : blockIndex[partition[col]];
+
+			if (rowBlock < 0 && colBlock < 0)
+				schur(local[row], local[col]) = it.value();
+			else if (rowBlock < 0)
+				toInterface[colBlock].emplace_back(local[row], local[col], it.value());
+			else if (colBlock < 0)
+				fromInterface[rowBlock].emplace_back(local[row], local[col], it.value());
+			else if (rowBlock == colBlock)
+				diagonal[rowBlock].emplace_back(local[row], local[col], it.value());
+			else if (it.value() != 0)
+				// The blocks are not separated by the interface
+				throw SolverException();
+		}
+	}
+
+	// Factorize the blocks in parallel and compute their responses to the interface
+	std::vector<std::exception_ptr> errors(mBlocks.size());
+	run([&](UInt worker) {
+		auto range = blockRange(worker);
+		for (UInt b = range.first; b < range.second; b++) {
+			auto& block = mBlocks[b];
+			Int size = (Int) block.unknowns.size();
+
+			try {
+				SparseMatrix diag(size, size);
+				diag.setFromTriplets(diagonal[b].begin(), diagonal[b].end());
+
+				SparseOrdering ordering;
+				LUFactorization::computeOrdering(diag, ordering);
+				block.lu = std::make_shared<LUFactorization>(diag, ordering);
+
+				SparseMatrix from(size, interfaceSize);
+				from.setFromTriplets(fromInterface[b].begin(), fromInterface[b].end());
+				block.coupling = block.lu->solve(Matrix(from));
+
+				block.toInterface.resize(interfaceSize, size);
+				block.toInterface.setFromTriplets(toInterface[b].begin(), toInterface[b].end());
+
+				block.rhs = Matrix::Zero(size, 1);
+				block.solution = Matrix::Zero(size, 1);
+			}
+			catch (...) {
+				// Exceptions must not leave the worker threads
+				errors[b] = std::current_exception();
+			}
+		}
+	});
+
+	for (auto& error : errors) {
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	// The contributions are summed in a fixed order, so that the result
+	// does not depend on the number of workers
+	for (auto& block : mBlocks)
+		schur -= block.toInterface * block.coupling;
+
+	if (interfaceSize > 0)
+		mInterfaceLu.compute(schur);
+
+	mInterfaceRhs = Matrix::Zero(interfaceSize, 1);
+	mInterfaceSolution = Matrix::Zero(interfaceSize, 1);
+
+	mForwardTask = [this](UInt worker) {
+		auto range = blockRange(worker);
+		for (UInt b = range.first; b < range.second; b++) {
+			auto& block = mBlocks[b];
+			for (UInt i = 0; i < block.unknowns.size(); i++)
+				block.rhs(i, 0) = (*mRhs)(block.unknowns[i], mCol);
+			block.lu->solve(block.rhs, block.solution);
+		}
+	};
+
+	mBackwardTask = [this](UInt worker) {
+		auto range = blockRange(worker);
+		for (UInt b = range.first; b < range.second; b++) {
+			auto& block = mBlocks[b];
+			if (mInterface.size() > 0)
+				block.solution.noalias() -= block.coupling * mInterfaceSolution;
+			for (UInt i = 0; i < block.unknowns.size(); i++)
+				(*mLhs)(block.unknowns[i], mCol) = block.solution(i, 0);
+		}
+	};
+}
+
+std::pair<UInt, UInt> PartitionedFactorization::blockRange(UInt worker) const {
+	return mWorkerPool
+		? mWorkerPool->range(worker, (UInt) mBlocks.size())
+		: std::make_pair<UInt, UInt>(0, (UInt) mBlocks.size());
+}
+
+void PartitionedFactorization::run(const WorkerPool::Task& task) const {
+	if (mWorkerPool)
+		mWorkerPool->run(task);
+	else
+		task(0);
+}
+
+void PartitionedFactorization::solve(const Matrix& rhs, Matrix& lhs) const {
+	lhs.resize(rhs.rows(), rhs.cols());
+	mRhs = &rhs;
+	mLhs = &lhs;
+
+	for (mCol = 0; mCol < rhs.cols(); mCol++) {
+		run(mForwardTask);
+
+		if (mInterface.size() > 0) {
+			for (UInt i = 0; i < mInterface.size(); i++)
+				mInterfaceRhs(i, 0) = rhs(mInterface[i], mCol);
+			for (auto& block : mBlocks)
+				mInterfaceRhs.noalias() -= block.toInterface * block.solution;
+
+			mInterfaceSolution.noalias() = mInterfaceLu.permutationP() * mInterfaceRhs;
+			mInterfaceLu.matrixLU().triangularView<Eigen::UnitLower>().solveInPlace(mInterfaceSolution);
+			mInterfaceLu.matrixLU().triangularView<Eigen::Upper>().solveInPlace(mInterfaceSolution);
+
+			for (UInt i = 0; i < mInterface.size(); i++)
+				lhs(mInterface[i], mCol) = mInterfaceSolution(i, 0);
+		}
+
+		run(mBackwardTask);
+	}
+}
+
+void PartitionedFactorization::solveBatch(const BatchMatrix& rhs, BatchMatrix& lhs) const {
+	mBatchRhs = rhs;
+	solve(mBatchRhs, mBatchLhs);
+	lhs = mBatchLhs;
+}
+
+std::size_t PartitionedFactorization::memorySize() const {
+	std::size_t size = (mInterfaceLu.matrixLU().size() + 2 * mInterface.size()) * sizeof(Real)
+		+ mInterface.size() * sizeof(int);
+
+	for (auto& block : mBlocks)
+		size += block.lu->memorySize()
+			+ (block.coupling.size() + 2 * block.unknowns.size()) * sizeof(Real)
+			+ block.toInterface.nonZeros() * (sizeof(Real) + sizeof(int))
+			+ block.unknowns.size() * sizeof(Int);
+
+	return size;
+}
+
+void PartitionedFactorization::print(std::ostream& os) const {
+	os << "Partitioned LU factorization of dimension " << mRows << " with "
+		<< mBlocks.size() << " blocks and " << mInterface.size() << " interface unknowns";
+}
@@ -0,0 +1,177 @@
+/** Newton-Raphson power flow
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cmath>
+
+#include <dpsim/PowerFlowSolver.h>
+#include <dpsim/LUFactorization.h>
+
+using namespace DPsim;
+
+PowerFlowSolver::PowerFlowSolver(const SparseMatrixComp& admittance, const std::vector<Bus>& buses) :
+	mAdmittance(admittance),
+	mBuses(buses),
+	mVoltages(MatrixComp::Zero(buses.size(), 1)),
+	mAngleIndices(buses.size(), -1),
+	mMagnitudeIndices(buses.size(), -1) {
+
+	if (mAdmittance.rows() != (Int) buses.size() || mAdmittance.cols() != (Int) buses.size())
+		throw SolverException();
+
+	mAdmittance.makeCompressed();
+
+	Int slack = -1;
+	for (UInt i = 0; i < buses.size(); i++) {
+		if (buses[i].type == BusType::Slack) {
+			slack = i;
+			break;
+		}
+	}
+	if (slack < 0)
+		throw SolverException();
+
+	// Flat start at the voltage of the slack bus
+	Complex slackVoltage = std::polar(buses[slack].V, buses[slack].angle);
+	Real basePower = 0;
+
+	std::vector<UInt> magnitudes;
+	for (UInt i = 0; i < buses.size(); i++) {
+		if (mAdmittance.col(i).nonZeros() == 0)
+			continue;
+
+		switch (buses[i].type) {
+		case BusType::Slack:
+			mVoltages(i, 0) = std::polar(buses[i].V, buses[i].angle);
+			continue;
+
+		case BusType::PV:
+			mVoltages(i, 0) = std::polar(buses[i].V, buses[slack].angle);
+			basePower = std::max(basePower, std::abs(buses[i].P));
+			break;
+
+		case BusType::PQ:
+			mVoltages(i, 0) = slackVoltage;
+			basePower = std::max(basePower, std::abs(buses[i].P) + std::abs(buses[i].Q));
+			magnitudes.push_back(i);
+			break;
+		}
+
+		mAngleIndices[i] = mNumUnknowns++;
+	}
+
+	for (auto i : magnitudes)
+		mMagnitudeIndices[i] = mNumUnknowns++;
+
+	if (basePower > 0)
+		mBasePower = basePower;
+}
+
+MatrixComp PowerFlowSolver::powers() const {
+	MatrixComp currents = mAdmittance * mVoltages;
+
+	return mVoltages.cwiseProduct(currents.conjugate());
+}
+
+void PowerFlowSolver::jacobian(const MatrixComp& currents, SparseMatrix& jac) const {
+	std::vector<Eigen::Triplet<Real>> entries;
+	entries.reserve(4 * (mAdmittance.nonZeros() + mBuses.size()));
+
+	// Derivatives of the complex power of bus i with respect to the
+	// angle and the magnitude of the voltage of bus k
+	auto add = [&](Int i, Int k, Complex dAngle, Complex dMagnitude) {
+		Int ai = mAngleIndices[i], ak = mAngleIndices[k];
+		Int mi = mMagnitudeIndices[i], mk = mMagnitudeIndices[k];
+
+		if (ai >= 0 && ak >= 0)
+			entries.emplace_back(ai, ak, dAngle.real());
+		if (ai >= 0 && mk >= 0)
+			entries.emplace_back(ai, mk, dMagnitude.real());
+		if (mi >= 0 && ak >= 0)
+			entries.emplace_back(mi, ak, dAngle.imag());
+		if (mi >= 0 && mk >= 0)
+			entries.emplace_back(mi, mk, dMagnitude.imag());
+	};
+
+	for (Int k = 0; k < mAdmittance.outerSize(); k++) {
+		for (SparseMatrixComp::InnerIterator it(mAdmittance, k); it; ++it) {
+			Int i = it.row();
+			Complex yv = it.value() * mVoltages(k, 0);
+
+			add(i, k, -Complex(0, 1) * mVoltages(i, 0) * std::conj(yv),
+				mVoltages(i, 0) * std::conj(yv / std::abs(mVoltages(k, 0))));
+		}
+	}
+
+	for (UInt i = 0; i < mBuses.size(); i++) {
+		if (mAngleIndices[i] < 0)
+			continue;
+
+		add(i, i, Complex(0, 1) * mVoltages(i, 0) * std::conj(currents(i, 0)),
+			std::conj(currents(i, 0)) * mVoltages(i, 0) / std::abs(mVoltages(i, 0)));
+	}
+
+	// The entries are always emitted in the same order, so the pattern does
+	// not change even if some of the derivatives vanish
+	jac.resize(mNumUnknowns, mNumUnknowns);
+	jac.setFromTriplets(entries.begin(), entries.end());
+}
+
+Bool PowerFlowSolver::solve(Real tolerance, UInt maxIterations) {
+	SparseMatrix jac;
+	SparseOrdering ordering;
+	Matrix mismatch(mNumUnknowns, 1);
+
+	for (mIterations = 0; ; mIterations++) {
+		MatrixComp currents = mAdmittance * mVoltages;
+		MatrixComp powers = mVoltages.cwiseProduct(currents.conjugate());
+
+		for (UInt i = 0; i < mBuses.size(); i++) {
+			if (mAngleIndices[i] >= 0)
+				mismatch(mAngleIndices[i], 0) = mBuses[i].P - powers(i, 0).real();
+			if (mMagnitudeIndices[i] >= 0)
+				mismatch(mMagnitudeIndices[i], 0) = mBuses[i].Q - powers(i, 0).imag();
+		}
+
+		mMismatch = mNumUnknowns > 0 ? mismatch.lpNorm<Eigen::Infinity>() / mBasePower : 0;
+		if (mMismatch < tolerance)
+			return true;
+		if (mIterations == maxIterations)
+			return false;
+
+		jacobian(currents, jac);
+		if (mIterations == 0)
+			LUFactorization::computeOrdering(jac, ordering);
+
+		LUFactorization lu(jac, ordering);
+		Matrix delta = lu.solve(mismatch);
+
+		for (UInt i = 0; i < mBuses.size(); i++) {
+			if (mAngleIndices[i] < 0)
+				continue;
+
+			Real angle = std::arg(mVoltages(i, 0)) + delta(mAngleIndices[i], 0);
+			Real magnitude = std::abs(mVoltages(i, 0));
+			if (mMagnitudeIndices[i] >= 0)
+				magnitude += delta(mMagnitudeIndices[i], 0);
+
+			mVoltages(i, 0) = std::polar(magnitude, angle);
+		}
+	}
+}
@@ -341,19 +341,24 @@ PyObject* Python::Interface::addExport(Interface* self, PyObject* args, PyObject
 int Python::Interface::init(Python::Interface *self, PyObject *args, PyObject *kwds)
 {
 #ifdef WITH_SHMEM
-	static const char *kwlist[] = {"wname", "rname", "queuelen", "samplelen", "polling", nullptr};
+	static const char *kwlist[] = {"wname", "rname", "queuelen", "samplelen", "polling", "batch_size", "double_precision", nullptr};
 
 	/* Default values */
 	self->conf.queuelen = 512;
 	self->conf.samplelen = 64;
 	self->conf.polling = 0;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|iib", (char **) kwlist,
-		&self->wname, &self->rname, &self->conf.queuelen, &self->conf.samplelen, &self->conf.polling)) {
+	unsigned int batchSize = 1;
+	int doublePrecision = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|iibIp", (char **) kwlist,
+		&self->wname, &self->rname, &self->conf.queuelen, &self->conf.samplelen, &self->conf.polling, &batchSize, &doublePrecision)) {
 		return -1;
 	}
 
 	self->intf = DPsim::Interface::make(self->wname, self->rname, &self->conf);
+	self->intf->setBatchSize(batchSize);
+	self->intf->setDoublePrecision(doublePrecision);
 
 	return 0;
 #else
@@ -381,7 +386,7 @@ PyMethodDef Python::Interface::methods[] = {
 };
 
 const char* Python::Interface::doc =
-"__init__(wname, rname, queuelen=512, samplelen=64, polling=False)\n"
+"__init__(wname, rname, queuelen=512, samplelen=64, polling=False, batch_size=1, double_precision=False)\n"
 "Opens a set of shared memory regions to use as an interface for communication. The communication type / format of VILLASNode's shmem node-type is used; see its documentation for more information on the internals.\n"
 "\n"
 "For this interface type, the indices passed to the methods specify the indices "
@@ -398,6 +403,10 @@ const char* Python::Interface::doc =
 ":param polling: If True, no POSIX CV will be used to signal writes to the "
 "interface, meaning that polling will have to be used. This may increase "
 "performance at the cost of wasted CPU time.\n"
+":param batch_size: Number of samples exchanged per access to the queues. "
+"The samples of all time steps are staged and written at once.\n"
+":param double_precision: If True, complex values are passed as two double "
+"values at ``idx`` and ``idx+1`` instead of a single-precision complex value.\n"
 ":returns: A new `Interface` object.\n";
 PyTypeObject Python::Interface::type = {
 	PyVarObject_HEAD_INIT(nullptr, 0)
@@ -120,13 +120,31 @@ PyObject* Python::Logger::logAttribute(Logger* self, PyObject* args, PyObject *k
 
 int Python::Logger::init(Python::Logger *self, PyObject *args, PyObject *kwds)
 {
-	static const char *kwlist[] = {"filename", nullptr};
+	static const char *kwlist[] = {"filename", "format", "precision", nullptr};
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s", (char **) kwlist, &self->filename)) {
+	const char *format = "csv";
+	unsigned int precision = 64;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|sI", (char **) kwlist, &self->filename, &format, &precision)) {
 		return -1;
 	}
 
-	self->logger = DPsim::DataLogger::make(self->filename);
+	DPsim::DataLogger::Format fmt;
+	if (!strcmp(format, "csv"))
+		fmt = DPsim::DataLogger::Format::CSV;
+	else if (!strcmp(format, "binary"))
+		fmt = DPsim::DataLogger::Format::Binary;
+	else {
+		PyErr_SetString(PyExc_ValueError, "Invalid format, must be 'csv' or 'binary'");
+		return -1;
+	}
+
+	if (precision != 32 && precision != 64) {
+		PyErr_SetString(PyExc_ValueError, "Invalid precision, must be 32 or 64");
+		return -1;
+	}
+
+	self->logger = DPsim::DataLogger::make(self->filename, true, fmt, precision / 8);
 
 	return 0;
 }
@@ -142,7 +160,12 @@ PyMethodDef Python::Logger::methods[] = {
 };
 
 const char* Python::Logger::doc =
-"__init__(filename)\n";
+"__init__(filename, format='csv', precision=64)\n"
+"Create a logger which writes the attributes to a file.\n"
+"\n"
+":param filename: Name of the log file without extension.\n"
+":param format: 'csv' or 'binary'. Binary files can be read with ``dpsim.read_binary_log()``.\n"
+":param precision: Bits per value in binary files, 32 or 64.\n";
 PyTypeObject Python::Logger::type = {
 	PyVarObject_HEAD_INIT(nullptr, 0)
 	"dpsim.Logger",                          /* tp_name */
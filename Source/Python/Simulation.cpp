@@ -48,6 +48,12 @@ void Python::Simulation::threadFunction(Python::Simulation *self)
 	Real time, finalTime;
 	Timer timer(Timer::Flags::fail_on_overrun);
 
+	if (self->busyWait)
+		timer.setMode(Timer::Mode::hybrid);
+
+	// Create the solver before the timer is started
+	self->sim->initialize();
+
 #ifdef WITH_SHMEM
 	for (auto ifm : self->sim->interfaces())
 		ifm.interface->open();
@@ -59,6 +65,10 @@ void Python::Simulation::threadFunction(Python::Simulation *self)
 	}
 
 	if (self->realTime) {
+		auto rts = std::dynamic_pointer_cast<DPsim::RealTimeSimulation>(self->sim);
+		if (rts)
+			rts->prepare();
+
 		timer.setStartTime(self->startTime);
 		timer.setInterval(self->realTimeStep);
 		timer.start();
@@ -154,11 +164,14 @@ PyObject* Python::Simulation::newfunc(PyTypeObject* subtype, PyObject *args, PyO
 
 int Python::Simulation::init(Simulation* self, PyObject *args, PyObject *kwds)
 {
-	static const char *kwlist[] = {"name", "system", "timestep", "duration", "start_time", "start_time_us", "sim_type", "solver_type", "single_stepping", "rt", "rt_factor", "start_sync", "init_steady_state", "log_level", "fail_on_overrun", nullptr};
+	static const char *kwlist[] = {"name", "system", "timestep", "duration", "start_time", "start_time_us", "sim_type", "solver_type", "single_stepping", "rt", "rt_factor", "start_sync", "init_steady_state", "log_level", "fail_on_overrun", "sparse", "profile", "rt_cpus", "rt_priority", "rt_lock_memory", "rt_busy_wait", "log_events", "implicit_ode", nullptr};
 	double timestep = 1e-3, duration = DBL_MAX, rtFactor = 1;
 	const char *name = nullptr;
 	int t = 0, s = 0, rt = 0, ss = 0, st = 0, initSteadyState = 0;
-	int failOnOverrun = 0;
+	int failOnOverrun = 0, sparse = 0, profile = 0, logEvents = 0, implicitODE = 0;
+	PyObject *rtCpus = nullptr;
+	DPsim::RealTimeSettings rtSettings;
+	int rtLockMemory = 0, rtBusyWait = 0;
 
 	CPS::Logger::Level logLevel = CPS::Logger::Level::INFO;
 
@@ -168,16 +181,38 @@ int Python::Simulation::init(Simulation* self, PyObject *args, PyObject *kwds)
 	enum Solver::Type solverType;
 	enum Domain domain;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|ddkkiippdppip", (char **) kwlist,
-		&name, &self->pySys, &timestep, &duration, &startTime, &startTimeUs, &s, &t, &ss, &rt, &rtFactor, &st, &initSteadyState, &logLevel, &failOnOverrun)) {
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "sO|ddkkiippdppipppOipppp", (char **) kwlist,
+		&name, &self->pySys, &timestep, &duration, &startTime, &startTimeUs, &s, &t, &ss, &rt, &rtFactor, &st, &initSteadyState, &logLevel, &failOnOverrun, &sparse, &profile,
+		&rtCpus, &rtSettings.priority, &rtLockMemory, &rtBusyWait, &logEvents, &implicitODE)) {
 		return -1;
 	}
 
+	if (rtCpus) {
+		if (!PyList_Check(rtCpus)) {
+			PyErr_SetString(PyExc_TypeError, "rt_cpus must be a list of CPU numbers");
+			return -1;
+		}
+
+		for (Py_ssize_t i = 0; i < PyList_Size(rtCpus); i++) {
+			long cpu = PyLong_AsLong(PyList_GetItem(rtCpus, i));
+			if (cpu == -1 && PyErr_Occurred())
+				return -1;
+
+			rtSettings.cpus.push_back((CPS::Int) cpu);
+		}
+	}
+
+	rtSettings.lockMemory = rtLockMemory;
+	// Fault in enough stack for the solver, as is common for real-time applications
+	if (rtLockMemory)
+		rtSettings.prefaultStack = 512 * 1024;
+
 	self->state = State::stopped;
 	self->realTime = rt;
 	self->startSync = ss;
 	self->singleStepping = st;
 	self->failOnOverrun = failOnOverrun;
+	self->busyWait = rtBusyWait;
 	self->realTimeStep = timestep / rtFactor;
 
 	if (startTime > 0) {
@@ -196,8 +231,9 @@ int Python::Simulation::init(Simulation* self, PyObject *args, PyObject *kwds)
 	switch (t) {
 		case 0: solverType = DPsim::Solver::Type::MNA; break;
 		case 1: solverType = DPsim::Solver::Type::DAE; break;
+		case 2: solverType = DPsim::Solver::Type::ODE; break;
 		default:
-			PyErr_SetString(PyExc_TypeError, "Invalid solver_type argument (must be 0 or 1)");
+			PyErr_SetString(PyExc_TypeError, "Invalid solver_type argument (must be 0, 1 or 2)");
 			return -1;
 	}
 
@@ -209,11 +245,27 @@ int Python::Simulation::init(Simulation* self, PyObject *args, PyObject *kwds)
 	Py_INCREF(self->pySys);
 
 	if (self->realTime) {
-		self->sim = std::make_shared<DPsim::RealTimeSimulation>(name, *self->pySys->sys, timestep, duration, domain, solverType, logLevel, initSteadyState);
+		auto rts = std::make_shared<DPsim::RealTimeSimulation>(name, *self->pySys->sys, timestep, duration, domain, solverType, logLevel, initSteadyState);
+		rts->setRealTimeSettings(rtSettings);
+
+		self->sim = rts;
 	}
 	else {
 		self->sim = std::make_shared<DPsim::Simulation>(name, *self->pySys->sys, timestep, duration, domain, solverType, logLevel, initSteadyState);
 	}
+
+	if (sparse)
+		self->sim->setSystemMatrixType(DPsim::Solver::MatrixType::Sparse);
+
+	if (profile)
+		self->sim->setProfiling(true);
+
+	if (logEvents)
+		self->sim->setEventLogging(true);
+
+	if (implicitODE)
+		self->sim->setImplicitODE(true);
+
 	self->channel = new EventChannel();
 
 	return 0;
@@ -346,6 +398,75 @@ fail:
 	return nullptr;
 }
 
+const char* Python::Simulation::docLoadEvents =
+"load_events(filename)\n"
+"Schedule the attribute changes of an event file.\n"
+"\n"
+"Each line of the CSV file contains the time, the name of a component or node, "
+"the name of the attribute, the new value and, for complex attributes, an optional "
+"imaginary part. Lines should be sorted by time.\n"
+"\n"
+":param filename: The path of the event file.";
+PyObject* Python::Simulation::loadEvents(Simulation* self, PyObject* args)
+{
+	const char *filename;
+
+	if (!PyArg_ParseTuple(args, "s", &filename))
+		return nullptr;
+
+	try {
+		self->sim->loadEvents(filename);
+	}
+	catch (std::invalid_argument &e) {
+		PyErr_SetString(PyExc_ValueError, e.what());
+		return nullptr;
+	}
+	catch (SystemError &) {
+		PyErr_Format(PyExc_IOError, "Cannot open event file %s", filename);
+		return nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
+const char* Python::Simulation::docSetTimeStep =
+"set_timestep(timestep, max_timestep=None, tolerance=1e-3)\n"
+"Change the time step, also while the simulation is paused.\n"
+"\n"
+"If a maximum time step is given, the time step is adapted between both limits. "
+"It is reset to the smaller one when events are executed, doubled while the relative "
+"change of the solution stays below the tolerance and halved when it exceeds ten times the tolerance.\n"
+"\n"
+":param timestep: The new or minimum time step.\n"
+":param max_timestep: The maximum time step of the adaptive time step.\n"
+":param tolerance: The relative change of the solution per step.";
+PyObject* Python::Simulation::setTimeStep(Simulation* self, PyObject* args, PyObject *kwargs)
+{
+	double timeStep, maxTimeStep = 0, tolerance = 1e-3;
+
+	const char *kwlist[] = {"timestep", "max_timestep", "tolerance", nullptr};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "d|dd", (char **) kwlist, &timeStep, &maxTimeStep, &tolerance))
+		return nullptr;
+
+	try {
+		if (maxTimeStep > 0)
+			self->sim->setAdaptiveTimeStep(timeStep, maxTimeStep, tolerance);
+		else
+			self->sim->setTimeStep(timeStep);
+	}
+	catch (std::invalid_argument &e) {
+		PyErr_SetString(PyExc_ValueError, e.what());
+		return nullptr;
+	}
+	catch (SolverException &) {
+		PyErr_SetString(PyExc_NotImplementedError, "The solver does not support changing the time step");
+		return nullptr;
+	}
+
+	Py_RETURN_NONE;
+}
+
 const char* Python::Simulation::docAddInterface =
 "add_interface(intf)\n"
 "Add an external interface to the simulation. "
@@ -596,12 +717,45 @@ PyObject* Python::Simulation::finalTime(Simulation *self, void *ctx)
 	return Py_BuildValue("f", self->sim->finalTime());
 }
 
+const char *Python::Simulation::docLatencies =
+"latencies\n"
+"Latencies of the phases of the simulation steps in seconds, if the simulation "
+"was created with ``profile=True``. A dictionary which maps each phase to the "
+"number of recorded steps and the min, mean, p50, p90, p99, p999 and max latencies.";
+PyObject* Python::Simulation::latencies(Simulation *self, void *ctx)
+{
+	std::unique_lock<std::mutex> lk(*self->mut);
+
+	PyObject *dict = PyDict_New();
+
+	for (CPS::UInt i = 0; i < DPsim::StepProfiler::numPhases; i++) {
+		auto phase = (DPsim::StepProfiler::Phase) i;
+		auto &h = self->sim->profiler().histogram(phase);
+
+		PyObject *stats = Py_BuildValue("{s:K,s:d,s:d,s:d,s:d,s:d,s:d,s:d}",
+			"count", (unsigned long long) h.count(),
+			"min",   h.min() * 1e-9,
+			"mean",  h.mean() * 1e-9,
+			"p50",   h.percentile(0.5) * 1e-9,
+			"p90",   h.percentile(0.9) * 1e-9,
+			"p99",   h.percentile(0.99) * 1e-9,
+			"p999",  h.percentile(0.999) * 1e-9,
+			"max",   h.max() * 1e-9);
+
+		PyDict_SetItemString(dict, DPsim::StepProfiler::phaseName(phase), stats);
+		Py_DECREF(stats);
+	}
+
+	return dict;
+}
+
 PyGetSetDef Python::Simulation::getset[] = {
 	{(char *) "state",      (getter) Python::Simulation::getState, nullptr, (char *) Python::Simulation::docState, nullptr},
 	{(char *) "name",       (getter) Python::Simulation::name,  nullptr, (char *) Python::Simulation::docName, nullptr},
 	{(char *) "steps",      (getter) Python::Simulation::steps, nullptr, nullptr, nullptr},
 	{(char *) "time",       (getter) Python::Simulation::time,  nullptr, nullptr, nullptr},
 	{(char *) "final_time", (getter) Python::Simulation::finalTime, nullptr, nullptr, nullptr},
+	{(char *) "latencies",  (getter) Python::Simulation::latencies, nullptr, (char *) Python::Simulation::docLatencies, nullptr},
 	{nullptr, nullptr, nullptr, nullptr, nullptr}
 };
 
@@ -609,6 +763,8 @@ PyMethodDef Python::Simulation::methods[] = {
 	{"add_interface", (PyCFunction) Python::Simulation::addInterface, METH_VARARGS | METH_KEYWORDS, (char *) Python::Simulation::docAddInterface},
 	{"add_logger",    (PyCFunction) Python::Simulation::addLogger, METH_VARARGS | METH_KEYWORDS, (char *) Python::Simulation::docAddLogger},
 	{"add_event",     (PyCFunction) Python::Simulation::addEvent, METH_VARARGS, (char *) docAddEvent},
+	{"load_events",   (PyCFunction) Python::Simulation::loadEvents, METH_VARARGS, (char *) docLoadEvents},
+	{"set_timestep",  (PyCFunction) Python::Simulation::setTimeStep, METH_VARARGS | METH_KEYWORDS, (char *) docSetTimeStep},
 	{"pause",         (PyCFunction) Python::Simulation::pause, METH_NOARGS, (char *) Python::Simulation::docPause},
 	{"start",         (PyCFunction) Python::Simulation::start, METH_NOARGS, (char *) Python::Simulation::docStart},
 	{"step",          (PyCFunction) Python::Simulation::step, METH_NOARGS,  (char *) Python::Simulation::docStep},
@@ -631,13 +787,27 @@ const char *Python::Simulation::doc =
 "``timestep`` is the simulation timestep in seconds.\n\n"
 "``duration`` is the duration after which the simulation stops; the default value "
 "lets the simulation run indefinitely until being stopped manually by `stop`.\n\n"
+"If ``sparse`` is True, the MNA solver stores and factorizes the system matrices "
+"in sparse format, which is recommended for large networks.\n\n"
 "If ``rt`` is True, the simulation will run in realtime mode. The simulation will "
 "try to match simulation time with the wall clock time; violations will be logged.\n\n"
 "If ``start_sync`` is given as well, a specific method for synchronizing the "
 "simulation start with other external simulators will be used. After performing "
 "a first step with the initial values, the simulation will wait until receiving "
 "the first message(s) from the external interface(s) until the realtime simulation "
-"starts properly.";
+"starts properly.\n\n"
+"In real-time mode, ``rt_cpus`` restricts the simulation thread to a list of CPUs, "
+"``rt_priority`` runs it with the given ``SCHED_FIFO`` priority and ``rt_lock_memory`` "
+"locks the memory of the process. Settings which can not be applied are reported "
+"as warnings. If ``rt_busy_wait`` is True, the simulation sleeps until shortly before "
+"each time step and polls the clock for the rest, which reduces the wake-up latency "
+"at the cost of CPU time.\n\n"
+"If ``profile`` is True, the latencies of the phases of each step are recorded "
+"and can be queried with `latencies`.\n\n"
+"If ``log_events`` is True, every executed event is written to ``<name>_events.csv`` "
+"in the log directory.\n\n"
+"If ``implicit_ode`` is True, the ODE solver integrates with an implicit method "
+"suited for stiff systems instead of an explicit one.";
 PyTypeObject Python::Simulation::type = {
 	PyVarObject_HEAD_INIT(nullptr, 0)
 	"dpsim.Simulation",                      /* tp_name */
@@ -0,0 +1,92 @@
+import os
+import struct
+
+import numpy as np
+
+MAGIC = b'DPSIMLOG'
+VERSION = 1
+
+def read_binary_log(filename):
+    """Read a file written by a DataLogger in binary format.
+
+    The file is memory-mapped and each run of equally sized chunks is viewed
+    as an array of structured records, so the columns are copied into their
+    result arrays without reading the whole file into memory first.
+
+    :param filename: Path of the .dpsim file.
+    :returns: A tuple (data, units) of dictionaries which map the column names
+        to numpy arrays and unit strings. The time is stored in column 'time'.
+    """
+    if os.path.getsize(filename) < 24:
+        raise ValueError('%s is not a binary DPsim log file' % filename)
+
+    buf = np.memmap(filename, np.uint8, 'r')
+
+    if buf[:8].tobytes() != MAGIC:
+        raise ValueError('%s is not a binary DPsim log file' % filename)
+
+    for order in ['<', '>']:
+        version, bom, precision, columns = struct.unpack_from(order + 'IIII', buf, 8)
+        if bom == 0x01020304:
+            break
+    else:
+        raise ValueError('Invalid byte order mark in %s' % filename)
+
+    if version != VERSION:
+        raise ValueError('Unsupported log file version %d' % version)
+
+    def read_string(offset):
+        if offset + 4 > len(buf):
+            raise ValueError('Truncated header in %s' % filename)
+
+        length, = struct.unpack_from(order + 'I', buf, offset)
+        offset += 4
+        if offset + length > len(buf):
+            raise ValueError('Truncated header in %s' % filename)
+
+        return buf[offset:offset + length].tobytes().decode(), offset + length
+
+    offset = 24
+    names = []
+    units = {}
+    for i in range(columns):
+        name, offset = read_string(offset)
+        unit, offset = read_string(offset)
+        names.append(name)
+        units[name] = unit
+
+    time_type = np.dtype(order + 'f8')
+    value_type = np.dtype(order + ('f4' if precision == 4 else 'f8'))
+    row_size = time_type.itemsize + (columns - 1) * value_type.itemsize
+
+    # Only the row counts are read here to locate the chunks
+    runs = []
+    while offset < len(buf):
+        if offset + 4 > len(buf):
+            raise ValueError('Truncated chunk in %s' % filename)
+
+        rows, = struct.unpack_from(order + 'I', buf, offset)
+        if runs and runs[-1][1] == rows:
+            runs[-1][2] += 1
+        else:
+            runs.append([offset, rows, 1])
+        offset += 4 + rows * row_size
+
+    if offset != len(buf):
+        raise ValueError('Truncated chunk in %s' % filename)
+
+    total = sum(rows * count for _, rows, count in runs)
+    data = { name: np.empty(total, (time_type if i == 0 else value_type).newbyteorder('='))
+        for i, name in enumerate(names) }
+
+    start = 0
+    for offset, rows, count in runs:
+        record = np.dtype([('rows', order + 'u4')] +
+            [('c%d' % i, time_type if i == 0 else value_type, (rows,)) for i in range(columns)])
+        chunks = np.ndarray(count, record, buf, offset)
+
+        for i, name in enumerate(names):
+            data[name][start:start + rows * count] = chunks['c%d' % i].reshape(-1)
+        start += rows * count
+
+    return data, units
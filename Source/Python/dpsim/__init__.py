@@ -23,6 +23,7 @@ from _dpsim import load_cim
 
 from .Simulation import Simulation, RealTimeSimulation
 from .EventChannel import EventChannel
+from .BinaryLog import read_binary_log
 
 # Try to shmem load interface on supported platforms
 try:
@@ -70,4 +71,5 @@ __all__ = [
     'SystemTopology',
     'Logger',
     'load_cim',
+    'read_binary_log',
 ]
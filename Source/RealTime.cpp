@@ -0,0 +1,115 @@
+/** Real-time execution environment
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cerrno>
+#include <cstring>
+
+#include <dpsim/RealTime.h>
+
+#ifdef WITH_RT
+  #include <alloca.h>
+  #include <malloc.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+using namespace DPsim;
+
+#ifdef WITH_RT
+static String errorString(const String &what, int err) {
+	return what + ": " + std::strerror(err);
+}
+
+/// Fault in the stack pages below the caller. The pages are touched in one
+/// frame of the full size, a recursion with small frames is a tail call
+/// which the compiler turns into a loop over the same frame.
+static void __attribute__((noinline)) prefaultStack(std::size_t size) {
+	std::size_t page = sysconf(_SC_PAGESIZE);
+	volatile char *buffer = (volatile char *) alloca(size);
+
+	for (std::size_t i = 0; i < size; i += page)
+		buffer[i] = 0;
+
+	buffer[size - 1] = 0;
+}
+#endif
+
+std::vector<String> RealTimeSettings::apply() const {
+	std::vector<String> failures;
+
+#ifdef WITH_RT
+	if (lockMemory) {
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+			failures.push_back(errorString("Failed to lock memory", errno));
+
+		// Keep freed memory in the process, so that later allocations do not fault
+		if (mallopt(M_TRIM_THRESHOLD, -1) == 0 || mallopt(M_MMAP_MAX, 0) == 0)
+			failures.push_back("Failed to disable returning memory to the system");
+	}
+
+	if (prefaultStack > 0)
+		::prefaultStack(prefaultStack);
+
+	if (cpus.size() > 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (auto cpu : cpus)
+			CPU_SET(cpu, &set);
+
+		int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (ret != 0)
+			failures.push_back(errorString("Failed to set CPU affinity", ret));
+	}
+
+	if (priority > 0) {
+		struct sched_param param;
+		param.sched_priority = priority;
+
+		int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (ret != 0)
+			failures.push_back(errorString("Failed to set SCHED_FIFO priority " + std::to_string(priority), ret));
+	}
+#else
+	if (lockMemory || prefaultStack > 0 || cpus.size() > 0 || priority > 0)
+		failures.push_back("Real-time settings are not supported on this platform");
+#endif
+
+	return failures;
+}
+
+void DPsim::prefaultMemory(const void *begin, std::size_t size) {
+	if (size == 0)
+		return;
+
+#ifdef WITH_RT
+	std::size_t page = sysconf(_SC_PAGESIZE);
+#else
+	std::size_t page = 4096;
+#endif
+
+	volatile char *p = (volatile char *) begin;
+
+	for (std::size_t i = 0; i < size; i += page)
+		p[i] = p[i];
+
+	p[size - 1] = p[size - 1];
+}
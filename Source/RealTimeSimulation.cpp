@@ -32,6 +32,28 @@ RealTimeSimulation::RealTimeSimulation(String name, SystemTopology system, Real
 {
 	addAttribute<Real>("time_step", &mTimeStep, Flags::read);
 	addAttribute<Int >("overruns", nullptr, [=](){ return mTimer.overruns(); }, Flags::read);
+	// Delay between the timer ticks and the start of the steps in seconds
+	addAttribute<Real>("lateness_mean", nullptr, [=](){ return mTimer.lateness().mean() * 1e-9; }, Flags::read);
+	addAttribute<Real>("lateness_p99", nullptr, [=](){ return mTimer.lateness().percentile(0.99) * 1e-9; }, Flags::read);
+	addAttribute<Real>("lateness_max", nullptr, [=](){ return mTimer.lateness().max() * 1e-9; }, Flags::read);
+}
+
+std::vector<String> RealTimeSimulation::prepare()
+{
+	auto failures = mRealTimeSettings.apply();
+
+	for (auto failure : failures) {
+		std::cerr << Logger::prefix() << "WARNING: " << failure << std::endl;
+		mLog.info() << "Real-time setup incomplete: " << failure << std::endl;
+	}
+
+	mSolver->prefault();
+	for (auto sub : mSubsystems)
+		sub->prefault();
+	for (auto lg : mLoggers)
+		lg.logger->prefault();
+
+	return failures;
 }
 
 void RealTimeSimulation::run(const Timer::StartClock::duration &startIn)
@@ -44,6 +66,8 @@ void RealTimeSimulation::run(const Timer::StartClock::time_point &startAt)
 	auto startAtDur = startAt.time_since_epoch();
 	auto startAtNSecs = std::chrono::duration_cast<std::chrono::nanoseconds>(startAtDur);
 
+	initialize();
+
 	mLog.info() << "Opening interfaces." << std::endl;
 
 #ifdef WITH_SHMEM
@@ -53,6 +77,8 @@ void RealTimeSimulation::run(const Timer::StartClock::time_point &startAt)
 
 	sync();
 
+	prepare();
+
 	mLog.info() << "Starting simulation at " << startAt << " (delta_T = " << startAt - Timer::StartClock::now() << " seconds)" << std::endl;
 
 	mTimer.setStartTime(startAt);
@@ -61,6 +87,12 @@ void RealTimeSimulation::run(const Timer::StartClock::time_point &startAt)
 
 	// main loop
 	do {
+#ifdef WITH_SHMEM
+		// Reads must not wait beyond the tick which ends this step
+		for (auto ifm : mInterfaces)
+			ifm.interface->setDeadline(mTimer.nextTick());
+#endif
+
 		step();
 		mTimer.sleep();
 
@@ -68,15 +100,18 @@ void RealTimeSimulation::run(const Timer::StartClock::time_point &startAt)
 			mLog.info() << "Simulation started." << std::endl;
 	} while (mTime < mFinalTime);
 
-	mLog.info() << "Simulation finished." << std::endl;
-
 #ifdef WITH_SHMEM
+	// A later start synchronization waits for the remotes without deadline
 	for (auto ifm : mInterfaces)
-		ifm.interface->close();
+		ifm.interface->setDeadline(Timer::IntervalTimePoint());
 #endif
 
-	for (auto lg : mLoggers)
-		lg.logger->flush();
+	mLog.info() << "Simulation finished." << std::endl;
+	mLog.info() << "Timer: " << mTimer.overruns() << " overruns, lateness mean "
+		<< mTimer.lateness().mean() * 1e-3 << " us, p99 " << mTimer.lateness().percentile(0.99) * 1e-3
+		<< " us, max " << mTimer.lateness().max() * 1e-3 << " us" << std::endl;
+
+	closeInterfacesAndLoggers();
 
 	mTimer.stop();
 }
@@ -0,0 +1,103 @@
+/** Factorizations shared between solvers
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <string_view>
+
+#include <dpsim/SharedFactorizations.h>
+
+using namespace DPsim;
+
+std::size_t SharedFactorizations::hash(const SparseMatrix& mat, Solver::MatrixType type) {
+	auto bytes = [](const void* data, std::size_t size) {
+		return std::hash<std::string_view>()(std::string_view(static_cast<const char*>(data), size));
+	};
+
+	std::size_t h = std::hash<Int>()((Int) type) ^ (std::hash<Int>()((Int) mat.rows()) << 1);
+	h ^= bytes(mat.valuePtr(), mat.nonZeros() * sizeof(Real)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	h ^= bytes(mat.innerIndexPtr(), mat.nonZeros() * sizeof(int)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	h ^= bytes(mat.outerIndexPtr(), (mat.outerSize() + 1) * sizeof(int)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+
+	return h;
+}
+
+Bool SharedFactorizations::equal(const SparseMatrix& left, const SparseMatrix& right) {
+	return left.rows() == right.rows() && left.cols() == right.cols()
+		&& left.nonZeros() == right.nonZeros()
+		&& std::equal(left.outerIndexPtr(), left.outerIndexPtr() + left.outerSize() + 1, right.outerIndexPtr())
+		&& std::equal(left.innerIndexPtr(), left.innerIndexPtr() + left.nonZeros(), right.innerIndexPtr())
+		&& std::equal(left.valuePtr(), left.valuePtr() + left.nonZeros(), right.valuePtr());
+}
+
+LUFactorization::Ptr SharedFactorizations::get(const SparseMatrix& mat, Solver::MatrixType type, const Factorize& factorize) {
+	SparseMatrix key = mat;
+	key.makeCompressed();
+	std::size_t h = hash(key, type);
+
+	std::promise<LUFactorization::Ptr> promise;
+	std::shared_future<LUFactorization::Ptr> existing;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto range = mEntries.equal_range(h);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second.type == type && equal(it->second.matrix, key)) {
+				existing = it->second.lu;
+				break;
+			}
+		}
+
+		if (existing.valid())
+			mHits++;
+		else {
+			mMisses++;
+			mEntries.emplace(h, Entry{ type, std::move(key), promise.get_future().share() });
+		}
+	}
+
+	// Waits if another solver is still factorizing the matrix
+	if (existing.valid())
+		return existing.get();
+
+	try {
+		auto lu = factorize();
+		promise.set_value(lu);
+		return lu;
+	}
+	catch (...) {
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+}
+
+UInt SharedFactorizations::entries() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return (UInt) mEntries.size();
+}
+
+UInt SharedFactorizations::hits() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mHits;
+}
+
+UInt SharedFactorizations::misses() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mMisses;
+}
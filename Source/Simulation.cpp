@@ -18,8 +18,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *********************************************************************************/
 
+#include <cmath>
+
 #include <dpsim/Simulation.h>
 #include <dpsim/MNASolver.h>
+#include <dpsim/Checkpoint.h>
 
 #ifdef WITH_CIM
   #include <cps/CIM/Reader.h>
@@ -27,6 +30,7 @@
 
 #ifdef WITH_SUNDIALS
   #include <dpsim/DAESolver.h>
+  #include <dpsim/ODESolver.h>
 #endif
 
 using namespace CPS;
@@ -40,10 +44,23 @@ Simulation::Simulation(String name,
 	mName(name),
 	mFinalTime(finalTime),
 	mTimeStep(timeStep),
-	mLogLevel(logLevel)
+	mLogLevel(logLevel),
+	mDomain(domain),
+	mSolverType(solverType),
+	mEvents(timeStep)
 {
 	addAttribute<String>("name", &mName, Flags::read);
 	addAttribute<Real>("final_time", &mFinalTime, Flags::read);
+
+	// Latencies of the step phases in seconds, e.g. "latency_solve_p99"
+	for (UInt i = 0; i < StepProfiler::numPhases; i++) {
+		auto phase = (StepProfiler::Phase) i;
+		auto name = String("latency_") + StepProfiler::phaseName(phase);
+
+		addAttribute<Real>(name + "_mean", nullptr, [=](){ return mProfiler.histogram(phase).mean() * 1e-9; }, Flags::read);
+		addAttribute<Real>(name + "_p99", nullptr, [=](){ return mProfiler.histogram(phase).percentile(0.99) * 1e-9; }, Flags::read);
+		addAttribute<Real>(name + "_max", nullptr, [=](){ return mProfiler.histogram(phase).max() * 1e-9; }, Flags::read);
+	}
 }
 
 Simulation::Simulation(String name, SystemTopology system,
@@ -54,25 +71,213 @@ Simulation::Simulation(String name, SystemTopology system,
 	Simulation(name, timeStep, finalTime,
 		domain, solverType, logLevel) {
 
-	switch (solverType) {
+	mSystem = system;
+	mSteadyStateInit = steadyStateInit;
+}
+
+template <typename VarType>
+std::shared_ptr<Solver> Simulation::createMnaSolver(String name, SystemTopology& system,
+	Real timeStep, Domain domain, Bool mainSystem) {
+	auto solver = std::make_shared<MnaSolver<VarType>>(name, timeStep,
+		domain, mLogLevel, mSteadyStateInit);
+
+	solver->setSystemMatrixType(mSystemMatrixType);
+	solver->setFactorizationCacheLimits(mFactorizationCacheEntries, mFactorizationCacheSize);
+	solver->setLowRankSwitchUpdates(mLowRankSwitchUpdates, mMaxUpdateRank);
+	solver->setThreads(mThreads, mThreadCpus);
+	solver->setSharedFactorizations(mSharedFactorizations);
+	solver->setSteadyStateInitialization(mSteadyStateMethod, mSteadyStateTolerance,
+		mSteadyStateMaxIterations, mSteadyStateLogging);
+	solver->setPowerFlowSettings(mPowerFlowTolerance, mPowerFlowMaxIterations);
+	if (mainSystem) {
+		for (auto& pfb : mPowerFlowBuses)
+			solver->addPowerFlowBus(pfb.node, pfb.bus, pfb.components);
+		if (mPartitioned)
+			solver->setPartitioning(mPartitions, mTearingObjects);
+	}
+	if (mAsyncLogging)
+		solver->setAsyncLogging(mAsyncLoggingCapacity, mAsyncLoggingPolicy);
+	if (mainSystem && mCheckpoint)
+		solver->setCheckpoint(*mCheckpoint);
+	solver->initialize(system);
+
+	return solver;
+}
+
+void Simulation::initialize() {
+	if (mInitialized)
+		return;
+
+	// The state of subsystems is not part of checkpoints
+	if (mCheckpoint && !mSubsystems.empty())
+		throw std::invalid_argument("Checkpoints do not support subsystems");
+
+	switch (mSolverType) {
 	case Solver::Type::MNA:
-		if (domain == Domain::DP)
-			mSolver = std::make_shared<MnaSolver<Complex>>(name, system, timeStep,
-				domain, logLevel, steadyStateInit);
+		if (mDomain == Domain::DP)
+			mSolver = createMnaSolver<Complex>(mName, mSystem, mTimeStep, mDomain, true);
 		else
-			mSolver = std::make_shared<MnaSolver<Real>>(name, system, timeStep,
-				domain, logLevel, steadyStateInit);
+			mSolver = createMnaSolver<Real>(mName, mSystem, mTimeStep, mDomain, true);
 		break;
 
 #ifdef WITH_SUNDIALS
 	case Solver::Type::DAE:
-		mSolver = std::make_shared<DAESolver>(name, system, timeStep, 0.0);
+		if (mCheckpoint)
+			throw UnsupportedSolverException();
+		mSolver = std::make_shared<DAESolver>(mName, mSystem, mTimeStep, 0.0, mSystemMatrixType);
+		break;
+
+	case Solver::Type::ODE:
+		if (mCheckpoint)
+			throw UnsupportedSolverException();
+		mSolver = std::make_shared<ODESolver>(mName, mSystem, mTimeStep, 0.0, mImplicitODE);
 		break;
 #endif /* WITH_SUNDIALS */
 
 	default:
 		throw UnsupportedSolverException();
 	}
+
+	for (auto sub : mSubsystems) {
+		auto name = mName + "_" + sub->name();
+		auto solver = sub->domain() == Domain::DP
+			? createMnaSolver<Complex>(name, sub->system(), sub->timeStep(), sub->domain(), false)
+			: createMnaSolver<Real>(name, sub->system(), sub->timeStep(), sub->domain(), false);
+
+		sub->setSolver(solver, mTimeStep, mSystem.mSystemOmega);
+		mLog.info() << "Subsystem " << sub->name() << " takes " << sub->ratio()
+			<< " steps per simulation step" << std::endl;
+	}
+
+	if (mProfiling)
+		mSolver->setProfiler(&mProfiler);
+
+	if (mCheckpoint) {
+		mEvents.skip(mTime);
+		mCheckpoint.reset();
+	}
+
+	if (mAdaptiveTimeStep) {
+		if (!mSolver->setTimeStep(mTimeStep))
+			throw SolverException();
+		mSolver->setTrackSolutionChange(true);
+	}
+
+	mInitialized = true;
+}
+
+void Simulation::saveCheckpoint(const String &filename, Bool factorizations) {
+	initialize();
+
+	if (!mSubsystems.empty())
+		throw std::invalid_argument("Checkpoints do not support subsystems");
+
+	std::ofstream os(filename, std::ios::binary);
+	if (!os)
+		throw SystemError("Cannot open checkpoint file " + filename);
+
+	os.write(Checkpoint::magic, sizeof(Checkpoint::magic));
+	Checkpoint::write(os, Checkpoint::version);
+	Checkpoint::write(os, mDomain);
+	Checkpoint::write(os, mTime);
+	Checkpoint::write(os, mTimeStepCount);
+	Checkpoint::write(os, mTimeStep);
+
+	mSolver->saveCheckpoint(os, factorizations);
+
+	mLog.info() << "Saved checkpoint at " << mTime << " to " << filename << std::endl;
+}
+
+void Simulation::loadCheckpoint(const String &filename) {
+	if (mInitialized)
+		throw SolverException();
+
+	auto is = std::make_unique<std::ifstream>(filename, std::ios::binary);
+	if (!*is)
+		throw SystemError("Cannot open checkpoint file " + filename);
+
+	char magic[sizeof(Checkpoint::magic)];
+	if (!is->read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), Checkpoint::magic) ||
+		Checkpoint::read<UInt>(*is) != Checkpoint::version)
+		throw std::invalid_argument("Unsupported checkpoint file " + filename);
+
+	if (Checkpoint::read<Domain>(*is) != mDomain)
+		throw std::invalid_argument("Checkpoint does not match the domain of the simulation");
+
+	Checkpoint::read(*is, mTime);
+	Checkpoint::read(*is, mTimeStepCount);
+	setTimeStep(Checkpoint::read<Real>(*is));
+
+	mCheckpoint = std::move(is);
+
+	mLog.info() << "Resuming from checkpoint at " << mTime << std::endl;
+}
+
+void Simulation::setTimeStep(Real timeStep) {
+	if (!(timeStep > 0) || std::isinf(timeStep))
+		throw std::invalid_argument("Invalid time step");
+
+	if (mInitialized && !mSolver->setTimeStep(timeStep))
+		throw SolverException();
+
+	mTimeStep = timeStep;
+
+	// Events are mapped to the smallest time step so that they are not delayed
+	if (mTimeStep < mEvents.timeStep())
+		mEvents.setTimeStep(mTimeStep);
+}
+
+void Simulation::setAdaptiveTimeStep(Real minTimeStep, Real maxTimeStep, Real tolerance) {
+	if (minTimeStep <= 0 || maxTimeStep < minTimeStep)
+		throw std::invalid_argument("Invalid limits of the adaptive time step");
+
+	mAdaptiveTimeStep = true;
+	mMinTimeStep = minTimeStep;
+	mMaxTimeStep = maxTimeStep;
+	mTimeStepTolerance = tolerance;
+	mQuietSteps = 0;
+
+	// All times are multiples of the minimum time step, as steps are only doubled and halved
+	mEvents.setTimeStep(mMinTimeStep);
+	setTimeStep(mMinTimeStep);
+
+	if (mInitialized)
+		mSolver->setTrackSolutionChange(true);
+}
+
+void Simulation::adaptTimeStep(Bool eventsExecuted) {
+	// The solution change is the one of the previous step
+	Real timeStep = mTimeStep;
+	Real change = mSolver->solutionChange();
+
+	if (eventsExecuted) {
+		timeStep = mMinTimeStep;
+		mQuietSteps = 0;
+	}
+	else if (change > 10 * mTimeStepTolerance) {
+		timeStep = std::max(mMinTimeStep, timeStep / 2);
+		mQuietSteps = 0;
+	}
+	else if (change < mTimeStepTolerance) {
+		// Increase the time step only if it stays aligned to its new size
+		if (++mQuietSteps >= 4 && timeStep < mMaxTimeStep &&
+			std::abs(std::remainder(mTime, 2 * timeStep)) < 1e-6 * mMinTimeStep) {
+			timeStep = std::min(mMaxTimeStep, 2 * timeStep);
+			mQuietSteps = 0;
+		}
+	}
+	else
+		mQuietSteps = 0;
+
+	// Do not step over the next event
+	Real nextEvent = mEvents.nextStepTime(mTime + timeStep);
+	while (timeStep > mMinTimeStep && mTime + timeStep > nextEvent + 1e-6 * mMinTimeStep)
+		timeStep = std::max(mMinTimeStep, timeStep / 2);
+
+	if (timeStep != mTimeStep) {
+		mLog.debug() << "Time step " << timeStep << " at " << mTime << std::endl;
+		setTimeStep(timeStep);
+	}
 }
 
 Simulation::~Simulation() {
@@ -85,6 +290,7 @@ void Simulation::sync()
 	// We send initial state over all interfaces
 	for (auto ifm : mInterfaces) {
 		ifm.interface->writeValues();
+		ifm.interface->flush();
 	}
 
 	std::cout << Logger::prefix() << "Waiting for start synchronization on " << mInterfaces.size() << " interfaces" << std::endl;
@@ -99,6 +305,8 @@ void Simulation::sync()
 }
 
 void Simulation::run() {
+	initialize();
+
 	mLog.info() << "Opening interfaces." << std::endl;
 
 #ifdef WITH_SHMEM
@@ -114,37 +322,102 @@ void Simulation::run() {
 		step();
 	}
 
+	finish();
+}
+
+void Simulation::closeInterfacesAndLoggers() {
 #ifdef WITH_SHMEM
-	for (auto ifm : mInterfaces)
+	for (auto ifm : mInterfaces) {
 		ifm.interface->close();
+
+		auto &stats = ifm.interface->statistics();
+		mLog.info() << "Interface " << ifm.interface->name() << ": " << stats.reads << " samples read, "
+			<< stats.lateSamples << " late, " << stats.missedSamples << " missed, "
+			<< "max. wait " << std::chrono::duration_cast<std::chrono::microseconds>(stats.maxWaitTime).count() << " us" << std::endl;
+	}
 #endif
 
-	for (auto lg : mLoggers)
+	for (auto lg : mLoggers) {
 		lg.logger->flush();
 
+		if (lg.logger->droppedSamples() > 0 || lg.logger->decimatedSamples() > 0)
+			mLog.info() << "Logger dropped " << lg.logger->droppedSamples()
+				<< " and decimated " << lg.logger->decimatedSamples() << " samples" << std::endl;
+	}
+}
+
+void Simulation::finish() {
+	closeInterfacesAndLoggers();
+
+	mLog.info() << "Executed " << mEvents.executed() << " events, "
+		<< mEvents.size() << " events remaining" << std::endl;
 	mLog.info() << "Simulation finished." << std::endl;
 }
 
 Real Simulation::step() {
-	Real nextTime;
+	prepareStep();
+
+	// The MNA solver records its own phases, the rest of the step counts as solve time
+	finishStep(mSolver->step(mTime));
+
+	return mTime;
+}
+
+void Simulation::prepareStep() {
+	if (!mInitialized)
+		initialize();
+
+	StepProfiler *profiler = mProfiling ? &mProfiler : nullptr;
+	if (profiler)
+		profiler->start();
 
 #ifdef WITH_SHMEM
 	for (auto ifm : mInterfaces) {
 		if (mTimeStepCount % ifm.downsampling == 0)
 			ifm.interface->readValues(ifm.sync);
 	}
+
+	if (profiler)
+		profiler->lap(StepProfiler::Phase::InterfaceRead);
 #endif
 
+	UInt executedEvents = mEvents.executed();
 	mEvents.handleEvents(mTime);
 
-	nextTime = mSolver->step(mTime);
+	if (mAdaptiveTimeStep)
+		adaptTimeStep(mEvents.executed() != executedEvents);
+
+	if (profiler)
+		profiler->lap(StepProfiler::Phase::Events);
+
+	for (auto sub : mSubsystems)
+		sub->applyOutputs();
+}
+
+void Simulation::finishStep(Real nextTime) {
+	StepProfiler *profiler = mProfiling ? &mProfiler : nullptr;
+
+	// Subsystems catch up with the simulation after its step
+	for (auto sub : mSubsystems)
+		sub->step(mTime);
+
+	if (profiler)
+		profiler->lap(StepProfiler::Phase::Solve);
+
 	mSolver->log(mTime);
 
+	if (profiler)
+		profiler->lap(StepProfiler::Phase::Logging);
+
 #ifdef WITH_SHMEM
 	for (auto ifm : mInterfaces) {
-		if (mTimeStepCount % ifm.downsampling == 0)
+		// Batched interfaces stage every step and send the batch at once
+		if (ifm.interface->batchSize() > 1 || mTimeStepCount % ifm.downsampling == 0)
 			ifm.interface->writeValues();
 	}
+
+	if (profiler)
+		profiler->lap(StepProfiler::Phase::InterfaceWrite);
 #endif
 
 	for (auto lg : mLoggers) {
@@ -153,8 +426,70 @@ Real Simulation::step() {
         }
 	}
 
+	if (profiler) {
+		profiler->lap(StepProfiler::Phase::Logging);
+		profiler->finish();
+	}
+
 	mTime = nextTime;
 	mTimeStepCount++;
+}
 
-	return mTime;
+void Simulation::runBatch(const std::vector<Simulation*>& simulations) {
+	MnaSolver<Real>::Batch realBatch;
+	MnaSolver<Complex>::Batch complexBatch;
+	// Simulations of the solvers in each batch
+	std::vector<Simulation*> realSimulations, complexSimulations;
+
+	for (auto sim : simulations) {
+#ifdef WITH_SHMEM
+		if (!sim->mInterfaces.empty())
+			throw std::invalid_argument("Simulations with interfaces cannot be run in a batch");
+#endif
+		sim->initialize();
+		sim->mLog.info() << "Start simulation in a batch of " << simulations.size() << std::endl;
+	}
+
+	for (Bool running = true; running; ) {
+		running = false;
+		realBatch.solvers.clear();
+		realBatch.times.clear();
+		realSimulations.clear();
+		complexBatch.solvers.clear();
+		complexBatch.times.clear();
+		complexSimulations.clear();
+
+		for (auto sim : simulations) {
+			if (sim->mTime >= sim->mFinalTime)
+				continue;
+
+			running = true;
+			sim->prepareStep();
+
+			if (auto solver = dynamic_cast<MnaSolver<Real>*>(sim->mSolver.get())) {
+				realBatch.solvers.push_back(solver);
+				realBatch.times.push_back(sim->mTime);
+				realSimulations.push_back(sim);
+			}
+			else if (auto solver = dynamic_cast<MnaSolver<Complex>*>(sim->mSolver.get())) {
+				complexBatch.solvers.push_back(solver);
+				complexBatch.times.push_back(sim->mTime);
+				complexSimulations.push_back(sim);
+			}
+			else {
+				sim->finishStep(sim->mSolver->step(sim->mTime));
+			}
+		}
+
+		MnaSolver<Real>::stepBatch(realBatch);
+		for (UInt i = 0; i < realSimulations.size(); i++)
+			realSimulations[i]->finishStep(realBatch.nextTimes[i]);
+
+		MnaSolver<Complex>::stepBatch(complexBatch);
+		for (UInt i = 0; i < complexSimulations.size(); i++)
+			complexSimulations[i]->finishStep(complexBatch.nextTimes[i]);
+	}
+
+	for (auto sim : simulations)
+		sim->finish();
 }
@@ -0,0 +1,39 @@
+/** Step phase profiler
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <dpsim/StepProfiler.h>
+
+using namespace DPsim;
+
+const char * StepProfiler::phaseName(Phase phase) {
+	switch (phase) {
+		case Phase::InterfaceRead:  return "interface_read";
+		case Phase::Events:         return "events";
+		case Phase::PreStep:        return "pre_step";
+		case Phase::Solve:          return "solve";
+		case Phase::PostStep:       return "post_step";
+		case Phase::VoltageUpdate:  return "voltage_update";
+		case Phase::Logging:        return "logging";
+		case Phase::InterfaceWrite: return "interface_write";
+		case Phase::Total:          return "total";
+	}
+
+	return "unknown";
+}
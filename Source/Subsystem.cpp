@@ -0,0 +1,172 @@
+/** Subsystem of a multi-rate simulation
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cmath>
+#include <stdexcept>
+
+#include <dpsim/Subsystem.h>
+
+using namespace DPsim;
+using namespace CPS;
+
+template <typename From, typename To>
+void Subsystem::addInterpolatedInput(typename Attribute<From>::Ptr from,
+	typename Attribute<To>::Ptr to, std::function<To(From, Real)> convert) {
+	auto values = std::make_shared<Interpolation<From>>();
+
+	mSampleInputs.push_back([this, from, values]() {
+		From value = from->get();
+
+		values->previous = mStarted ? values->current : value;
+		values->current = value;
+	});
+
+	mApplyInputs.push_back([from, to, values, convert](Real fraction, Real time) {
+		From value = values->previous + (values->current - values->previous) * fraction;
+
+		to->set(convert(value, time));
+	});
+}
+
+template <typename T>
+void Subsystem::addAveragedOutput(typename Attribute<T>::Ptr from, typename Attribute<T>::Ptr to) {
+	auto average = std::make_shared<Average<T>>();
+	average->sum = T(0);
+	average->count = 0;
+
+	mAccumulateOutputs.push_back([from, average](Real time) {
+		average->sum += from->get();
+		average->count++;
+	});
+
+	mApplyOutputs.push_back([to, average]() {
+		if (average->count == 0)
+			return;
+
+		to->set(average->sum / (Real) average->count);
+		average->sum = T(0);
+		average->count = 0;
+	});
+}
+
+void Subsystem::addInput(Attribute<Real>::Ptr from, Attribute<Real>::Ptr to) {
+	addInterpolatedInput<Real, Real>(from, to, [](Real value, Real time) { return value; });
+}
+
+void Subsystem::addInput(Attribute<Complex>::Ptr from, Attribute<Complex>::Ptr to) {
+	addInterpolatedInput<Complex, Complex>(from, to, [](Complex value, Real time) { return value; });
+}
+
+void Subsystem::addInput(Attribute<Complex>::Ptr from, Attribute<Real>::Ptr to) {
+	addInterpolatedInput<Complex, Real>(from, to, [this](Complex value, Real time) {
+		return (value * std::polar(1.0, mOmega * time)).real();
+	});
+}
+
+void Subsystem::addOutput(Attribute<Real>::Ptr from, Attribute<Real>::Ptr to) {
+	addAveragedOutput<Real>(from, to);
+}
+
+void Subsystem::addOutput(Attribute<Complex>::Ptr from, Attribute<Complex>::Ptr to) {
+	addAveragedOutput<Complex>(from, to);
+}
+
+void Subsystem::addOutput(Attribute<Real>::Ptr from, Attribute<Complex>::Ptr to) {
+	// Ring buffer with the demodulated values of the last period
+	struct Demodulation {
+		std::vector<Complex> values;
+		Complex sum = 0;
+		UInt next = 0;
+		UInt count = 0;
+	};
+	auto demodulation = std::make_shared<Demodulation>();
+
+	mAccumulateOutputs.push_back([this, from, demodulation](Real time) {
+		auto &d = *demodulation;
+		if (d.values.empty())
+			d.values.resize(std::max<UInt>(1, (UInt) std::round(2 * M_PI / (mOmega * mTimeStep))));
+
+		Complex value = 2. * from->get() * std::polar(1.0, -mOmega * time);
+
+		d.sum += value - d.values[d.next];
+		d.values[d.next] = value;
+		d.next = (d.next + 1) % d.values.size();
+		d.count = std::min<UInt>(d.count + 1, d.values.size());
+	});
+
+	mApplyOutputs.push_back([to, demodulation]() {
+		if (demodulation->count > 0)
+			to->set(demodulation->sum / (Real) demodulation->count);
+	});
+}
+
+void Subsystem::setSolver(std::shared_ptr<Solver> solver, Real simulationTimeStep, Real omega) {
+	Real ratio = simulationTimeStep / mTimeStep;
+
+	mRatio = (UInt) std::round(ratio);
+	if (mRatio < 1 || std::abs(ratio - mRatio) > 1e-6 * ratio)
+		throw std::invalid_argument("Time step of subsystem " + mName
+			+ " does not divide the simulation time step");
+
+	mSolver = solver;
+	mOmega = omega;
+}
+
+void Subsystem::applyOutputs() {
+	for (auto &apply : mApplyOutputs)
+		apply();
+}
+
+void Subsystem::step(Real simulationTime) {
+	for (auto &sample : mSampleInputs)
+		sample();
+
+	// The first simulation step only provides the start values
+	if (!mStarted) {
+		mStarted = true;
+		mLastTime = simulationTime;
+		return;
+	}
+
+	// The simulation time step may have changed since the last step
+	Real ratio = (simulationTime - mLastTime) / mTimeStep;
+	if (std::abs(ratio - mRatio) > 1e-6 * ratio) {
+		mRatio = (UInt) std::round(ratio);
+		if (mRatio < 1 || std::abs(ratio - mRatio) > 1e-6 * ratio)
+			throw std::invalid_argument("Time step of subsystem " + mName
+				+ " does not divide the simulation time step");
+	}
+
+	Real start = mLastTime;
+	mLastTime = simulationTime;
+
+	for (UInt k = 1; k <= mRatio; k++) {
+		Real time = start + k * mTimeStep;
+
+		for (auto &apply : mApplyInputs)
+			apply((Real) k / mRatio, time);
+
+		mSolver->step(time);
+		mSolver->log(time);
+
+		for (auto &accumulate : mAccumulateOutputs)
+			accumulate(time);
+	}
+}
@@ -20,6 +20,8 @@
  *********************************************************************************/
 
 #include <assert.h>
+#include <algorithm>
+#include <cmath>
 #include <thread>
 
 #include <dpsim/Timer.h>
@@ -30,6 +32,10 @@
   #include <sys/timerfd.h>
 #endif /* HAVE_TIMERFD */
 
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+#endif
+
 using namespace DPsim;
 using CPS::SystemError;
 
@@ -37,7 +43,8 @@ Timer::Timer(int flags) :
 	mState(stopped),
 	mOverruns(0),
 	mTicks(0),
-	mFlags(flags) {
+	mFlags(flags),
+	mWakeMargin(std::chrono::microseconds(20)) {
 #ifdef HAVE_TIMERFD
 	mTimerFd = timerfd_create(CLOCK_MONOTONIC, 0);
 	if (mTimerFd < 0) {
@@ -57,27 +64,75 @@ Timer::~Timer() {
 #endif
 }
 
-void Timer::sleep() {
-	uint64_t ticks = 0, overruns;
+void Timer::updateWakeMargin(Ticks error) {
+	// Moving averages over about 16 wake-ups
+	Real err = (Real) error.count();
 
-#ifdef HAVE_TIMERFD
-	ssize_t bytes;
+	mWakeError += (err - mWakeError) / 16;
+	mWakeJitter += (std::abs(err - mWakeError) - mWakeJitter) / 16;
 
-	bytes = read(mTimerFd, &ticks, sizeof(ticks));
-	if (bytes < 0) {
-		throw SystemError("Read from timerfd failed");
-	}
-#else
-	std::this_thread::sleep_until(mNextTick);
+	Real margin = mWakeError + 4 * mWakeJitter + 1000;
+
+	mWakeMargin = std::min(Ticks((Ticks::rep) margin), mTickInterval);
+}
 
+uint64_t Timer::sleepHybrid() {
+	uint64_t ticks = 0;
+	auto wake = mNextTick - mWakeMargin;
 	auto now = IntervalClock::now();
 
-	while (mNextTick < now) {
+	if (now < wake) {
+		std::this_thread::sleep_until(wake);
+
+		now = IntervalClock::now();
+		updateWakeMargin(now - wake);
+	}
+
+	while (now < mNextTick) {
+#if defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#endif
+		now = IntervalClock::now();
+	}
+
+	while (mNextTick <= now) {
 		mNextTick += mTickInterval;
 		ticks++;
 	}
 
+	return ticks;
+}
+
+void Timer::sleep() {
+	uint64_t ticks = 0, overruns;
+
+	if (mMode == Mode::hybrid)
+		ticks = sleepHybrid();
+	else {
+#ifdef HAVE_TIMERFD
+		ssize_t bytes;
+
+		bytes = read(mTimerFd, &ticks, sizeof(ticks));
+		if (bytes < 0) {
+			throw SystemError("Read from timerfd failed");
+		}
+
+		mNextTick += ticks * mTickInterval;
+#else
+		std::this_thread::sleep_until(mNextTick);
+
+		auto now = IntervalClock::now();
+
+		while (mNextTick <= now) {
+			mNextTick += mTickInterval;
+			ticks++;
+		}
 #endif
+	}
+
+	// Delay after the most recent tick
+	mLateness.record(std::chrono::duration_cast<Ticks>(IntervalClock::now() - (mNextTick - mTickInterval)).count());
+
 	overruns = ticks - 1;
 
 	mOverruns += overruns;
@@ -95,6 +150,7 @@ void Timer::start() {
 
 	mTicks = 0;
 	mOverruns = 0;
+	mLateness.reset();
 
 	/* Determine offset between clocks */
 	auto rt     = StartClock::now();
@@ -109,18 +165,21 @@ void Timer::start() {
 			: steady.time_since_epoch();
 
 #ifdef HAVE_TIMERFD
-	int ret;
-	struct itimerspec ts = {
-		.it_interval = to_timespec(mTickInterval),
-		.it_value    = to_timespec(start)
-	};
-
-	ret = timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &ts, 0);
-	if (ret < 0) {
-		throw SystemError("Failed to arm timerfd");
+	if (mMode == Mode::sleep) {
+		int ret;
+		struct itimerspec ts = {
+			.it_interval = to_timespec(mTickInterval),
+			.it_value    = to_timespec(start)
+		};
+
+		ret = timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &ts, 0);
+		if (ret < 0) {
+			throw SystemError("Failed to arm timerfd");
+		}
 	}
 #endif
-	mNextTick = IntervalTimePoint(start) + mTickInterval;
+	// The first tick is at the start time, as for the timerfd
+	mNextTick = IntervalTimePoint(start);
 	mState = State::running;
 }
 
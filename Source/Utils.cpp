@@ -240,3 +240,14 @@ void DPsim::CommandLineArgs::showCopyright() {
 	std::cout << " Markus Mirz <MMirz@eonerc.rwth-aachen.de>" << std::endl;
 	std::cout << " Steffen Vogel <StVogel@eonerc.rwth-aachen.de>" << std::endl;
 }
+
+std::unordered_map<String, IdentifiedObject::Ptr> DPsim::objectsByName(const SystemTopology &system) {
+	std::unordered_map<String, IdentifiedObject::Ptr> objects;
+
+	for (auto node : system.mNodes)
+		objects[node->name()] = node;
+	for (auto comp : system.mComponents)
+		objects[comp->name()] = comp;
+
+	return objects;
+}
@@ -0,0 +1,160 @@
+/** Pool of worker threads
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <dpsim/WorkerPool.h>
+#include <cps/Definitions.h>
+
+#ifdef WITH_RT
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+using namespace DPsim;
+using CPS::SystemError;
+
+/// Number of polls before a waiting thread blocks
+static const UInt spinCount = 10000;
+
+WorkerPool::WorkerPool(UInt threads, const std::vector<Int>& cpus) :
+	mTask(nullptr),
+	mGeneration(0),
+	mFinished(0),
+	mStop(false),
+	mWaiting(0) {
+
+	mErrors.resize(threads);
+	mThreads.reserve(threads > 0 ? threads - 1 : 0);
+
+	// The threads started before a failure are stopped again
+	try {
+		for (UInt i = 1; i < threads; i++)
+			mThreads.emplace_back(&WorkerPool::work, this, i);
+
+		// The calling thread keeps its affinity, which is set by its owner,
+		// e.g. by the real-time settings of the simulation
+		if (cpus.size() > 0) {
+			for (UInt i = 1; i < threads; i++)
+				setAffinity(mThreads[i - 1].native_handle(), cpus[i % cpus.size()]);
+		}
+	}
+	catch (...) {
+		stop();
+		throw;
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	stop();
+}
+
+void WorkerPool::stop() {
+	mStop = true;
+	mGeneration++;
+	notify();
+
+	for (auto& thread : mThreads)
+		thread.join();
+	mThreads.clear();
+}
+
+void WorkerPool::setAffinity(std::thread::native_handle_type thread, Int cpu) {
+#ifdef WITH_RT
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0)
+		throw SystemError("Failed to set CPU affinity of worker thread");
+#endif
+}
+
+template <typename Predicate>
+void WorkerPool::wait(Predicate done) {
+	for (UInt spins = 0; spins < spinCount; spins++) {
+		if (done())
+			return;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWaiting++;
+	mCondition.wait(lock, done);
+	mWaiting--;
+}
+
+void WorkerPool::notify() {
+	// The waiting threads check their condition while holding the lock,
+	// so they are either blocked or see the change made before this call
+	if (mWaiting > 0) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mCondition.notify_all();
+	}
+}
+
+void WorkerPool::work(UInt index) {
+	UInt generation = 0;
+
+	while (true) {
+		wait([this, generation]() { return mGeneration != generation; });
+		generation++;
+
+		if (mStop)
+			return;
+
+		try {
+			(*mTask.load(std::memory_order_acquire))(index);
+		}
+		catch (...) {
+			mErrors[index] = std::current_exception();
+		}
+
+		if (++mFinished == mThreads.size())
+			notify();
+	}
+}
+
+void WorkerPool::run(const Task& task) {
+	if (mThreads.size() == 0) {
+		task(0);
+		return;
+	}
+
+	mFinished.store(0, std::memory_order_relaxed);
+	mTask.store(&task, std::memory_order_release);
+	mGeneration++;
+	notify();
+
+	try {
+		task(0);
+	}
+	catch (...) {
+		mErrors[0] = std::current_exception();
+	}
+
+	wait([this]() { return mFinished == mThreads.size(); });
+
+	for (auto& error : mErrors) {
+		if (error) {
+			auto rethrown = error;
+			for (auto& other : mErrors)
+				other = nullptr;
+			std::rethrow_exception(rethrown);
+		}
+	}
+}
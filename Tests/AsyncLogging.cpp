@@ -0,0 +1,117 @@
+/** Tests for the overflow policies of asynchronous data loggers
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <dpsim/DataLogger.h>
+#include <cps/Logger.h>
+
+using namespace DPsim;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const String &description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+struct Result {
+	UInt rows = 0;
+	UInt dropped = 0;
+	UInt decimated = 0;
+	/// The rows are in order and each row has the values logged with its time
+	Bool consistent = true;
+};
+
+/// Log count rows into a ring buffer of the given capacity as fast as
+/// possible, so that the writer thread falls behind
+static Result logRows(const String &name, DataLogger::OverflowPolicy policy, UInt capacity, UInt count) {
+	Result result;
+	{
+		DataLogger logger(name);
+		logger.setAsync(capacity, policy);
+		logger.setColumnNames({ "a", "b" });
+
+		Matrix values(2, 1);
+		for (UInt i = 0; i < count; i++) {
+			values << i, -(Real) i;
+			logger.logEMTNodeValues(i, values);
+		}
+		logger.flush();
+
+		result.dropped = logger.droppedSamples();
+		result.decimated = logger.decimatedSamples();
+	}
+
+	String filename = CPS::Logger::logDir() + "/" + name + ".csv";
+	std::ifstream file(filename);
+	String line;
+	std::getline(file, line);
+
+	Real previous = -1;
+	while (std::getline(file, line)) {
+		std::stringstream ss(line);
+		Real time, a, b;
+		char sep;
+		if (!(ss >> time >> sep >> a >> sep >> b) || time <= previous || a != time || b != -time)
+			result.consistent = false;
+
+		previous = time;
+		result.rows++;
+	}
+
+	file.close();
+	std::remove(filename.c_str());
+
+	return result;
+}
+
+int main(int argc, char *argv[]) {
+	const UInt count = 200000;
+	// Each row of the blocking logger may wait for the writer
+	const UInt blockCount = 10000;
+
+	auto block = logRows("AsyncLogging_Block", DataLogger::OverflowPolicy::Block, 4, blockCount);
+	expect(block.rows == blockCount && block.dropped == 0 && block.decimated == 0,
+		"blocking logger writes all rows");
+	expect(block.consistent, "blocking logger writes consistent rows");
+
+	auto drop = logRows("AsyncLogging_Drop", DataLogger::OverflowPolicy::Drop, 4, count);
+	std::cout << "Drop: " << drop.rows << " rows, " << drop.dropped << " dropped" << std::endl;
+	expect(drop.rows + drop.dropped == count && drop.decimated == 0,
+		"dropping logger accounts for all rows");
+	expect(drop.dropped > 0, "dropping logger overflows");
+	expect(drop.consistent, "dropping logger writes consistent rows");
+
+	auto decimate = logRows("AsyncLogging_Decimate", DataLogger::OverflowPolicy::Decimate, 4, count);
+	std::cout << "Decimate: " << decimate.rows << " rows, " << decimate.dropped << " dropped, "
+		<< decimate.decimated << " decimated" << std::endl;
+	expect(decimate.rows + decimate.dropped + decimate.decimated == count,
+		"decimating logger accounts for all rows");
+	expect(decimate.dropped > 0 && decimate.decimated > 0, "decimating logger overflows and decimates");
+	expect(decimate.consistent, "decimating logger writes consistent rows");
+
+	return failed ? 1 : 0;
+}
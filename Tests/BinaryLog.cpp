@@ -0,0 +1,64 @@
+/** Tests for binary data logs read by the Python module
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+
+#include <dpsim/DataLogger.h>
+#include <cps/Logger.h>
+
+using namespace DPsim;
+
+static const UInt rows = 10;
+
+/// Write rows of two node values in chunks of three rows, so that the
+/// file contains runs of full chunks and a shorter last chunk
+static String writeLog(const String &name, UInt precision) {
+	DataLogger logger(name, true, DataLogger::Format::Binary, precision, 3);
+	logger.setUnit("node00001", "V");
+
+	Matrix values(2, 1);
+	for (UInt i = 0; i < rows; i++) {
+		values << i, 0.1 * i - 2.5;
+		logger.logEMTNodeValues(i * 1e-3, values);
+	}
+	logger.flush();
+
+	return CPS::Logger::logDir() + "/" + name + ".dpsim";
+}
+
+int main(int argc, char *argv[]) {
+	String f64 = writeLog("BinaryLog_f64", 8);
+	String f32 = writeLog("BinaryLog_f32", 4);
+
+	// The Python script reads both files with dpsim.read_binary_log()
+	// and compares them to the written values
+	String cmd = String(PYTHON_EXECUTABLE) + " " + BINARY_LOG_SCRIPT + " " + BINARY_LOG_MODULE_DIR
+		+ " " + std::to_string(rows) + " " + f64 + " " + f32;
+
+	std::cout << cmd << std::endl;
+
+	if (std::system(cmd.c_str()) != 0) {
+		std::cerr << "Binary logs differ from the written values" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+/** Tests for simulation checkpoints
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cstdio>
+
+#include <DPsim.h>
+
+using namespace DPsim;
+using namespace CPS::DP;
+using namespace CPS::DP::Ph1;
+
+static const Real timeStep = 0.0001;
+static const UInt steps = 200;
+
+/// RLC circuit whose inductor and capacitor keep a state across the checkpoint
+static SystemTopology createSystem() {
+	auto n1 = Node::make("n1");
+	auto n2 = Node::make("n2");
+	auto n3 = Node::make("n3");
+
+	auto vs = VoltageSource::make("vs");
+	vs->setParameters(Complex(10, 0));
+	vs->connect(Node::List{ Node::GND, n1 });
+
+	auto r1 = Resistor::make("r_1");
+	r1->setParameters(5);
+	r1->connect(Node::List{ n1, n2 });
+
+	auto l1 = Inductor::make("l_1");
+	l1->setParameters(0.02);
+	l1->connect(Node::List{ n2, n3 });
+
+	auto c1 = Capacitor::make("c_1");
+	c1->setParameters(0.001);
+	c1->connect(Node::List{ n3, Node::GND });
+
+	return SystemTopology(50, SystemNodeList{n1, n2, n3}, SystemComponentList{vs, r1, l1, c1});
+}
+
+static Complex inductorCurrent(SystemTopology& sys) {
+	return sys.component<Inductor>("l_1")->attribute<MatrixComp>("i_intf")->get()(0, 0);
+}
+
+int main(int argc, char *argv[]) {
+	String filename = "Checkpoint_Test.bin";
+
+	auto continuousSystem = createSystem();
+	Simulation continuous("Checkpoint_Continuous", continuousSystem, timeStep, steps * timeStep,
+		Domain::DP, Solver::Type::MNA, Logger::Level::NONE);
+
+	for (UInt i = 0; i < steps / 2; i++)
+		continuous.step();
+	continuous.saveCheckpoint(filename);
+	for (UInt i = steps / 2; i < steps; i++)
+		continuous.step();
+
+	auto resumedSystem = createSystem();
+	Simulation resumed("Checkpoint_Resumed", resumedSystem, timeStep, steps * timeStep,
+		Domain::DP, Solver::Type::MNA, Logger::Level::NONE);
+
+	resumed.loadCheckpoint(filename);
+	for (UInt i = steps / 2; i < steps; i++)
+		resumed.step();
+
+	std::remove(filename.c_str());
+
+	Complex expected = inductorCurrent(continuousSystem);
+	Complex actual = inductorCurrent(resumedSystem);
+
+	std::cout << "Inductor current of the continuous run: " << expected << std::endl;
+	std::cout << "Inductor current of the resumed run: " << actual << std::endl;
+
+	if (std::abs(actual - expected) > 1e-9 * std::abs(expected)) {
+		std::cerr << "Resumed run differs from the continuous run" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+/** Tests for the Jacobian of DAE systems
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <dpsim/DAEJacobian.h>
+
+using namespace DPsim;
+using namespace CPS;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+/// Nonlinear residual whose Jacobian is computed by finite differences
+static void nonlinearResidual(Real time, const Real state[], const Real dstate_dt[], Real resid[], std::vector<int>& off) {
+	resid[off[0]++] += state[0] * state[2] + 3 * dstate_dt[1] - std::sin(state[3]);
+	resid[off[0]++] += state[4] * state[4] - dstate_dt[4];
+}
+
+/// Residual with an analytic Jacobian
+class AnalyticComponent : public DAEJacobianInterface {
+public:
+	static void residual(Real time, const Real state[], const Real dstate_dt[], Real resid[], std::vector<int>& off) {
+		resid[off[0]++] += state[1] * std::exp(state[2]) + 2 * dstate_dt[3];
+		resid[off[0]++] += state[0] - state[4] + dstate_dt[2] * state[1];
+	}
+
+	void daeJacobian(Real time, const Real state[], const Real dstate_dt[],
+		Real cj, DAEJacobian& jacobian, std::vector<int>& off) {
+		Int row = off[0]++;
+		jacobian.add(row, 1, std::exp(state[2]));
+		jacobian.add(row, 2, state[1] * std::exp(state[2]));
+		jacobian.add(row, 3, 2 * cj);
+
+		row = off[0]++;
+		jacobian.add(row, 0, 1);
+		jacobian.add(row, 1, dstate_dt[2]);
+		jacobian.add(row, 2, cj * state[1]);
+		jacobian.add(row, 4, -1);
+	}
+};
+
+/// Residual with an analytic Jacobian whose entries depend on the state,
+/// so some of them vanish at the state used to record the pattern
+class SwitchingComponent : public DAEJacobianInterface {
+public:
+	static void residual(Real time, const Real state[], const Real dstate_dt[], Real resid[], std::vector<int>& off) {
+		resid[off[0]++] += 2 * state[5] + (state[3] > 10 ? state[0] * state[3] : 0);
+	}
+
+	void daeJacobian(Real time, const Real state[], const Real dstate_dt[],
+		Real cj, DAEJacobian& jacobian, std::vector<int>& off) {
+		Int row = off[0]++;
+		jacobian.add(row, 5, 2);
+		if (state[3] > 10) {
+			jacobian.add(row, 0, state[3]);
+			jacobian.add(row, 3, state[0]);
+		}
+	}
+};
+
+/// Residual of the whole system, the first row is a node voltage y_0 - v_0
+static void systemResidual(const std::vector<Real>& state, const std::vector<Real>& dstate_dt, std::vector<Real>& resid) {
+	std::fill(resid.begin(), resid.end(), 0);
+	resid[0] = state[0];
+
+	std::vector<int> off = { 1 };
+	nonlinearResidual(0, state.data(), dstate_dt.data(), resid.data(), off);
+	AnalyticComponent::residual(0, state.data(), dstate_dt.data(), resid.data(), off);
+	SwitchingComponent::residual(0, state.data(), dstate_dt.data(), resid.data(), off);
+}
+
+/// Jacobian of the whole system by central differences
+static Matrix referenceJacobian(std::vector<Real> state, std::vector<Real> dstate_dt, Real cj) {
+	const Real step = 1e-6;
+	Int size = (Int) state.size();
+	Matrix jacobian = Matrix::Zero(size, size);
+	std::vector<Real> plus(size), minus(size);
+
+	for (Int col = 0; col < size; col++) {
+		for (auto variables : { &state, &dstate_dt }) {
+			Real saved = (*variables)[col];
+			(*variables)[col] = saved + step;
+			systemResidual(state, dstate_dt, plus);
+			(*variables)[col] = saved - step;
+			systemResidual(state, dstate_dt, minus);
+			(*variables)[col] = saved;
+
+			Real scale = variables == &state ? 1 : cj;
+			for (Int row = 0; row < size; row++)
+				jacobian(row, col) += scale * (plus[row] - minus[row]) / (2 * step);
+		}
+	}
+
+	return jacobian;
+}
+
+static Real relativeError(const DAEJacobian& jacobian, const Matrix& reference) {
+	return (Matrix(jacobian.matrix()) - reference).cwiseAbs().maxCoeff() / reference.cwiseAbs().maxCoeff();
+}
+
+int main(int argc, char *argv[]) {
+	const Int size = 6;
+	const Real cj = 2e3;
+
+	DAEJacobian jacobian(size, 1);
+	jacobian.addComponent(nonlinearResidual);
+	jacobian.addComponent(AnalyticComponent::residual, std::make_shared<AnalyticComponent>());
+	jacobian.addComponent(SwitchingComponent::residual, std::make_shared<SwitchingComponent>());
+	jacobian.analyzePattern({ 1 });
+
+	// The unit row, the five columns of the finite differences in both
+	// of their rows, seven analytic entries and one of the switching component
+	expect(jacobian.nonZeros() == 1 + 2 * 5 + 7 + 1, "pattern has the entries the residual depends on");
+
+	std::vector<Real> state = { 0.3, -1.2, 0.7, 2.5, 1.1, -0.4 };
+	std::vector<Real> dstate_dt = { 0.1, 0.2, -0.6, 1.5, -2.0, 0.8 };
+	jacobian.compute(0, state.data(), dstate_dt.data(), cj);
+
+	Matrix reference = referenceJacobian(state, dstate_dt, cj);
+	expect(relativeError(jacobian, reference) < 1e-6, "Jacobian matches finite differences of the system");
+
+	Bool zeros = true;
+	for (Int row = 0; row < size; row++) {
+		for (Int col = 0; col < size; col++) {
+			if (reference(row, col) != 0 && jacobian.matrix().coeff(row, col) == 0)
+				zeros = false;
+		}
+	}
+	expect(zeros, "pattern contains all nonzero entries");
+
+	// Entries which vanished while recording the pattern extend it
+	state[3] = 20;
+	jacobian.compute(0, state.data(), dstate_dt.data(), cj);
+	reference = referenceJacobian(state, dstate_dt, cj);
+	expect(jacobian.nonZeros() == 1 + 2 * 5 + 7 + 3, "missing entries extend the pattern");
+	expect(relativeError(jacobian, reference) < 1e-6, "Jacobian with extended pattern matches finite differences");
+
+	// Entries outside of the matrix are rejected
+	Bool rejected = false;
+	try {
+		jacobian.add(size, 0, 1);
+	} catch (SolverException &) {
+		rejected = true;
+	}
+	expect(rejected, "entry outside of the matrix is rejected");
+
+	return failed ? 1 : 0;
+}
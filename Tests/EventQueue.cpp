@@ -0,0 +1,172 @@
+/** Tests for the event queue
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <dpsim/Event.h>
+
+using namespace DPsim;
+
+/// Time of the current step and the executed events in their order
+static Real currentTime;
+static std::vector<std::pair<Real, Int>> executed;
+
+/// Event which records its execution
+class RecordingEvent : public Event {
+protected:
+	Int mId;
+
+public:
+	RecordingEvent(Real time, Int id) : Event(time), mId(id) { }
+
+	void execute() {
+		executed.push_back({ currentTime, mId });
+	}
+};
+
+static Bool failed = false;
+
+static void expect(Bool condition, const String &description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+/// Step from the first to the last step time and dispatch the due events
+static void run(EventQueue &queue, UInt first, UInt last) {
+	for (UInt step = first; step <= last; step++) {
+		currentTime = step * queue.timeStep();
+		queue.handleEvents(currentTime);
+	}
+}
+
+/// Every event must be executed at the first step which is not before its time
+static void expectOnTime(const std::vector<Real> &times, Real timeStep, const String &description) {
+	for (auto &e : executed) {
+		Real time = times[e.second];
+
+		if (e.first < time - 1e-9 || e.first - timeStep >= time - 1e-9) {
+			std::cerr << "Event at " << time << " executed at " << e.first << std::endl;
+			expect(false, description);
+			return;
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const Real timeStep = 1e-3;
+
+	// Random events, many more than buckets, which forces the calendar to grow
+	{
+		EventQueue queue(timeStep, 4);
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<Real> distribution(0, 1);
+		std::vector<Real> times;
+
+		for (Int id = 0; id < 2000; id++) {
+			times.push_back(distribution(rng));
+			queue.addEvent(std::make_shared<RecordingEvent>(times.back(), id));
+		}
+
+		// Events with the same time keep the order in which they are added
+		std::vector<Event::Ptr> simultaneous;
+		for (Int id = 2000; id < 2010; id++) {
+			times.push_back(0.5);
+			simultaneous.push_back(std::make_shared<RecordingEvent>(0.5, id));
+		}
+		queue.addEvents(simultaneous);
+
+		executed.clear();
+		run(queue, 0, 1000);
+
+		expect(executed.size() == times.size() && queue.size() == 0, "all random events are executed");
+		expectOnTime(times, timeStep, "random events are executed at their step");
+
+		for (std::size_t i = 1; i < executed.size(); i++) {
+			Real previous = times[executed[i - 1].second], next = times[executed[i].second];
+
+			if (previous > next || (previous == next && executed[i - 1].second > executed[i].second)) {
+				expect(false, "events are executed in the order of their time and addition");
+				break;
+			}
+		}
+	}
+
+	// Events which are due at a step which is not dispatched are executed with the next one
+	{
+		EventQueue queue(timeStep, 4);
+		std::vector<Real> times = { 0.0101, 0.0202, 0.5 };
+
+		for (Int id = 0; id < (Int) times.size(); id++)
+			queue.addEvent(std::make_shared<RecordingEvent>(times[id], id));
+
+		executed.clear();
+		currentTime = 0.03;
+		queue.handleEvents(currentTime);
+
+		expect(executed.size() == 2 && executed[0].second == 0 && executed[1].second == 1,
+			"events of skipped steps are executed in order");
+		expect(queue.nextStepTime(1) == 0.5, "next step with events");
+	}
+
+	// Skipped events are discarded without being executed
+	{
+		EventQueue queue(timeStep, 4);
+		std::vector<Real> times;
+
+		for (Int id = 0; id < 100; id++) {
+			times.push_back(id * 1e-2);
+			queue.addEvent(std::make_shared<RecordingEvent>(times.back(), id));
+		}
+
+		executed.clear();
+		queue.skip(0.5);
+		expect(queue.size() == 50, "events before the skipped time are discarded");
+
+		run(queue, 500, 1000);
+		expect(executed.size() == 50 && executed.front().second == 50, "events after the skipped time are executed");
+		expectOnTime(times, timeStep, "events after the skipped time are executed at their step");
+	}
+
+	// Changing the time step maps the queued events to the new steps
+	{
+		EventQueue queue(timeStep, 4);
+		std::vector<Real> times = { 0.0025, 0.0105, 0.0111, 0.02 };
+
+		for (Int id = 0; id < (Int) times.size(); id++)
+			queue.addEvent(std::make_shared<RecordingEvent>(times[id], id));
+
+		executed.clear();
+		run(queue, 0, 4);
+		expect(executed.size() == 1 && executed[0].first == 0.003, "event before the change is executed");
+
+		executed.clear();
+		queue.setTimeStep(2 * timeStep);
+		run(queue, 3, 10);
+
+		expect(executed.size() == 3, "all events after the change are executed");
+		expectOnTime(times, 2 * timeStep, "events are executed at the steps of the new time step");
+	}
+
+	return failed ? 1 : 0;
+}
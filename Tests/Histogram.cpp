@@ -0,0 +1,99 @@
+/** Tests for latency histograms
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <dpsim/Histogram.h>
+
+using namespace DPsim;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	Histogram empty;
+	expect(empty.count() == 0 && empty.min() == 0 && empty.max() == 0 && empty.mean() == 0, "empty statistics are zero");
+	expect(empty.percentile(0.5) == 0, "empty percentile is zero");
+
+	// Small values have buckets of their own and are exact
+	Histogram small;
+	for (uint64_t v = 1; v <= 50; v++)
+		small.record(v);
+	expect(small.percentile(0.5) == 25, "median of small values is exact");
+	expect(small.percentile(0.9) == 45, "90th percentile of small values is exact");
+	expect(small.percentile(0) == 1 && small.percentile(1) == 50, "extreme percentiles are the minimum and maximum");
+
+	// Every value lies within the bounds of its bucket
+	for (uint64_t v = 0; v < (1ULL << Histogram::maxExponent); v = v * 5 / 4 + 1) {
+		UInt b = Histogram::bucket(v);
+		if (Histogram::lowerBound(b) > v || (b + 1 < Histogram::numBuckets && Histogram::lowerBound(b + 1) <= v)) {
+			std::cerr << "Value " << v << " is outside of bucket " << b << std::endl;
+			failed = true;
+		}
+	}
+
+	// Percentiles of a wide distribution are within the resolution of the buckets
+	Histogram latencies;
+	std::vector<uint64_t> values;
+	std::mt19937_64 rng(1);
+	std::lognormal_distribution<Real> distribution(10, 1.5);
+
+	for (UInt i = 0; i < 100000; i++) {
+		uint64_t v = (uint64_t) distribution(rng);
+		values.push_back(v);
+		latencies.record(v);
+	}
+	std::sort(values.begin(), values.end());
+
+	expect(latencies.count() == values.size(), "all values are counted");
+	expect(latencies.min() == values.front() && latencies.max() == values.back(), "minimum and maximum are exact");
+
+	Real sum = 0;
+	for (auto v : values)
+		sum += v;
+	expect(std::abs(latencies.mean() - sum / values.size()) < 1e-6 * latencies.mean(), "mean is exact");
+
+	for (Real fraction : { 0.1, 0.5, 0.9, 0.99, 0.999 }) {
+		uint64_t exact = values[(std::size_t) std::ceil(fraction * values.size()) - 1];
+		uint64_t estimate = latencies.percentile(fraction);
+		Real error = std::abs((Real) estimate / exact - 1);
+
+		std::cout << "Percentile " << fraction << ": " << estimate << " (exact " << exact << ", error " << error << ")" << std::endl;
+
+		if (error > 1.0 / Histogram::subBuckets) {
+			std::cerr << "Percentile " << fraction << " exceeds the relative error of the buckets" << std::endl;
+			failed = true;
+		}
+	}
+
+	latencies.reset();
+	expect(latencies.count() == 0 && latencies.percentile(0.5) == 0, "reset clears all values");
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+/** Tests for the least recently used cache
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <iostream>
+
+#include <dpsim/LRUCache.h>
+
+using namespace DPsim;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	// Limit on the number of entries
+	LRUCache<Int, String> cache(3, 0);
+
+	cache.put(1, "a", 1);
+	cache.put(2, "b", 1);
+	cache.put(3, "c", 1);
+	expect(cache.get(1) && *cache.get(1) == "a", "entry 1 is cached");
+
+	cache.put(4, "d", 1);
+	expect(cache.entries() == 3, "number of entries is limited");
+	expect(!cache.get(2), "least recently used entry 2 is evicted");
+	expect(cache.get(1) && cache.get(3) && cache.get(4), "recently used entries are kept");
+	expect(cache.evictions() == 1, "one eviction");
+
+	// Replacing a value makes it the most recently used one
+	cache.put(3, "e", 1);
+	cache.put(5, "f", 1);
+	expect(!cache.get(1), "entry 1 is evicted after the replacement of entry 3");
+	expect(cache.get(3) && *cache.get(3) == "e", "entry 3 holds the replaced value");
+	expect(cache.entries() == 3 && cache.size() == 3, "replacement does not add an entry");
+
+	// Limit on the accumulated size
+	LRUCache<Int, Int> sized(0, 10);
+
+	sized.put(1, 1, 4);
+	sized.put(2, 2, 4);
+	sized.get(1);
+	sized.put(3, 3, 4);
+	expect(sized.size() == 8 && sized.entries() == 2, "size is limited");
+	expect(!sized.get(2) && sized.get(1) && sized.get(3), "least recently used entry 2 is evicted by size");
+
+	// An entry larger than the limit is kept as the most recently used one
+	sized.put(4, 4, 20);
+	expect(sized.entries() == 1 && sized.size() == 20, "oversized entry replaces all others");
+	expect(sized.get(4) && *sized.get(4) == 4, "oversized entry is cached");
+
+	// Lowering the limits evicts immediately
+	cache.setLimits(1, 0);
+	expect(cache.entries() == 1 && cache.get(3), "lower limit keeps the most recently used entry");
+
+	cache.clear();
+	expect(cache.entries() == 0 && cache.size() == 0 && !cache.get(3), "clear removes all entries");
+
+	// Statistics
+	LRUCache<Int, Int> counted;
+	counted.get(1);
+	counted.put(1, 1, 1);
+	counted.get(1);
+	counted.get(1);
+	expect(counted.hits() == 2 && counted.misses() == 1, "hits and misses are counted");
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/** Tests for batched solves of LU factorizations
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <iostream>
+#include <random>
+
+#include <dpsim/LUFactorization.h>
+
+using namespace DPsim;
+
+/// Grid of random conductances with a small shunt at each node
+static SparseMatrix createGrid(Int n, UInt seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<Real> conductance(0.5, 2);
+	std::vector<Eigen::Triplet<Real>> entries;
+	std::vector<Real> diagonal(n * n, 0.1);
+
+	for (Int i = 0; i < n * n; i++) {
+		for (Int j : { i + 1, i + n }) {
+			if (j >= n * n || (j == i + 1 && j % n == 0))
+				continue;
+
+			Real g = conductance(rng);
+			entries.emplace_back(i, j, -g);
+			entries.emplace_back(j, i, -g);
+			diagonal[i] += g;
+			diagonal[j] += g;
+		}
+		entries.emplace_back(i, i, diagonal[i]);
+	}
+
+	SparseMatrix mat(n * n, n * n);
+	mat.setFromTriplets(entries.begin(), entries.end());
+
+	return mat;
+}
+
+/// Largest error of the columns of a batch relative to the dense solution
+static Real batchError(const LUFactorization& lu, const Matrix& dense, const BatchMatrix& rhs) {
+	BatchMatrix lhs;
+	lu.solveBatch(rhs, lhs);
+
+	Matrix expected = dense.partialPivLu().solve(Matrix(rhs));
+
+	return (Matrix(lhs) - expected).cwiseAbs().maxCoeff() / expected.cwiseAbs().maxCoeff();
+}
+
+int main(int argc, char *argv[]) {
+	SparseMatrix mat = createGrid(12, 1);
+	Matrix dense = mat;
+
+	// Make the matrix unsymmetric, so transposed factors would be noticed
+	dense(0, 1) -= 0.3;
+	mat.coeffRef(0, 1) -= 0.3;
+
+	SparseOrdering ordering;
+	LUFactorization::computeOrdering(mat, ordering);
+
+	LUFactorization sparse(mat, ordering);
+	LUFactorization denseLu(dense);
+
+	Bool failed = false;
+
+	for (Int systems : { 1, 3, 8 }) {
+		BatchMatrix rhs = BatchMatrix::Random(mat.rows(), systems);
+
+		Real sparseError = batchError(sparse, dense, rhs);
+		Real denseError = batchError(denseLu, dense, rhs);
+
+		std::cout << systems << " systems: error of the sparse factorization " << sparseError
+			<< ", of the dense factorization " << denseError << std::endl;
+
+		if (sparseError > 1e-10 || denseError > 1e-10)
+			failed = true;
+	}
+
+	// The columns of a batch must match single solves
+	BatchMatrix rhs = BatchMatrix::Random(mat.rows(), 4);
+	BatchMatrix lhs;
+	sparse.solveBatch(rhs, lhs);
+
+	for (Int col = 0; col < rhs.cols(); col++) {
+		Matrix single = sparse.solve(Matrix(rhs.col(col)));
+
+		if ((single - Matrix(lhs.col(col))).cwiseAbs().maxCoeff() > 1e-12) {
+			std::cerr << "Column " << col << " of the batch differs from a single solve" << std::endl;
+			failed = true;
+		}
+	}
+
+	if (failed) {
+		std::cerr << "Batched solves differ from the reference solution" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
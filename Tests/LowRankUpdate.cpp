@@ -0,0 +1,130 @@
+/** Tests for low-rank updates of LU factorizations
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <iostream>
+#include <random>
+
+#include <dpsim/LowRankUpdate.h>
+
+using namespace DPsim;
+
+/// Grid of random conductances with a small shunt at each node
+static SparseMatrix createGrid(Int n, UInt seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<Real> conductance(0.5, 2);
+	std::vector<Eigen::Triplet<Real>> entries;
+	std::vector<Real> diagonal(n * n, 0.1);
+
+	for (Int i = 0; i < n * n; i++) {
+		for (Int j : { i + 1, i + n }) {
+			if (j >= n * n || (j == i + 1 && j % n == 0))
+				continue;
+
+			Real g = conductance(rng);
+			entries.emplace_back(i, j, -g);
+			entries.emplace_back(j, i, -g);
+			diagonal[i] += g;
+			diagonal[j] += g;
+		}
+		entries.emplace_back(i, i, diagonal[i]);
+	}
+
+	SparseMatrix mat(n * n, n * n);
+	mat.setFromTriplets(entries.begin(), entries.end());
+
+	return mat;
+}
+
+/// Stamp of a conductance between two nodes
+static void addConductance(std::vector<Eigen::Triplet<Real>>& entries, Int i, Int j, Real g) {
+	entries.emplace_back(i, i, g);
+	entries.emplace_back(j, j, g);
+	entries.emplace_back(i, j, -g);
+	entries.emplace_back(j, i, -g);
+}
+
+/// Compare the solution of the updated base factorization with a refactorization of the corrected matrix
+static Bool check(const char *name, LowRankUpdate& update, const SparseMatrix& base,
+	const std::vector<Eigen::Triplet<Real>>& entries, UInt rank) {
+
+	SparseMatrix correction(base.rows(), base.cols());
+	correction.setFromTriplets(entries.begin(), entries.end());
+
+	update.update(correction);
+
+	SparseMatrix corrected = base + correction;
+	SparseOrdering ordering;
+	LUFactorization::computeOrdering(corrected, ordering);
+	LUFactorization refactorized(corrected, ordering);
+
+	Matrix rhs = Matrix::Random(base.rows(), 1);
+	Matrix expected = refactorized.solve(rhs);
+	Matrix actual;
+	update.solve(rhs, actual);
+
+	Real error = (actual - expected).cwiseAbs().maxCoeff() / expected.cwiseAbs().maxCoeff();
+
+	std::cout << name << ": rank " << update.rank() << ", error " << error << std::endl;
+
+	if (update.rank() != rank || LowRankUpdate::rank(correction) != rank) {
+		std::cerr << name << ": expected rank " << rank << std::endl;
+		return false;
+	}
+	if (error > 1e-10) {
+		std::cerr << name << ": solution differs from the refactorization" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	SparseMatrix base = createGrid(10, 2);
+
+	SparseOrdering ordering;
+	LUFactorization::computeOrdering(base, ordering);
+	auto lu = std::make_shared<LUFactorization>(base, ordering);
+
+	LowRankUpdate update(lu);
+	Bool passed = true;
+
+	// Closing a switch between two distant nodes
+	std::vector<Eigen::Triplet<Real>> entries;
+	addConductance(entries, 3, 87, 1e3);
+	passed &= check("Closed switch", update, base, entries, 2);
+
+	// Several switches and a fault to ground, replacing the previous correction
+	entries.clear();
+	addConductance(entries, 3, 87, 1e3);
+	addConductance(entries, 40, 41, 1e-2);
+	entries.emplace_back(55, 55, 1e6);
+	passed &= check("Switches and fault", update, base, entries, 5);
+
+	// Removing a branch of the base matrix, whose off-diagonal entry is the negative conductance
+	entries.clear();
+	addConductance(entries, 12, 13, base.coeff(13, 12));
+	passed &= check("Removed branch", update, base, entries, 2);
+
+	// A zero correction falls back to the base factorization
+	entries.clear();
+	passed &= check("Zero correction", update, base, entries, 0);
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/** Tests for the ODE solver against analytic solutions
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <DPsim.h>
+#include <dpsim/ODESolver.h>
+
+using namespace DPsim;
+using namespace CPS;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+/// Exponential decay dy/dt = -a y and harmonic oscillator d^2x/dt^2 = -w^2 x
+class DecayOscillator : public Component, public ODEInterface {
+public:
+	using Ptr = std::shared_ptr<DecayOscillator>;
+
+	const Real decay = 50;
+	const Real omega = 2 * PI * 50;
+
+	/// Decaying value, position and velocity of the oscillator
+	Real state[3] = { 1, 1, 0 };
+
+	DecayOscillator(String name) : Component(name) { }
+
+	UInt odeStates() { return 3; }
+
+	void odePreStep(Real s[]) {
+		std::copy(state, state + 3, s);
+	}
+
+	void odeStateSpace(Real time, const Real s[], Real dstate_dt[]) {
+		dstate_dt[0] = -decay * s[0];
+		dstate_dt[1] = s[2];
+		dstate_dt[2] = -omega * omega * s[1];
+	}
+
+	void odePostStep(Real time, const Real s[]) {
+		std::copy(s, s + 3, state);
+	}
+
+	Bool odeHasJacobian() { return true; }
+
+	void odeJacobian(Real time, const Real s[], Real jacobian[], Int stride) {
+		jacobian[0 * stride + 0] = -decay;
+		jacobian[2 * stride + 1] = 1;
+		jacobian[1 * stride + 2] = -omega * omega;
+	}
+};
+
+/// Largest error relative to the analytic solution after several steps,
+/// with the decaying value doubled by an event halfway through
+static Real solve(Bool implicit, Real timeStep, UInt steps) {
+	auto comp = std::make_shared<DecayOscillator>("comp");
+	SystemTopology system(50, SystemNodeList{}, SystemComponentList{comp});
+
+	ODESolver solver("ODESolver", system, timeStep, 0, implicit);
+
+	Real error = 0;
+	for (UInt n = 0; n < steps; n++) {
+		// Changed states are taken at the beginning of the next step
+		if (n == steps / 2)
+			comp->state[0] *= 2;
+
+		Real time = solver.step(n * timeStep);
+
+		Real scale = n >= steps / 2 ? 2 : 1;
+		Real decay = scale * std::exp(-comp->decay * time);
+		Real position = std::cos(comp->omega * time);
+		Real velocity = -comp->omega * std::sin(comp->omega * time);
+
+		error = std::max(error, std::abs(comp->state[0] - decay) / scale);
+		error = std::max(error, std::abs(comp->state[1] - position));
+		error = std::max(error, std::abs(comp->state[2] - velocity) / comp->omega);
+	}
+
+	return error;
+}
+
+int main(int argc, char *argv[]) {
+	const Real timeStep = 1e-4;
+	const UInt steps = 1000;
+
+	expect(solve(false, timeStep, steps) < 1e-4, "explicit method follows the analytic solution");
+	expect(solve(true, timeStep, steps) < 1e-4, "implicit method follows the analytic solution");
+
+	// Each step is integrated up to its end, also if it is longer
+	// than the steps the integrator takes internally
+	expect(solve(true, 10 * timeStep, steps / 10) < 1e-4, "implicit method follows the analytic solution with long steps");
+
+	return failed ? 1 : 0;
+}
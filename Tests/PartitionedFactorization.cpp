@@ -0,0 +1,124 @@
+/** Tests for partitioned factorizations
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <iostream>
+#include <random>
+
+#include <dpsim/PartitionedFactorization.h>
+
+using namespace DPsim;
+
+/// Grid of random conductances with a small shunt at each node
+static SparseMatrix createGrid(Int n, UInt seed) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<Real> conductance(0.5, 2);
+	std::vector<Eigen::Triplet<Real>> entries;
+	std::vector<Real> diagonal(n * n, 0.1);
+
+	for (Int i = 0; i < n * n; i++) {
+		for (Int j : { i + 1, i + n }) {
+			if (j >= n * n || (j == i + 1 && j % n == 0))
+				continue;
+
+			Real g = conductance(rng);
+			entries.emplace_back(i, j, -g);
+			entries.emplace_back(j, i, -g);
+			diagonal[i] += g;
+			diagonal[j] += g;
+		}
+		entries.emplace_back(i, i, diagonal[i]);
+	}
+
+	SparseMatrix mat(n * n, n * n);
+	mat.setFromTriplets(entries.begin(), entries.end());
+
+	return mat;
+}
+
+static Bool failed = false;
+
+/// Compare single and batched solves of the partitioned factorization with the monolithic one
+static void check(const String &name, const PartitionedFactorization &partitioned, const LUFactorization &monolithic) {
+	Matrix rhs = Matrix::Random(monolithic.rows(), 1);
+	Matrix expected = monolithic.solve(rhs);
+	Matrix actual;
+	partitioned.solve(rhs, actual);
+
+	BatchMatrix batchRhs = BatchMatrix::Random(monolithic.rows(), 3);
+	BatchMatrix batchExpected, batchActual;
+	monolithic.solveBatch(batchRhs, batchExpected);
+	partitioned.solveBatch(batchRhs, batchActual);
+
+	Real error = (actual - expected).cwiseAbs().maxCoeff() / expected.cwiseAbs().maxCoeff();
+	Real batchError = (batchActual - batchExpected).cwiseAbs().maxCoeff() / batchExpected.cwiseAbs().maxCoeff();
+
+	std::cout << name << ": " << partitioned.blocks() << " blocks, " << partitioned.interfaceSize()
+		<< " interface unknowns, error " << error << ", batch error " << batchError << std::endl;
+
+	if (error > 1e-10 || batchError > 1e-10) {
+		std::cerr << name << ": solution differs from the monolithic factorization" << std::endl;
+		failed = true;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const Int n = 16;
+	SparseMatrix mat = createGrid(n, 3);
+
+	SparseOrdering ordering;
+	LUFactorization::computeOrdering(mat, ordering);
+	LUFactorization monolithic(mat, ordering);
+
+	// Two halves of the grid torn along its middle row
+	std::vector<Int> partition(n * n);
+	for (Int i = 0; i < n * n; i++)
+		partition[i] = i / n < n / 2 ? 0 : (i / n == n / 2 ? -1 : 1);
+	check("Torn row", PartitionedFactorization(mat, partition), monolithic);
+
+	auto pool = std::make_shared<WorkerPool>(2);
+
+	for (UInt blocks : { 0u, 2u, 4u, 8u }) {
+		PartitionedFactorization::computePartition(mat, { 0 }, blocks, partition);
+
+		String name = "Computed partition into " + std::to_string(blocks) + " blocks";
+		PartitionedFactorization partitioned(mat, partition);
+		check(name, partitioned, monolithic);
+
+		PartitionedFactorization parallel(mat, partition, pool);
+		check(name + " with workers", parallel, monolithic);
+
+		if (blocks > 0 && partitioned.blocks() != blocks) {
+			std::cerr << name << ": got " << partitioned.blocks() << " blocks" << std::endl;
+			failed = true;
+		}
+	}
+
+	// Unknowns of different blocks must not be coupled
+	std::vector<Int> coupled(n * n, 0);
+	coupled[1] = 1;
+	try {
+		PartitionedFactorization invalid(mat, coupled);
+		std::cerr << "Coupled blocks are not rejected" << std::endl;
+		failed = true;
+	}
+	catch (SolverException &) { }
+
+	return failed ? 1 : 0;
+}
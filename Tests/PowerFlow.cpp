@@ -0,0 +1,99 @@
+/** Tests for the Newton-Raphson power flow
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cmath>
+#include <iostream>
+
+#include <dpsim/PowerFlowSolver.h>
+
+using namespace DPsim;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+/// Stamp of a line with series impedance and half of the shunt susceptance at both ends
+static void addLine(std::vector<Eigen::Triplet<Complex>>& entries, Int i, Int j, Complex impedance, Real susceptance) {
+	Complex y = 1. / impedance;
+	Complex shunt(0, susceptance / 2);
+
+	entries.emplace_back(i, i, y + shunt);
+	entries.emplace_back(j, j, y + shunt);
+	entries.emplace_back(i, j, -y);
+	entries.emplace_back(j, i, -y);
+}
+
+int main(int argc, char *argv[]) {
+	// Three buses in per unit connected by three lines
+	std::vector<Eigen::Triplet<Complex>> entries;
+	addLine(entries, 0, 1, Complex(0.02, 0.06), 0.06);
+	addLine(entries, 0, 2, Complex(0.08, 0.24), 0.05);
+	addLine(entries, 1, 2, Complex(0.06, 0.18), 0.04);
+
+	SparseMatrixComp admittance(3, 3);
+	admittance.setFromTriplets(entries.begin(), entries.end());
+
+	std::vector<PowerFlowSolver::Bus> buses(3);
+	buses[0].type = PowerFlowSolver::BusType::Slack;
+	buses[0].V = 1.06;
+	buses[0].angle = 0.1;
+	buses[1].type = PowerFlowSolver::BusType::PV;
+	buses[1].P = 0.4;
+	buses[1].V = 1.04;
+	buses[2].type = PowerFlowSolver::BusType::PQ;
+	buses[2].P = -0.9;
+	buses[2].Q = -0.3;
+
+	PowerFlowSolver solver(admittance, buses);
+	Bool converged = solver.solve(1e-10, 10);
+
+	const MatrixComp &voltages = solver.voltages();
+
+	// Injections from the definition S = V conj(Y V) instead of the solver's own evaluation
+	MatrixComp currents = admittance * voltages;
+	MatrixComp powers = voltages.cwiseProduct(currents.conjugate());
+
+	std::cout << "Converged after " << solver.iterations() << " iterations with a mismatch of " << solver.mismatch() << std::endl;
+	for (Int i = 0; i < 3; i++)
+		std::cout << "Bus " << i << ": V = " << std::abs(voltages(i, 0)) << " < " << std::arg(voltages(i, 0))
+			<< ", S = " << powers(i, 0) << std::endl;
+
+	expect(converged, "power flow converges");
+	expect(solver.iterations() <= 6, "Newton-Raphson converges quadratically");
+
+	expect(std::abs(std::abs(voltages(0, 0)) - 1.06) < 1e-12 && std::abs(std::arg(voltages(0, 0)) - 0.1) < 1e-12,
+		"slack voltage is kept");
+	expect(std::abs(std::abs(voltages(1, 0)) - 1.04) < 1e-12, "PV voltage magnitude is kept");
+	expect(std::abs(powers(1, 0).real() - 0.4) < 1e-8, "PV active power is met");
+	expect(std::abs(powers(2, 0) - Complex(-0.9, -0.3)) < 1e-8, "PQ power is met");
+
+	// The slack bus supplies the load, the generation of the PV bus and the losses
+	Real losses = powers.sum().real();
+	expect(losses > 0 && powers(0, 0).real() > 0.5 - 1e-8, "slack bus covers the losses");
+
+	expect((solver.injections() - powers).cwiseAbs().maxCoeff() < 1e-12, "injections match their definition");
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+/** Tests for factorizations shared by the scenarios of an ensemble
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <dpsim/SharedFactorizations.h>
+
+using namespace DPsim;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+/// Conductance matrix of a chain of nodes with a shunt at each node
+static SparseMatrix createChain(Int n, Real shunt) {
+	std::vector<Eigen::Triplet<Real>> entries;
+
+	for (Int i = 0; i < n; i++) {
+		entries.emplace_back(i, i, (i > 0) + (i < n - 1) + shunt);
+		if (i + 1 < n) {
+			entries.emplace_back(i, i + 1, -1);
+			entries.emplace_back(i + 1, i, -1);
+		}
+	}
+
+	SparseMatrix mat(n, n);
+	mat.setFromTriplets(entries.begin(), entries.end());
+
+	return mat;
+}
+
+int main(int argc, char *argv[]) {
+	SharedFactorizations shared;
+	std::atomic<UInt> factorized(0);
+
+	auto factorize = [&factorized](const SparseMatrix& mat) {
+		return [&factorized, &mat]() {
+			factorized++;
+			return std::make_shared<LUFactorization>(Matrix(mat));
+		};
+	};
+
+	// Scenarios of an ensemble with equal systems factorize them once
+	SparseMatrix base = createChain(20, 0.1);
+	const UInt scenarios = 8;
+	std::vector<LUFactorization::Ptr> lus(scenarios);
+	std::vector<std::thread> threads;
+	for (UInt s = 0; s < scenarios; s++) {
+		threads.emplace_back([&, s]() {
+			SparseMatrix mat = createChain(20, 0.1);
+			lus[s] = shared.get(mat, Solver::MatrixType::Dense, factorize(mat));
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+
+	Bool same = true;
+	for (auto &lu : lus)
+		same = same && lu && lu == lus[0];
+	expect(same, "scenarios with equal matrices get the same factorization");
+	expect(factorized == 1, "equal matrices are factorized once");
+	expect(shared.misses() == 1 && shared.hits() == scenarios - 1,
+		"first request misses and all further requests hit");
+
+	// The shared factorization solves the system
+	Matrix rhs = Matrix::Ones(20, 1);
+	Matrix lhs = lus[0]->solve(rhs);
+	expect((Matrix(base) * lhs - rhs).norm() < 1e-10 * rhs.norm(), "shared factorization solves the system");
+
+	// A different value, e.g. a scenario with another parameter, misses
+	SparseMatrix changed = createChain(20, 0.2);
+	auto changedLu = shared.get(changed, Solver::MatrixType::Dense, factorize(changed));
+	expect(changedLu != lus[0], "matrix with different values gets its own factorization");
+	expect(shared.misses() == 2 && shared.entries() == 2, "matrix with different values misses");
+
+	// Equal values of another storage format are not shared
+	auto sparseLu = shared.get(base, Solver::MatrixType::Sparse, factorize(base));
+	expect(sparseLu != lus[0], "matrix of another type gets its own factorization");
+	expect(shared.misses() == 3 && shared.entries() == 3, "matrix of another type misses");
+
+	// An explicitly stored zero changes the pattern of the matrix
+	SparseMatrix pattern = base;
+	pattern.coeffRef(0, 5) = 0;
+	shared.get(pattern, Solver::MatrixType::Dense, factorize(pattern));
+	expect(shared.misses() == 4, "matrix with a different pattern misses");
+
+	// Later requests for known matrices still hit
+	UInt hits = shared.hits();
+	expect(shared.get(changed, Solver::MatrixType::Dense, factorize(changed)) == changedLu,
+		"known matrix gets its stored factorization");
+	expect(shared.hits() == hits + 1 && factorized == 4, "known matrix hits without factorizing");
+
+	return failed ? 1 : 0;
+}
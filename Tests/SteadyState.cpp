@@ -0,0 +1,93 @@
+/** Tests for the steady-state initialization
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <DPsim.h>
+
+using namespace DPsim;
+using namespace CPS::DP;
+using namespace CPS::DP::Ph1;
+
+static const Real timeStep = 0.0001;
+static const Real frequency = 50;
+static const Real voltage = 10;
+static const Real resistance = 5;
+static const Real inductance = 0.02;
+
+/// RL circuit whose inductor current starts from zero without initialization
+static SystemTopology createSystem() {
+	auto n1 = Node::make("n1");
+	auto n2 = Node::make("n2");
+
+	auto vs = VoltageSource::make("vs");
+	vs->setParameters(Complex(voltage, 0));
+	vs->connect(Node::List{ Node::GND, n1 });
+
+	auto r1 = Resistor::make("r_1");
+	r1->setParameters(resistance);
+	r1->connect(Node::List{ n1, n2 });
+
+	auto l1 = Inductor::make("l_1");
+	l1->setParameters(inductance);
+	l1->connect(Node::List{ n2, Node::GND });
+
+	return SystemTopology(frequency, SystemNodeList{n1, n2}, SystemComponentList{vs, r1, l1});
+}
+
+/// Inductor current after the initialization and one time step
+static Complex initializedCurrent(String name, Solver::SteadyStateMethod method, Real tolerance) {
+	auto sys = createSystem();
+	Simulation sim(name, sys, timeStep, 10 * timeStep,
+		Domain::DP, Solver::Type::MNA, Logger::Level::NONE);
+
+	sim.setSteadyStateInitialization(method, tolerance);
+	sim.step();
+
+	return sys.component<Inductor>("l_1")->attribute<MatrixComp>("i_intf")->get()(0, 0);
+}
+
+int main(int argc, char *argv[]) {
+	Real omega = 2 * PI * frequency;
+	Complex expected = voltage / Complex(resistance, omega * inductance);
+
+	Complex direct = initializedCurrent("SteadyState_Direct",
+		Solver::SteadyStateMethod::Direct, 1e-6);
+	Complex stepped = initializedCurrent("SteadyState_TimeStepping",
+		Solver::SteadyStateMethod::TimeStepping, 1e-8);
+
+	std::cout << "Analytic inductor current: " << expected << std::endl;
+	std::cout << "Direct initialization: " << direct << std::endl;
+	std::cout << "Time stepping initialization: " << stepped << std::endl;
+
+	Bool failed = false;
+	if (std::abs(direct - expected) > 1e-3 * std::abs(expected)) {
+		std::cerr << "Direct initialization differs from the analytic steady state" << std::endl;
+		failed = true;
+	}
+	if (std::abs(stepped - expected) > 1e-3 * std::abs(expected)) {
+		std::cerr << "Time stepping initialization differs from the analytic steady state" << std::endl;
+		failed = true;
+	}
+	if (std::abs(direct - stepped) > 1e-3 * std::abs(expected)) {
+		std::cerr << "Direct and time stepping initialization differ" << std::endl;
+		failed = true;
+	}
+
+	return failed ? 1 : 0;
+}
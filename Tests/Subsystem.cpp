@@ -0,0 +1,157 @@
+/** Tests for the inputs and outputs of multi-rate subsystems
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <dpsim/Subsystem.h>
+
+using namespace DPsim;
+using namespace CPS;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+/// Values exchanged between the simulation and the subsystem
+class Values : public AttributeList {
+public:
+	Real input = 0;
+	Real subsystemInput = 0;
+	Complex phasor = 0;
+	Real shifted = 0;
+	Real instantaneous = 0;
+	Real subsystemOutput = 0;
+	Real output = 0;
+	Complex demodulated = 0;
+
+	Values() {
+		addAttribute<Real>("input", &input, Flags::read | Flags::write);
+		addAttribute<Real>("subsystem_input", &subsystemInput, Flags::read | Flags::write);
+		addAttribute<Complex>("phasor", &phasor, Flags::read | Flags::write);
+		addAttribute<Real>("shifted", &shifted, Flags::read | Flags::write);
+		addAttribute<Real>("instantaneous", &instantaneous, Flags::read | Flags::write);
+		addAttribute<Real>("subsystem_output", &subsystemOutput, Flags::read | Flags::write);
+		addAttribute<Real>("output", &output, Flags::read | Flags::write);
+		addAttribute<Complex>("demodulated", &demodulated, Flags::read | Flags::write);
+	}
+};
+
+/// Records the inputs at each step and sets the outputs from the time
+class RecordingSolver : public Solver {
+protected:
+	Values &mValues;
+	Complex mOutputPhasor;
+	Real mOmega;
+
+public:
+	std::vector<Real> times;
+	std::vector<Real> inputs;
+	std::vector<Real> shifted;
+
+	RecordingSolver(Values &values, Complex outputPhasor, Real omega) :
+		mValues(values), mOutputPhasor(outputPhasor), mOmega(omega) { }
+
+	Real step(Real time) {
+		times.push_back(time);
+		inputs.push_back(mValues.subsystemInput);
+		shifted.push_back(mValues.shifted);
+
+		mValues.subsystemOutput = time;
+		mValues.instantaneous = (mOutputPhasor * std::polar(1.0, mOmega * time)).real();
+		return time;
+	}
+};
+
+int main(int argc, char *argv[]) {
+	const Real timeStep = 1e-3;
+	const Real subsystemTimeStep = 1e-4;
+	const Real omega = 2 * M_PI * 50;
+	const Complex inputPhasor = std::polar(230.0, 0.3);
+	const Complex outputPhasor = std::polar(10.0, -1.2);
+
+	Values values;
+	auto solver = std::make_shared<RecordingSolver>(values, outputPhasor, omega);
+
+	Subsystem subsystem("Subsystem", SystemTopology(50), subsystemTimeStep, Domain::EMT);
+	subsystem.addInput(values.attribute<Real>("input"), values.attribute<Real>("subsystem_input"));
+	subsystem.addInput(values.attribute<Complex>("phasor"), values.attribute<Real>("shifted"));
+	subsystem.addOutput(values.attribute<Real>("subsystem_output"), values.attribute<Real>("output"));
+	subsystem.addOutput(values.attribute<Real>("instantaneous"), values.attribute<Complex>("demodulated"));
+
+	Bool invalid = false;
+	try {
+		subsystem.setSolver(solver, 1.5 * subsystemTimeStep, omega);
+	} catch (std::invalid_argument &) {
+		invalid = true;
+	}
+	expect(invalid, "time step which is no multiple of the subsystem time step is rejected");
+
+	subsystem.setSolver(solver, timeStep, omega);
+	expect(subsystem.ratio() == 10, "subsystem takes ten steps per simulation step");
+
+	// A linear input is interpolated exactly, the output of the
+	// subsystem is averaged over the steps since the last simulation step
+	Bool interpolated = true, averaged = true;
+	for (UInt n = 0; n <= 50; n++) {
+		Real time = n * timeStep;
+		values.input = 3 * time + 1;
+		values.phasor = inputPhasor;
+
+		UInt first = solver->times.size();
+		subsystem.step(time);
+		subsystem.applyOutputs();
+
+		for (UInt i = first; i < solver->times.size(); i++) {
+			Real t = solver->times[i];
+			if (std::abs(solver->inputs[i] - (3 * t + 1)) > 1e-9)
+				interpolated = false;
+		}
+
+		if (n > 0 && std::abs(values.output - (time - timeStep + 5.5 * subsystemTimeStep)) > 1e-12)
+			averaged = false;
+	}
+	expect(solver->times.size() == 500, "subsystem steps after each but the first simulation step");
+	expect(std::abs(solver->times.back() - 50 * timeStep) < 1e-12, "subsystem steps up to the simulation time");
+	expect(interpolated, "inputs are interpolated linearly between simulation steps");
+	expect(averaged, "outputs are averaged over the subsystem steps");
+
+	// Phasors are shifted to instantaneous values at the subsystem time
+	Bool shifted = true;
+	for (UInt i = 0; i < solver->times.size(); i++) {
+		Real expected = (inputPhasor * std::polar(1.0, omega * solver->times[i])).real();
+		if (std::abs(solver->shifted[i] - expected) > 1e-9)
+			shifted = false;
+	}
+	expect(shifted, "phasor inputs are shifted to instantaneous values");
+
+	// After a full period the demodulated phasor matches the output
+	expect(std::abs(values.demodulated - outputPhasor) < 1e-9 * std::abs(outputPhasor),
+		"instantaneous outputs are demodulated to phasors");
+
+	return failed ? 1 : 0;
+}
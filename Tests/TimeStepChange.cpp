@@ -0,0 +1,104 @@
+/** Tests for changing the time step of a running simulation
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <stdexcept>
+
+#include <DPsim.h>
+
+using namespace DPsim;
+using namespace CPS::DP;
+using namespace CPS::DP::Ph1;
+
+static const Real timeStep = 0.00001;
+static const UInt steps = 400;
+
+/// RL circuit with a time constant of 4 ms, whose inductor current is in a
+/// transient from zero during the whole simulation
+static SystemTopology createSystem() {
+	auto n1 = Node::make("n1");
+	auto n2 = Node::make("n2");
+
+	auto vs = VoltageSource::make("vs");
+	vs->setParameters(Complex(10, 0));
+	vs->connect(Node::List{ Node::GND, n1 });
+
+	auto r1 = Resistor::make("r_1");
+	r1->setParameters(5);
+	r1->connect(Node::List{ n1, n2 });
+
+	auto l1 = Inductor::make("l_1");
+	l1->setParameters(0.02);
+	l1->connect(Node::List{ n2, Node::GND });
+
+	return SystemTopology(50, SystemNodeList{n1, n2}, SystemComponentList{vs, r1, l1});
+}
+
+static Complex inductorCurrent(SystemTopology& sys) {
+	return sys.component<Inductor>("l_1")->attribute<MatrixComp>("i_intf")->get()(0, 0);
+}
+
+int main(int argc, char *argv[]) {
+	auto fixedSystem = createSystem();
+	Simulation fixed("TimeStepChange_Fixed", fixedSystem, timeStep, steps * timeStep,
+		Domain::DP, Solver::Type::MNA, Logger::Level::NONE);
+
+	Real fixedTime = 0;
+	for (UInt i = 0; i < steps; i++)
+		fixedTime = fixed.step();
+
+	// The second half is stepped with the doubled time step. The inductor
+	// keeps its current, otherwise the transient would start from zero again.
+	auto changedSystem = createSystem();
+	Simulation changed("TimeStepChange_Changed", changedSystem, timeStep, steps * timeStep,
+		Domain::DP, Solver::Type::MNA, Logger::Level::NONE);
+
+	Real changedTime = 0;
+	for (UInt i = 0; i < steps / 2; i++)
+		changedTime = changed.step();
+
+	Bool failed = false;
+	try {
+		changed.setTimeStep(0);
+		std::cerr << "A time step of zero is accepted" << std::endl;
+		failed = true;
+	}
+	catch (std::invalid_argument&) { }
+
+	changed.setTimeStep(2 * timeStep);
+	for (UInt i = 0; i < steps / 4; i++)
+		changedTime = changed.step();
+
+	Complex expected = inductorCurrent(fixedSystem);
+	Complex actual = inductorCurrent(changedSystem);
+
+	std::cout << "Inductor current with a fixed time step at " << fixedTime << ": " << expected << std::endl;
+	std::cout << "Inductor current with a changed time step at " << changedTime << ": " << actual << std::endl;
+
+	if (std::abs(changedTime - fixedTime) > 1e-6 * timeStep) {
+		std::cerr << "Simulations did not reach the same time" << std::endl;
+		failed = true;
+	}
+	if (std::abs(actual - expected) > 1e-3 * std::abs(expected)) {
+		std::cerr << "Changed time step differs from the fixed time step" << std::endl;
+		failed = true;
+	}
+
+	return failed ? 1 : 0;
+}
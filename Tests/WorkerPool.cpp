@@ -0,0 +1,119 @@
+/** Tests for the worker pool
+ *
+ * @copyright 2017-2018, Institute for Automation of Complex Power Systems, EONERC
+ *
+ * DPsim
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *********************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <dpsim/WorkerPool.h>
+
+using namespace DPsim;
+
+static Bool failed = false;
+
+static void expect(Bool condition, const char *description) {
+	if (!condition) {
+		std::cerr << "Failed: " << description << std::endl;
+		failed = true;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const UInt count = 10007;
+	std::vector<Real> input(count);
+	for (UInt i = 0; i < count; i++)
+		input[i] = 0.5 * i - 1000;
+
+	std::vector<Real> serial(count);
+	for (UInt i = 0; i < count; i++)
+		serial[i] = input[i] * input[i] + 1;
+
+	WorkerPool pool(4);
+	expect(pool.size() == 4, "pool has the calling thread and three workers");
+
+	// Each worker processes its range, repeated to reuse the workers
+	std::vector<Real> parallel(count);
+	std::vector<UInt> calls(pool.size());
+	Bool equal = true;
+	for (UInt run = 0; run < 100; run++) {
+		std::fill(parallel.begin(), parallel.end(), 0);
+		pool.run([&](UInt worker) {
+			calls[worker]++;
+			auto range = pool.range(worker, count);
+			for (UInt i = range.first; i < range.second; i++)
+				parallel[i] = input[i] * input[i] + 1;
+		});
+		equal = equal && parallel == serial;
+	}
+	expect(equal, "parallel result equals serial result");
+	expect(std::all_of(calls.begin(), calls.end(), [](UInt c) { return c == 100; }),
+		"task runs once on each worker per run");
+
+	UInt covered = 0;
+	for (UInt worker = 0; worker < pool.size(); worker++) {
+		auto range = pool.range(worker, count);
+		expect(range.first == covered, "ranges are contiguous");
+		covered = range.second;
+	}
+	expect(covered == count, "ranges cover all items");
+
+	// The exception of the worker with the lowest index is rethrown
+	// after all workers are done
+	std::vector<UInt> done(pool.size(), 0);
+	try {
+		pool.run([&](UInt worker) {
+			done[worker] = 1;
+			if (worker >= 2)
+				throw std::runtime_error(std::to_string(worker));
+		});
+		expect(false, "exception of a worker is rethrown");
+	}
+	catch (std::runtime_error& e) {
+		expect(String(e.what()) == "2", "exception of the lowest worker is rethrown");
+	}
+	expect(std::all_of(done.begin(), done.end(), [](UInt d) { return d == 1; }), "all workers finish the failed run");
+
+	try {
+		pool.run([](UInt worker) {
+			if (worker == 0)
+				throw std::logic_error("calling thread");
+		});
+		expect(false, "exception of the calling thread is rethrown");
+	}
+	catch (std::logic_error&) { }
+
+	// The pool stays usable after a failed run
+	std::fill(parallel.begin(), parallel.end(), 0);
+	pool.run([&](UInt worker) {
+		auto range = pool.range(worker, count);
+		for (UInt i = range.first; i < range.second; i++)
+			parallel[i] = input[i] * input[i] + 1;
+	});
+	expect(parallel == serial, "pool works after a failed run");
+
+	// A pool of one thread runs the task on the calling thread
+	WorkerPool single(1);
+	UInt singleCalls = 0;
+	single.run([&](UInt worker) { singleCalls += worker == 0; });
+	expect(single.size() == 1 && singleCalls == 1, "single thread pool runs the task on the caller");
+
+	return failed ? 1 : 0;
+}
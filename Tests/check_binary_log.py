@@ -0,0 +1,40 @@
+# Reads the logs written by the BinaryLog test and compares them to the
+# written values.
+#
+# usage: check_binary_log.py MODULE_DIR ROWS F64_LOG F32_LOG
+
+import sys
+
+import numpy as np
+
+sys.path.insert(0, sys.argv[1])
+from BinaryLog import read_binary_log
+
+rows = int(sys.argv[2])
+failed = False
+
+for filename, dtype in [(sys.argv[3], np.float64), (sys.argv[4], np.float32)]:
+    data, units = read_binary_log(filename)
+
+    i = np.arange(rows)
+    expected = {
+        'time': i * 1e-3,
+        'node00000': i.astype(dtype),
+        'node00001': (0.1 * i - 2.5).astype(dtype)
+    }
+
+    if list(data.keys()) != list(expected.keys()):
+        print('%s: columns %s' % (filename, list(data.keys())))
+        failed = True
+        continue
+
+    for name, values in expected.items():
+        if data[name].dtype != values.dtype or not np.array_equal(data[name], values):
+            print('%s: column %s is %s' % (filename, name, data[name]))
+            failed = True
+
+    if units != {'time': 's', 'node00000': '', 'node00001': 'V'}:
+        print('%s: units %s' % (filename, units))
+        failed = True
+
+sys.exit(1 if failed else 0)
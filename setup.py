@@ -106,6 +106,7 @@ setup(
     ],
     install_requires = [
         'villas-dataprocessing>=0.2',
+        'numpy',
         'progressbar2',
         'ipywidgets'
     ],